@@ -0,0 +1,369 @@
+// Reader for AMDGPU code object metadata (code object v3 and later).
+//
+// Finds the NT_AMDGPU_METADATA note ("AMDGPU" owner, type 32) in a 64-bit
+// little-endian ELF, either a relocatable object from llc or a linked code
+// object, and decodes its MessagePack map into the kernel list and argument
+// layouts. It needs no HIP runtime and no llvm-readobj, so hip_runner can
+// select kernels itself. Code object v2 YAML notes are not supported.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct KernelArgMetadata {
+  std::string name;
+  std::string value_kind;
+  std::string address_space;
+  uint64_t offset = 0;
+  uint64_t size = 0;
+
+  bool hidden() const { return value_kind.rfind("hidden_", 0) == 0; }
+};
+
+struct KernelMetadata {
+  std::string name;
+  std::string symbol;
+  uint64_t kernarg_segment_size = 0;
+  // Explicit and hidden arguments in kernarg order.
+  std::vector<KernelArgMetadata> args;
+};
+
+// The subset of MessagePack the metadata uses: nil, booleans, integers,
+// floats, strings, binaries, arrays and maps.
+struct MsgPackValue {
+  enum class Kind { kNil, kBool, kUint, kInt, kFloat, kString, kArray, kMap };
+  Kind kind = Kind::kNil;
+  uint64_t uint_value = 0;
+  int64_t int_value = 0;
+  double float_value = 0.0;
+  std::string string_value;
+  std::vector<MsgPackValue> array;
+  std::vector<std::pair<MsgPackValue, MsgPackValue>> map;
+
+  const MsgPackValue *find(const std::string &key) const {
+    for (const auto &entry : map) {
+      if (entry.first.kind == Kind::kString &&
+          entry.first.string_value == key) {
+        return &entry.second;
+      }
+    }
+    return nullptr;
+  }
+
+  bool as_uint(uint64_t &out) const {
+    if (kind == Kind::kUint) {
+      out = uint_value;
+      return true;
+    }
+    if (kind == Kind::kInt && int_value >= 0) {
+      out = static_cast<uint64_t>(int_value);
+      return true;
+    }
+    return false;
+  }
+};
+
+inline bool read_le(const std::string &data, size_t pos, size_t size,
+                    uint64_t &out) {
+  if (pos > data.size() || data.size() - pos < size) {
+    return false;
+  }
+  out = 0;
+  for (size_t i = 0; i < size; ++i) {
+    out |= static_cast<uint64_t>(static_cast<uint8_t>(data[pos + i]))
+           << (8 * i);
+  }
+  return true;
+}
+
+// MessagePack is big-endian.
+inline bool read_be(const std::string &data, size_t &pos, size_t size,
+                    uint64_t &out) {
+  if (pos > data.size() || data.size() - pos < size) {
+    return false;
+  }
+  out = 0;
+  for (size_t i = 0; i < size; ++i) {
+    out = out << 8 | static_cast<uint8_t>(data[pos + i]);
+  }
+  pos += size;
+  return true;
+}
+
+inline bool read_msgpack(const std::string &data, size_t &pos,
+                         MsgPackValue &value, int depth = 0) {
+  using Kind = MsgPackValue::Kind;
+  if (depth > 32 || pos >= data.size()) {
+    return false;
+  }
+  uint8_t tag = static_cast<uint8_t>(data[pos++]);
+  uint64_t n = 0;
+  auto read_string = [&](uint64_t length, Kind kind) {
+    if (data.size() - pos < length) {
+      return false;
+    }
+    value.kind = kind;
+    value.string_value = data.substr(pos, length);
+    pos += length;
+    return true;
+  };
+  auto read_array = [&](uint64_t count) {
+    // Every element takes at least a byte.
+    if (count > data.size() - pos) {
+      return false;
+    }
+    value.kind = Kind::kArray;
+    value.array.resize(count);
+    for (auto &element : value.array) {
+      if (!read_msgpack(data, pos, element, depth + 1)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  auto read_map = [&](uint64_t count) {
+    if (count > (data.size() - pos) / 2) {
+      return false;
+    }
+    value.kind = Kind::kMap;
+    value.map.resize(count);
+    for (auto &entry : value.map) {
+      if (!read_msgpack(data, pos, entry.first, depth + 1) ||
+          !read_msgpack(data, pos, entry.second, depth + 1)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  if (tag <= 0x7F) {
+    value.kind = Kind::kUint;
+    value.uint_value = tag;
+    return true;
+  }
+  if (tag >= 0xE0) {
+    value.kind = Kind::kInt;
+    value.int_value = static_cast<int8_t>(tag);
+    return true;
+  }
+  if ((tag & 0xE0) == 0xA0) {
+    return read_string(tag & 0x1F, Kind::kString);
+  }
+  if ((tag & 0xF0) == 0x90) {
+    return read_array(tag & 0x0F);
+  }
+  if ((tag & 0xF0) == 0x80) {
+    return read_map(tag & 0x0F);
+  }
+  switch (tag) {
+  case 0xC0:
+    value.kind = Kind::kNil;
+    return true;
+  case 0xC2:
+  case 0xC3:
+    value.kind = Kind::kBool;
+    value.uint_value = tag == 0xC3;
+    return true;
+  case 0xCC:
+  case 0xCD:
+  case 0xCE:
+  case 0xCF:
+    value.kind = Kind::kUint;
+    return read_be(data, pos, size_t(1) << (tag - 0xCC), value.uint_value);
+  case 0xD0:
+  case 0xD1:
+  case 0xD2:
+  case 0xD3: {
+    size_t size = size_t(1) << (tag - 0xD0);
+    if (!read_be(data, pos, size, n)) {
+      return false;
+    }
+    // Sign-extend from the encoded width.
+    unsigned shift = static_cast<unsigned>(64 - 8 * size);
+    value.kind = Kind::kInt;
+    value.int_value = static_cast<int64_t>(n << shift) >> shift;
+    return true;
+  }
+  case 0xCA:
+  case 0xCB: {
+    if (!read_be(data, pos, tag == 0xCA ? 4 : 8, n)) {
+      return false;
+    }
+    value.kind = Kind::kFloat;
+    if (tag == 0xCA) {
+      uint32_t bits = static_cast<uint32_t>(n);
+      float f;
+      std::memcpy(&f, &bits, sizeof(f));
+      value.float_value = f;
+    } else {
+      std::memcpy(&value.float_value, &n, sizeof(n));
+    }
+    return true;
+  }
+  case 0xD9:
+  case 0xDA:
+  case 0xDB:
+    return read_be(data, pos, size_t(1) << (tag - 0xD9), n) &&
+           read_string(n, Kind::kString);
+  case 0xC4:
+  case 0xC5:
+  case 0xC6:
+    // Binaries are kept as strings; the metadata does not use them.
+    return read_be(data, pos, size_t(1) << (tag - 0xC4), n) &&
+           read_string(n, Kind::kString);
+  case 0xDC:
+  case 0xDD:
+    return read_be(data, pos, tag == 0xDC ? 2 : 4, n) && read_array(n);
+  case 0xDE:
+  case 0xDF:
+    return read_be(data, pos, tag == 0xDE ? 2 : 4, n) && read_map(n);
+  default:
+    return false;
+  }
+}
+
+// Return the descriptor of the first NT_AMDGPU_METADATA note in the ELF
+// image, searching note sections and then note segments.
+inline bool find_metadata_note(const std::string &elf, std::string &desc,
+                               std::string &error) {
+  static constexpr uint32_t kSectionNote = 7; // SHT_NOTE
+  static constexpr uint32_t kSegmentNote = 4; // PT_NOTE
+  static constexpr uint32_t kNoteMetadata = 32; // NT_AMDGPU_METADATA
+  if (elf.size() < 64 || elf.compare(0, 4, "\x7f" "ELF") != 0) {
+    error = "not an ELF file";
+    return false;
+  }
+  if (elf[4] != 2 || elf[5] != 1) {
+    error = "not a 64-bit little-endian ELF file";
+    return false;
+  }
+
+  // (offset, size) of every note section and note segment.
+  std::vector<std::pair<uint64_t, uint64_t>> regions;
+  uint64_t shoff = 0, shentsize = 0, shnum = 0;
+  uint64_t phoff = 0, phentsize = 0, phnum = 0;
+  read_le(elf, 0x28, 8, shoff);
+  read_le(elf, 0x3A, 2, shentsize);
+  read_le(elf, 0x3C, 2, shnum);
+  read_le(elf, 0x20, 8, phoff);
+  read_le(elf, 0x36, 2, phentsize);
+  read_le(elf, 0x38, 2, phnum);
+  for (uint64_t i = 0; shoff != 0 && i < shnum; ++i) {
+    uint64_t header = shoff + i * shentsize, type = 0, offset = 0, size = 0;
+    if (read_le(elf, header + 0x04, 4, type) && type == kSectionNote &&
+        read_le(elf, header + 0x18, 8, offset) &&
+        read_le(elf, header + 0x20, 8, size)) {
+      regions.emplace_back(offset, size);
+    }
+  }
+  for (uint64_t i = 0; phoff != 0 && i < phnum; ++i) {
+    uint64_t header = phoff + i * phentsize, type = 0, offset = 0, size = 0;
+    if (read_le(elf, header, 4, type) && type == kSegmentNote &&
+        read_le(elf, header + 0x08, 8, offset) &&
+        read_le(elf, header + 0x20, 8, size)) {
+      regions.emplace_back(offset, size);
+    }
+  }
+
+  auto align4 = [](uint64_t value) { return (value + 3) & ~uint64_t(3); };
+  for (const auto &region : regions) {
+    if (region.first > elf.size() || elf.size() - region.first < region.second) {
+      continue;
+    }
+    uint64_t pos = region.first;
+    uint64_t end = region.first + region.second;
+    while (end - pos >= 12) {
+      uint64_t namesz = 0, descsz = 0, type = 0;
+      read_le(elf, pos, 4, namesz);
+      read_le(elf, pos + 4, 4, descsz);
+      read_le(elf, pos + 8, 4, type);
+      uint64_t name_pos = pos + 12;
+      uint64_t desc_pos = name_pos + align4(namesz);
+      if (desc_pos > end || end - desc_pos < descsz) {
+        break;
+      }
+      if (type == kNoteMetadata && namesz == 7 &&
+          elf.compare(name_pos, 7, std::string("AMDGPU\0", 7)) == 0) {
+        desc = elf.substr(desc_pos, descsz);
+        return true;
+      }
+      pos = desc_pos + align4(descsz);
+    }
+  }
+  error = "no NT_AMDGPU_METADATA note";
+  return false;
+}
+
+inline std::string metadata_string(const MsgPackValue &map,
+                                   const std::string &key) {
+  const MsgPackValue *value = map.find(key);
+  return value != nullptr && value->kind == MsgPackValue::Kind::kString
+             ? value->string_value
+             : std::string();
+}
+
+inline uint64_t metadata_uint(const MsgPackValue &map, const std::string &key) {
+  const MsgPackValue *value = map.find(key);
+  uint64_t out = 0;
+  return value != nullptr && value->as_uint(out) ? out : 0;
+}
+
+// Read the kernels described by the code object at `path`. On failure
+// `error` says why.
+inline bool read_code_object_metadata(const std::string &path,
+                                      std::vector<KernelMetadata> &kernels,
+                                      std::string &error) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    error = "cannot read " + path;
+    return false;
+  }
+  std::string elf((std::istreambuf_iterator<char>(in)),
+                  std::istreambuf_iterator<char>());
+  std::string note;
+  if (!find_metadata_note(elf, note, error)) {
+    return false;
+  }
+  MsgPackValue root;
+  size_t pos = 0;
+  if (!read_msgpack(note, pos, root) || root.kind != MsgPackValue::Kind::kMap) {
+    error = "malformed metadata note";
+    return false;
+  }
+  const MsgPackValue *list = root.find("amdhsa.kernels");
+  if (list == nullptr || list->kind != MsgPackValue::Kind::kArray) {
+    error = "metadata has no amdhsa.kernels";
+    return false;
+  }
+  kernels.clear();
+  for (const auto &entry : list->array) {
+    if (entry.kind != MsgPackValue::Kind::kMap) {
+      continue;
+    }
+    KernelMetadata kernel;
+    kernel.name = metadata_string(entry, ".name");
+    kernel.symbol = metadata_string(entry, ".symbol");
+    kernel.kernarg_segment_size = metadata_uint(entry, ".kernarg_segment_size");
+    const MsgPackValue *args = entry.find(".args");
+    if (args != nullptr && args->kind == MsgPackValue::Kind::kArray) {
+      for (const auto &item : args->array) {
+        KernelArgMetadata arg;
+        arg.name = metadata_string(item, ".name");
+        arg.value_kind = metadata_string(item, ".value_kind");
+        arg.address_space = metadata_string(item, ".address_space");
+        arg.offset = metadata_uint(item, ".offset");
+        arg.size = metadata_uint(item, ".size");
+        kernel.args.push_back(std::move(arg));
+      }
+    }
+    kernels.push_back(std::move(kernel));
+  }
+  return true;
+}
@@ -0,0 +1,145 @@
+"""Reader for AMDGPU code object metadata, for spill_fuzz.py.
+
+The Python counterpart of amdgpu_metadata.h: finds the NT_AMDGPU_METADATA
+note ("AMDGPU" owner, type 32) in a 64-bit little-endian ELF, either an llc
+object or a linked code object, and decodes its MessagePack map. The harness
+reads each test object's spill counts from it instead of dumping and scanning
+the allocator's MIR.
+"""
+
+import struct
+from pathlib import Path
+from typing import List, Optional, Tuple
+
+NT_AMDGPU_METADATA = 32
+SHT_NOTE = 7
+
+
+class MetadataError(Exception):
+    pass
+
+
+def _unpack(data: bytes, pos: int):
+    """Decode the MessagePack value at pos; return (value, next pos)."""
+    try:
+        tag = data[pos]
+    except IndexError:
+        raise MetadataError("truncated metadata") from None
+    pos += 1
+    if tag <= 0x7F:
+        return tag, pos
+    if tag >= 0xE0:
+        return tag - 0x100, pos
+    if 0x80 <= tag <= 0x8F:
+        return _unpack_map(data, pos, tag & 0x0F)
+    if 0x90 <= tag <= 0x9F:
+        return _unpack_array(data, pos, tag & 0x0F)
+    if 0xA0 <= tag <= 0xBF:
+        return _unpack_bytes(data, pos, tag & 0x1F, True)
+    if tag == 0xC0:
+        return None, pos
+    if tag in (0xC2, 0xC3):
+        return tag == 0xC3, pos
+    sized = {0xC4: ("<B", False), 0xC5: ("<H", False), 0xC6: ("<I", False),
+             0xD9: ("<B", True), 0xDA: ("<H", True), 0xDB: ("<I", True)}
+    if tag in sized:
+        fmt, is_str = sized[tag]
+        length, pos = _scalar(data, pos, fmt)
+        return _unpack_bytes(data, pos, length, is_str)
+    scalars = {0xCA: "<f", 0xCB: "<d", 0xCC: "<B", 0xCD: "<H", 0xCE: "<I", 0xCF: "<Q",
+               0xD0: "<b", 0xD1: "<h", 0xD2: "<i", 0xD3: "<q"}
+    if tag in scalars:
+        return _scalar(data, pos, scalars[tag])
+    containers = {0xDC: ("<H", _unpack_array), 0xDD: ("<I", _unpack_array),
+                  0xDE: ("<H", _unpack_map), 0xDF: ("<I", _unpack_map)}
+    if tag in containers:
+        fmt, unpack = containers[tag]
+        count, pos = _scalar(data, pos, fmt)
+        return unpack(data, pos, count)
+    raise MetadataError(f"unsupported MessagePack tag 0x{tag:02x}")
+
+
+def _scalar(data: bytes, pos: int, fmt: str):
+    size = struct.calcsize(fmt)
+    if pos + size > len(data):
+        raise MetadataError("truncated metadata")
+    return struct.unpack_from(fmt, data, pos)[0], pos + size
+
+
+def _unpack_bytes(data: bytes, pos: int, length: int, is_str: bool):
+    if pos + length > len(data):
+        raise MetadataError("truncated metadata")
+    raw = data[pos:pos + length]
+    return (raw.decode("utf-8", errors="replace") if is_str else raw), pos + length
+
+
+def _unpack_array(data: bytes, pos: int, count: int):
+    items = []
+    for _ in range(count):
+        item, pos = _unpack(data, pos)
+        items.append(item)
+    return items, pos
+
+
+def _unpack_map(data: bytes, pos: int, count: int):
+    entries = {}
+    for _ in range(count):
+        key, pos = _unpack(data, pos)
+        value, pos = _unpack(data, pos)
+        if isinstance(key, str):
+            entries[key] = value
+    return entries, pos
+
+
+def _metadata_notes(image: bytes) -> List[bytes]:
+    if image[:4] != b"\x7fELF" or len(image) < 64:
+        raise MetadataError("not an ELF file")
+    if image[4] != 2 or image[5] != 1:
+        raise MetadataError("not a 64-bit little-endian ELF file")
+    shoff, = struct.unpack_from("<Q", image, 0x28)
+    shentsize, shnum = struct.unpack_from("<HH", image, 0x3A)
+    notes = []
+    for i in range(shnum):
+        header = shoff + i * shentsize
+        if header + 64 > len(image):
+            raise MetadataError("section header past the end of the file")
+        sh_type, = struct.unpack_from("<I", image, header + 4)
+        offset, size = struct.unpack_from("<QQ", image, header + 0x18)
+        if sh_type != SHT_NOTE or offset + size > len(image):
+            continue
+        pos, end = offset, offset + size
+        while pos + 12 <= end:
+            namesz, descsz, note_type = struct.unpack_from("<III", image, pos)
+            name_at = pos + 12
+            desc_at = name_at + (namesz + 3) // 4 * 4
+            if desc_at + descsz > end:
+                break
+            if (note_type == NT_AMDGPU_METADATA
+                    and image[name_at:name_at + namesz].rstrip(b"\0") == b"AMDGPU"):
+                notes.append(image[desc_at:desc_at + descsz])
+            pos = desc_at + (descsz + 3) // 4 * 4
+    return notes
+
+
+def read_kernels(path: Path) -> List[dict]:
+    """The amdhsa.kernels entries of a code object's metadata note."""
+    notes = _metadata_notes(Path(path).read_bytes())
+    if not notes:
+        raise MetadataError("no NT_AMDGPU_METADATA note")
+    metadata, _ = _unpack(notes[0], 0)
+    if not isinstance(metadata, dict):
+        raise MetadataError("metadata is not a map")
+    kernels = metadata.get("amdhsa.kernels", [])
+    return [k for k in kernels if isinstance(k, dict)]
+
+
+def spill_counts(path: Path) -> Optional[Tuple[int, int]]:
+    """(vector, sgpr) registers spilled, summed over the kernels of an object,
+    or None if its metadata cannot be read."""
+    try:
+        kernels = read_kernels(path)
+    except (OSError, MetadataError):
+        return None
+    vector = sum(int(k.get(".vgpr_spill_count", 0) or 0) for k in kernels)
+    sgpr = sum(int(k.get(".sgpr_spill_count", 0) or 0) for k in kernels)
+    return vector, sgpr
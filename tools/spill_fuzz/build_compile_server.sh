@@ -0,0 +1,15 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+ROOT_DIR=$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)
+TOOLS_DIR="${ROOT_DIR}/tools/spill_fuzz"
+
+LLVM_CONFIG=${LLVM_CONFIG:-llvm-config}
+CXX=${CXX:-c++}
+OUT="${TOOLS_DIR}/compile_server"
+
+# llvm-config may pin an older -std; the trailing -std=c++17 wins.
+${CXX} -O2 $(${LLVM_CONFIG} --cxxflags) -std=c++17 -o "${OUT}" \
+  "${TOOLS_DIR}/compile_server.cpp" \
+  $(${LLVM_CONFIG} --ldflags --libs --system-libs)
+echo "built ${OUT}"
@@ -7,5 +7,11 @@ TOOLS_DIR="${ROOT_DIR}/tools/spill_fuzz"
 HIPCC=${HIPCC:-hipcc}
 OUT="${TOOLS_DIR}/hip_runner"
 
-${HIPCC} -O2 -std=c++17 -o "${OUT}" "${TOOLS_DIR}/hip_runner.cpp"
+# HIP_RUNNER_BACKEND=fake builds against hip_fake_runtime.h with the host
+# compiler, for exercising the runner and its server mode without a GPU.
+if [[ "${HIP_RUNNER_BACKEND:-hip}" == "fake" ]]; then
+  ${CXX:-c++} -O2 -std=c++17 -pthread -DHIP_RUNNER_FAKE_BACKEND -o "${OUT}" "${TOOLS_DIR}/hip_runner.cpp"
+else
+  ${HIPCC} -O2 -std=c++17 -o "${OUT}" "${TOOLS_DIR}/hip_runner.cpp"
+fi
 echo "built ${OUT}"
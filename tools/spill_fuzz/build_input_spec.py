@@ -15,7 +15,71 @@ def parse_args() -> argparse.Namespace:
     return parser.parse_args()
 
 
-def emit_lines(data: dict) -> List[str]:
+ELEMENT_TYPES = ("u8", "i32", "u32", "i64", "u64", "f32", "f64")
+
+
+def compare_line(index: str, entry: dict) -> str:
+    """Return the `compare` line for a buffer's (or the default) type and
+    tolerance. No tolerance means an exact comparison."""
+    elem_type = entry.get("type", "u8")
+    if elem_type not in ELEMENT_TYPES:
+        raise ValueError(f"compare {index}: unknown type {elem_type}")
+    tolerance = entry.get("tolerance")
+    if tolerance is None:
+        return f"compare {index} {elem_type} exact"
+    if "ulp" in tolerance:
+        return f"compare {index} {elem_type} ulp {int(tolerance['ulp'])}"
+    if "rtol" in tolerance or "atol" in tolerance:
+        rtol = float(tolerance.get("rtol", 0.0))
+        atol = float(tolerance.get("atol", 0.0))
+        return f"compare {index} {elem_type} tol {rtol!r} {atol!r}"
+    raise ValueError(f"compare {index}: tolerance must have ulp or rtol/atol")
+
+
+GENERATOR_KINDS = ("uniform", "positive", "range", "simplex")
+# The values a `range` bound of each integer type can take.
+RANGE_BOUNDS = {
+    "u8": (0, 2**8 - 1),
+    "i32": (-2**31, 2**31 - 1),
+    "u32": (0, 2**32 - 1),
+    "i64": (-2**63, 2**63 - 1),
+    "u64": (0, 2**64 - 1),
+}
+
+
+def gen_line(index: str, entry: dict) -> str:
+    """Return the `gen` line for one argument's generator entry, e.g.
+    {"uniform": [0, 1], "type": "f64", "nan_rate": 1e-4}."""
+    kinds = [kind for kind in GENERATOR_KINDS if kind in entry]
+    if len(kinds) != 1:
+        raise ValueError(f"generator {index} needs exactly one of {', '.join(GENERATOR_KINDS)}")
+    kind = kinds[0]
+    elem_type = entry.get("type", "i32" if kind == "range" else "f64")
+    if elem_type not in ELEMENT_TYPES:
+        raise ValueError(f"generator {index}: unknown type {elem_type}")
+    params = entry[kind]
+    if kind == "simplex":
+        text = f"gen {index} {elem_type} simplex {int(params)}"
+    else:
+        if not isinstance(params, list) or len(params) != 2:
+            raise ValueError(f"generator {index}: {kind} needs [lo, hi]")
+        convert = int if kind == "range" else float
+        lo, hi = convert(params[0]), convert(params[1])
+        if kind == "range":
+            if elem_type not in RANGE_BOUNDS:
+                raise ValueError(f"generator {index}: range needs an integer type")
+            low, high = RANGE_BOUNDS[elem_type]
+            if not low <= lo <= hi <= high:
+                raise ValueError(f"generator {index}: range [{lo}, {hi}] is not an "
+                                 f"ordered range within {elem_type} [{low}, {high}]")
+        text = f"gen {index} {elem_type} {kind} {lo!r} {hi!r}"
+    for key, word in (("nan_rate", "nan"), ("inf_rate", "inf")):
+        if key in entry:
+            text += f" {word} {float(entry[key])!r}"
+    return text
+
+
+def emit_lines(data: dict, base_dir: Path = Path(".")) -> List[str]:
     lines: List[str] = []
 
     seed = data.get("seed")
@@ -35,15 +99,34 @@ def emit_lines(data: dict) -> List[str]:
             )
         )
 
+    compare = data.get("compare")
+    if compare is not None:
+        lines.append(compare_line("*", compare))
+
     buffers = data.get("buffers", {})
     for key, value in buffers.items():
         if isinstance(value, dict):
             size = value.get("size_bytes")
+            if "type" in value or "tolerance" in value:
+                lines.append(compare_line(str(int(key)), value))
+            if "file" in value:
+                # Relative snapshot paths are relative to the JSON file; the
+                # flat spec holds absolute ones, since hip_runner may run
+                # elsewhere.
+                path = (base_dir / str(value["file"])).resolve()
+                offset = int(value.get("offset", 0))
+                length = int(value.get("length", 0))
+                lines.append(f"file {int(key)} {offset} {length} {path}")
+            elif size is None and "type" not in value and "tolerance" not in value:
+                raise ValueError(f"buffer {key} missing size_bytes")
         else:
             size = value
-        if size is None:
-            raise ValueError(f"buffer {key} missing size_bytes")
-        lines.append(f"buffer {int(key)} {int(size)}")
+        if size is not None:
+            lines.append(f"buffer {int(key)} {int(size)}")
+
+    generators = data.get("generators", {})
+    for key, value in generators.items():
+        lines.append(gen_line(str(int(key)), value))
 
     values = data.get("values", {})
     for key, value in values.items():
@@ -72,7 +155,7 @@ def main() -> int:
     input_path = Path(args.input_path)
     output_path = Path(args.output_path)
     data = json.loads(input_path.read_text(encoding="utf-8"))
-    lines = emit_lines(data)
+    lines = emit_lines(data, input_path.parent)
     output_path.write_text("\n".join(lines) + "\n", encoding="utf-8")
     return 0
 
@@ -0,0 +1,404 @@
+// Long-lived AMDGPU codegen server for the spill fuzz harness.
+//
+// Parses each corpus module once and serves compile requests over a
+// line-oriented stdin/stdout protocol. Every compile runs in a forked child:
+// the child owns a copy-on-write image of the parsed module, so it rewrites
+// the register-limit attributes in place instead of cloning, and an LLVM fatal
+// error or crash only takes down that one request.
+//
+// Requests (one per line, whitespace separated, paths must not contain
+// whitespace):
+//
+//   load <id> <path>
+//   unload <id>
+//   compile <id> [vgpr=N] [sgpr=N] [mcpu=CPU] [stop-after=PASS] [verify=0|1]
+//           [spill-sgpr-to-vgpr=0|1] [ir-out=PATH] [out=PATH] [log=PATH]
+//           [timeout-ms=N]
+//   quit
+//
+// Responses:
+//
+//   ok
+//   error <message>
+//   result <code>    exit code of the compile child, 128+signal on crash
+//   timeout          the child ran past timeout-ms and was killed
+//
+// Without stop-after the request emits an object file to `out`; with it the
+// MIR after that pass is written instead, matching `llc -stop-after`.
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/CodeGen/CommandFlags.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#if LLVM_VERSION_MAJOR >= 14
+#include "llvm/MC/TargetRegistry.h"
+#else
+#include "llvm/Support/TargetRegistry.h"
+#endif
+#if LLVM_VERSION_MAJOR >= 17
+#include "llvm/TargetParser/Triple.h"
+#else
+#include "llvm/ADT/Triple.h"
+#endif
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if LLVM_VERSION_MAJOR >= 18
+static constexpr llvm::CodeGenFileType kObjectFile =
+    llvm::CodeGenFileType::ObjectFile;
+static constexpr llvm::CodeGenFileType kAssemblyFile =
+    llvm::CodeGenFileType::AssemblyFile;
+#else
+static constexpr llvm::CodeGenFileType kObjectFile = llvm::CGFT_ObjectFile;
+static constexpr llvm::CodeGenFileType kAssemblyFile = llvm::CGFT_AssemblyFile;
+#endif
+
+struct ServerOptions {
+  std::string mtriple = "amdgcn-amd-amdhsa";
+  std::string mcpu = "gfx90a";
+  std::vector<std::string> llc_args;
+};
+
+struct CompileRequest {
+  std::string id;
+  int num_vgpr = -1;
+  int num_sgpr = -1;
+  std::string mcpu;
+  std::string stop_after;
+  bool verify = false;
+  int spill_sgpr_to_vgpr = -1;
+  std::string ir_out;
+  std::string out;
+  std::string log;
+  int timeout_ms = 0;
+};
+
+static bool parse_int(const std::string &text, int &out) {
+  char *end = nullptr;
+  long value = std::strtol(text.c_str(), &end, 10);
+  if (text.empty() || *end != '\0' || value < 0) {
+    return false;
+  }
+  out = static_cast<int>(value);
+  return true;
+}
+
+static bool parse_compile_request(std::istringstream &iss, CompileRequest &req,
+                                  std::string &error) {
+  if (!(iss >> req.id)) {
+    error = "compile requires a module id";
+    return false;
+  }
+  std::string token;
+  while (iss >> token) {
+    size_t eq = token.find('=');
+    if (eq == std::string::npos) {
+      error = "expected key=value, got " + token;
+      return false;
+    }
+    std::string key = token.substr(0, eq);
+    std::string value = token.substr(eq + 1);
+    int int_value = 0;
+    if (key == "vgpr" || key == "sgpr") {
+      if (!parse_int(value, int_value)) {
+        error = "invalid " + key + " value " + value;
+        return false;
+      }
+      (key == "vgpr" ? req.num_vgpr : req.num_sgpr) = int_value;
+    } else if (key == "mcpu") {
+      req.mcpu = value;
+    } else if (key == "stop-after") {
+      req.stop_after = value;
+    } else if (key == "verify") {
+      req.verify = value == "1";
+    } else if (key == "spill-sgpr-to-vgpr") {
+      req.spill_sgpr_to_vgpr = value == "1" ? 1 : 0;
+    } else if (key == "ir-out") {
+      req.ir_out = value;
+    } else if (key == "out") {
+      req.out = value;
+    } else if (key == "log") {
+      req.log = value;
+    } else if (key == "timeout-ms") {
+      if (!parse_int(value, req.timeout_ms)) {
+        error = "invalid timeout-ms value " + value;
+        return false;
+      }
+    } else {
+      error = "unknown compile key " + key;
+      return false;
+    }
+  }
+  return true;
+}
+
+static void set_reg_limits(llvm::Module &mod, int num_vgpr, int num_sgpr) {
+  for (llvm::Function &fn : mod) {
+    if (fn.isDeclaration()) {
+      continue;
+    }
+    if (num_vgpr >= 0) {
+      fn.addFnAttr("amdgpu-num-vgpr", std::to_string(num_vgpr));
+    }
+    if (num_sgpr >= 0) {
+      fn.addFnAttr("amdgpu-num-sgpr", std::to_string(num_sgpr));
+    }
+  }
+}
+
+// Codegen knobs such as -stop-after and -verify-machineinstrs only exist as
+// cl::opts, so each child parses them once from a pristine option state.
+static bool apply_codegen_flags(const ServerOptions &opts,
+                                const CompileRequest &req) {
+  std::vector<std::string> flags = {"compile_server"};
+  flags.insert(flags.end(), opts.llc_args.begin(), opts.llc_args.end());
+  if (!req.stop_after.empty()) {
+    flags.push_back("-stop-after=" + req.stop_after);
+  }
+  if (req.verify) {
+    flags.push_back("-verify-machineinstrs");
+  }
+  if (req.spill_sgpr_to_vgpr >= 0) {
+    flags.push_back("-amdgpu-spill-sgpr-to-vgpr=" +
+                    std::to_string(req.spill_sgpr_to_vgpr));
+  }
+  std::vector<const char *> argv;
+  for (const auto &flag : flags) {
+    argv.push_back(flag.c_str());
+  }
+  return llvm::cl::ParseCommandLineOptions(static_cast<int>(argv.size()),
+                                           argv.data(), "", &llvm::errs());
+}
+
+static int compile_in_child(const ServerOptions &opts, llvm::Module &mod,
+                            const CompileRequest &req) {
+  if (!apply_codegen_flags(opts, req)) {
+    return 2;
+  }
+  set_reg_limits(mod, req.num_vgpr, req.num_sgpr);
+
+  std::error_code ec;
+  if (!req.ir_out.empty()) {
+    llvm::raw_fd_ostream ir_os(req.ir_out, ec, llvm::sys::fs::OF_Text);
+    if (ec) {
+      llvm::errs() << "cannot open " << req.ir_out << ": " << ec.message()
+                   << "\n";
+      return 2;
+    }
+    mod.print(ir_os, nullptr);
+  }
+
+  std::string triple_name =
+      mod.getTargetTriple().empty() ? opts.mtriple : mod.getTargetTriple();
+  std::string error;
+  const llvm::Target *target =
+      llvm::TargetRegistry::lookupTarget(triple_name, error);
+  if (!target) {
+    llvm::errs() << error << "\n";
+    return 2;
+  }
+  const std::string &mcpu = req.mcpu.empty() ? opts.mcpu : req.mcpu;
+  llvm::TargetOptions target_opts =
+      llvm::codegen::InitTargetOptionsFromCodeGenFlags(
+          llvm::Triple(triple_name));
+  std::unique_ptr<llvm::TargetMachine> tm(target->createTargetMachine(
+      triple_name, mcpu, "", target_opts, llvm::Reloc::PIC_));
+  if (!tm) {
+    llvm::errs() << "cannot create target machine for " << triple_name
+                 << "\n";
+    return 2;
+  }
+  mod.setTargetTriple(triple_name);
+  mod.setDataLayout(tm->createDataLayout());
+
+  const std::string out_path = req.out.empty() ? "/dev/null" : req.out;
+  llvm::raw_fd_ostream out(out_path, ec, llvm::sys::fs::OF_None);
+  if (ec) {
+    llvm::errs() << "cannot open " << out_path << ": " << ec.message() << "\n";
+    return 2;
+  }
+  llvm::legacy::PassManager pm;
+  llvm::TargetLibraryInfoImpl tlii(llvm::Triple(mod.getTargetTriple()));
+  pm.add(new llvm::TargetLibraryInfoWrapperPass(tlii));
+  auto file_type = req.stop_after.empty() ? kObjectFile : kAssemblyFile;
+  if (tm->addPassesToEmitFile(pm, out, nullptr, file_type, false)) {
+    llvm::errs() << "target does not support emitting this file type\n";
+    return 2;
+  }
+  pm.run(mod);
+  out.close();
+  return out.has_error() ? 1 : 0;
+}
+
+// run_compile result for a child killed after timeout-ms.
+static constexpr int kTimedOut = -2;
+
+static int run_compile(const ServerOptions &opts, llvm::Module &mod,
+                       const CompileRequest &req) {
+  std::cout.flush();
+  pid_t pid = fork();
+  if (pid < 0) {
+    return -1;
+  }
+  if (pid == 0) {
+    if (!req.log.empty()) {
+      int fd = open(req.log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd >= 0) {
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+      }
+    }
+    // Keep the response channel clean if anything in LLVM writes to stdout.
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    int code = compile_in_child(opts, mod, req);
+    llvm::errs().flush();
+    _exit(code);
+  }
+  int status = 0;
+  if (req.timeout_ms > 0) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(req.timeout_ms);
+    pid_t done = 0;
+    while ((done = waitpid(pid, &status, WNOHANG)) == 0) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        return kTimedOut;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (done < 0) {
+      return -1;
+    }
+  } else if (waitpid(pid, &status, 0) < 0) {
+    return -1;
+  }
+  if (WIFSIGNALED(status)) {
+    return 128 + WTERMSIG(status);
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+static void initialize_llvm() {
+  llvm::InitializeAllTargetInfos();
+  llvm::InitializeAllTargets();
+  llvm::InitializeAllTargetMCs();
+  llvm::InitializeAllAsmPrinters();
+  llvm::PassRegistry &registry = *llvm::PassRegistry::getPassRegistry();
+  llvm::initializeCore(registry);
+  llvm::initializeCodeGen(registry);
+  llvm::initializeTarget(registry);
+}
+
+static llvm::codegen::RegisterCodeGenFlags codegen_flags;
+
+int main(int argc, char **argv) {
+  ServerOptions opts;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--mtriple" && i + 1 < argc) {
+      opts.mtriple = argv[++i];
+    } else if (arg == "--mcpu" && i + 1 < argc) {
+      opts.mcpu = argv[++i];
+    } else if (arg == "--llc-arg" && i + 1 < argc) {
+      opts.llc_args.push_back(argv[++i]);
+    } else {
+      std::cerr << "usage: compile_server [--mtriple T] [--mcpu CPU] "
+                   "[--llc-arg FLAG]...\n";
+      return 2;
+    }
+  }
+
+  initialize_llvm();
+  llvm::LLVMContext context;
+  std::unordered_map<std::string, std::unique_ptr<llvm::Module>> modules;
+
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    std::istringstream iss(line);
+    std::string cmd;
+    if (!(iss >> cmd)) {
+      continue;
+    }
+    if (cmd == "quit") {
+      std::cout << "ok" << std::endl;
+      break;
+    } else if (cmd == "load") {
+      std::string id;
+      std::string path;
+      if (!(iss >> id >> path)) {
+        std::cout << "error load requires <id> <path>" << std::endl;
+        continue;
+      }
+      llvm::SMDiagnostic diag;
+      std::unique_ptr<llvm::Module> mod =
+          llvm::parseIRFile(path, diag, context);
+      if (!mod) {
+        std::string message = diag.getMessage().str();
+        std::replace(message.begin(), message.end(), '\n', ' ');
+        std::cout << "error " << path << ":" << diag.getLineNo() << ": "
+                  << message << std::endl;
+        continue;
+      }
+      modules[id] = std::move(mod);
+      std::cout << "ok" << std::endl;
+    } else if (cmd == "unload") {
+      std::string id;
+      iss >> id;
+      modules.erase(id);
+      std::cout << "ok" << std::endl;
+    } else if (cmd == "compile") {
+      CompileRequest req;
+      std::string error;
+      if (!parse_compile_request(iss, req, error)) {
+        std::cout << "error " << error << std::endl;
+        continue;
+      }
+      auto it = modules.find(req.id);
+      if (it == modules.end()) {
+        std::cout << "error unknown module " << req.id << std::endl;
+        continue;
+      }
+      int code = run_compile(opts, *it->second, req);
+      if (code == kTimedOut) {
+        std::cout << "timeout" << std::endl;
+        continue;
+      }
+      if (code < 0) {
+        std::cout << "error fork failed" << std::endl;
+        continue;
+      }
+      std::cout << "result " << code << std::endl;
+    } else {
+      std::cout << "error unknown command " << cmd << std::endl;
+    }
+  }
+  return 0;
+}
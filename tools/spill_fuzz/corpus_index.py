@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""Build or refresh the spill_fuzz corpus feature index.
+
+Each corpus file is scanned once with a single multi-pattern pass. The index
+records which IR features the file uses, plus its size, mtime and content
+hash. spill_fuzz.py uses the index to sample only from inputs that the
+selected --mcpu can compile. A refresh only rescans files whose size or mtime
+changed.
+"""
+
+import argparse
+import hashlib
+import json
+import multiprocessing
+import os
+import re
+import sys
+from pathlib import Path
+from typing import Dict, FrozenSet, Iterable, List, Optional, Tuple
+
+INDEX_VERSION = 1
+
+# (feature, anchor, pattern). Every match of `pattern` starts with a match of
+# `anchor`. The anchors are combined into one alternation of short literals,
+# which the regex engine scans with a first-character prefilter; a feature's
+# full pattern is only tried where its anchor occurs.
+FEATURE_PATTERNS: List[Tuple[str, str, str]] = [
+    ("non-hsa-shader", r"amdgpu_", r"\bamdgpu_(ps|vs|gs|hs|es|ls|cs)\b"),
+    ("non-hsa-shader", r'"amdgpu-shader-type"', r'"amdgpu-shader-type"\s*=\s*"\w+"'),
+    ("non-hsa-shader", r"amdgpu_", r"\bamdgpu_cs_chain_func\b"),
+    ("wmma", r"llvm\.", r"\bllvm\.amdgcn\.wmma\."),
+    ("opencl-printf", r"llvm\.", r"\bllvm\.amdgcn\.printf\b"),
+    ("flat-atomic-fadd", r"llvm\.", r"\bllvm\.amdgcn\.flat\.atomic\.fadd\b"),
+    ("r600", r"llvm\.", r"\bllvm\.r600\."),
+    ("legacy-fma", r"llvm\.", r"\bllvm\.amdgcn\.fma\.legacy\b"),
+    ("code-object-version", r"CODE_OBJECT_VERSION", r"\bCODE_OBJECT_VERSION\b"),
+    ("dynamic-alloca", r"[aA][lL][lL][oO][cC][aA]", r"(?i:\balloca\b.*\baddrspace\(5\)\b)"),
+    ("smfmac", r"llvm\.", r"\bllvm\.amdgcn\.smfmac\."),
+    ("lds-gds-global", r"@", r"@[\w\.\$]+.*addrspace\((2|3)\)"),
+    ("non-kernel-define", r"define", r"^define\b(?!.*\bamdgpu_kernel\b)"),
+    ("mfma", r"llvm\.", r"\bllvm\.amdgcn\.mfma\."),
+    ("invalid-addrspacecast", r"[iI][nN][vV][aA][lL][iI][dD] ",
+     r"(?i:\binvalid addrspacecast\b)"),
+    ("amdgpu-gfx-cc", r"amdgpu_", r"\bamdgpu_gfx\b"),
+    ("fdot2", r"llvm\.", r"\bllvm\.amdgcn\.fdot2\."),
+    ("workgroup-attr-test", r"amdgpu-", r"\bamdgpu-max-num-workgroups\b"),
+    ("invalid-read-register", r"test_invalid_read_m0", r"\btest_invalid_read_m0\b"),
+    ("atomic-fmax", r"llvm\.", r"\bllvm\.amdgcn\.(raw_ptr_buffer_atomic_fmax|raw_buffer_atomic_fmax"
+                               r"|struct_ptr_buffer_atomic_fmax|struct_buffer_atomic_fmax"
+                               r"|image_atomic_fmax|flat_atomic_fmax|global_atomic_fmax)\b"),
+]
+
+FEATURES = frozenset(feature for feature, _, _ in FEATURE_PATTERNS)
+_ANCHORS: List[str] = []
+for _, _anchor, _ in FEATURE_PATTERNS:
+    if _anchor not in _ANCHORS:
+        _ANCHORS.append(_anchor)
+ANCHOR_RE = re.compile("|".join(f"(?P<a{i}>{anchor})" for i, anchor in enumerate(_ANCHORS)))
+# Anchor group name -> [(feature, compiled pattern)] to try at that anchor.
+ANCHOR_CANDIDATES: Dict[str, List[Tuple[str, "re.Pattern[str]"]]] = {
+    f"a{i}": [(feature, re.compile(pattern, re.MULTILINE))
+              for feature, a, pattern in FEATURE_PATTERNS if a == anchor]
+    for i, anchor in enumerate(_ANCHORS)
+}
+
+# (skip reason, required features, mcpu prefixes that support them, message).
+# A file is skipped by the first rule whose features are all present, unless
+# the mcpu starts with one of the listed prefixes.
+SKIP_RULES: List[Tuple[str, Tuple[str, ...], Tuple[str, ...], str]] = [
+    ("non-hsa-shader", ("non-hsa-shader",), (), "Skipping non-HSA shader module"),
+    ("wmma", ("wmma",), ("gfx11", "gfx12"), "Skipping WMMA module for mcpu {mcpu}"),
+    ("flat-atomic-fadd", ("flat-atomic-fadd",), ("gfx94", "gfx95"),
+     "Skipping flat atomic fadd module for mcpu {mcpu}"),
+    ("smfmac", ("smfmac",), ("gfx95",), "Skipping smfmac module for mcpu {mcpu}"),
+    ("mfma", ("mfma",), ("gfx90", "gfx94", "gfx95"), "Skipping mfma module for mcpu {mcpu}"),
+    ("opencl-printf", ("opencl-printf",), (), "Skipping OpenCL printf module"),
+    ("r600", ("r600",), (), "Skipping r600 intrinsic module"),
+    ("legacy-fma", ("legacy-fma",), (), "Skipping legacy fma intrinsic module"),
+    ("code-object-version", ("code-object-version",), (), "Skipping CODE_OBJECT_VERSION module"),
+    ("dynamic-alloca", ("dynamic-alloca",), (), "Skipping dynamic alloca module"),
+    ("lds-gds-non-kernel", ("lds-gds-global", "non-kernel-define"), (),
+     "Skipping LDS/GDS globals in non-kernel module"),
+    ("invalid-addrspacecast", ("invalid-addrspacecast",), (),
+     "Skipping invalid addrspacecast module"),
+    ("amdgpu-gfx-cc", ("amdgpu-gfx-cc",), (), "Skipping amdgpu_gfx calling convention module"),
+    ("fdot2", ("fdot2",), ("gfx94", "gfx95"), "Skipping fdot2 module for mcpu {mcpu}"),
+    ("workgroup-attr-test", ("workgroup-attr-test",), (),
+     "Skipping workgroup attribute error test module"),
+    ("invalid-read-register", ("invalid-read-register",), (),
+     "Skipping invalid read_register test module"),
+    ("atomic-fmax", ("atomic-fmax",), ("gfx10", "gfx11", "gfx94", "gfx95"),
+     "Skipping atomic fmax module for mcpu {mcpu}"),
+]
+
+
+def scan_features(ir_text: str) -> FrozenSet[str]:
+    found = set()
+    pos = 0
+    while len(found) < len(FEATURES):
+        anchor = ANCHOR_RE.search(ir_text, pos)
+        if anchor is None:
+            break
+        start = anchor.start()
+        for feature, pattern in ANCHOR_CANDIDATES[anchor.lastgroup]:
+            if feature not in found and pattern.match(ir_text, start):
+                found.add(feature)
+        # Anchors may overlap (e.g. "amdgpu-" inside "amdgpu-shader-type"),
+        # so resume right after the anchor start rather than its end.
+        pos = start + 1
+    return frozenset(found)
+
+
+def find_skip_rule(features: Iterable[str], mcpu: str) -> Optional[Tuple[str, str]]:
+    """Return (reason, message) for the first rule that rejects the file on mcpu."""
+    features = set(features)
+    for reason, required, supported_on, message in SKIP_RULES:
+        if not all(f in features for f in required):
+            continue
+        if any(mcpu.startswith(prefix) for prefix in supported_on):
+            continue
+        return reason, message.format(mcpu=mcpu)
+    return None
+
+
+def scan_file(path: str) -> Tuple[str, str, List[str]]:
+    data = Path(path).read_bytes()
+    digest = hashlib.sha256(data).hexdigest()
+    features = scan_features(data.decode("utf-8", errors="replace"))
+    return path, digest, sorted(features)
+
+
+def load_index(index_path: Path) -> Dict[str, dict]:
+    try:
+        data = json.loads(index_path.read_text(encoding="utf-8"))
+    except (OSError, ValueError):
+        return {}
+    if data.get("version") != INDEX_VERSION:
+        return {}
+    return data.get("files", {})
+
+
+def save_index(index_path: Path, files: Dict[str, dict]) -> None:
+    index_path.parent.mkdir(parents=True, exist_ok=True)
+    tmp_path = index_path.with_name(index_path.name + f".tmp{os.getpid()}")
+    tmp_path.write_text(json.dumps({"version": INDEX_VERSION, "files": files},
+                                   indent=1, sort_keys=True) + "\n", encoding="utf-8")
+    os.replace(tmp_path, index_path)
+
+
+def update_index(index_path: Path, inputs: List[Path], jobs: int = 1) -> Tuple[Dict[str, dict], int]:
+    """Bring the index up to date for `inputs` and return (entries, rescanned).
+
+    Files whose size and mtime match the stored entry are not read. Entries for
+    files that are no longer in `inputs` are dropped.
+    """
+    old = load_index(index_path)
+    files: Dict[str, dict] = {}
+    stale: List[str] = []
+    stats: Dict[str, os.stat_result] = {}
+    for path in inputs:
+        key = str(path.resolve())
+        st = path.stat()
+        stats[key] = st
+        entry = old.get(key)
+        if entry is not None and entry["mtime_ns"] == st.st_mtime_ns and entry["size"] == st.st_size:
+            files[key] = entry
+        else:
+            stale.append(key)
+
+    if jobs > 1 and len(stale) > 1:
+        with multiprocessing.Pool(min(jobs, len(stale))) as pool:
+            scanned = pool.map(scan_file, stale, chunksize=max(1, len(stale) // (jobs * 4)))
+    else:
+        scanned = [scan_file(key) for key in stale]
+
+    for key, digest, features in scanned:
+        st = stats[key]
+        files[key] = {
+            "mtime_ns": st.st_mtime_ns,
+            "size": st.st_size,
+            "sha256": digest,
+            "features": features,
+        }
+    if stale or len(files) != len(old):
+        save_index(index_path, files)
+    return files, len(stale)
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--corpus", required=True, help="Directory with .ll files")
+    parser.add_argument("--index", required=True, help="Index JSON path")
+    parser.add_argument("--mcpu", default=None,
+                        help="Also report how many inputs are usable on this mcpu")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1)
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    inputs = sorted(p for p in Path(args.corpus).rglob("*.ll") if p.is_file())
+    files, rescanned = update_index(Path(args.index), inputs, args.jobs)
+    sys.stdout.write(f"indexed {len(files)} files ({rescanned} rescanned)\n")
+    if args.mcpu:
+        usable = sum(1 for e in files.values() if find_skip_rule(e["features"], args.mcpu) is None)
+        sys.stdout.write(f"{usable} usable on {args.mcpu}\n")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,423 @@
+// Host-only stand-in for the subset of the HIP runtime used by hip_runner.
+//
+// Built with -DHIP_RUNNER_FAKE_BACKEND (HIP_RUNNER_BACKEND=fake
+// ./build_hip_runner.sh) so the runner, its server protocol and its module and
+// buffer caches can be exercised on machines without a GPU. Device memory is
+// host memory. A "code object" is any file; hipModuleGetFunction succeeds if
+// the kernel name occurs in it. A launch applies a fixed byte transform to
+// every device range uploaded to since the previous launch, so two launches
+// from the same inputs agree, unless the code object contains one of these
+// markers. Work runs in order at the time it is queued, whatever the stream.
+//
+//   spill-fuzz-fake:mismatch   also flip the first byte of every range
+//   spill-fuzz-fake:odd        the same, only for ranges whose first input
+//                              byte is odd (a data-dependent bug)
+//   spill-fuzz-fake:overrun    also write one byte past every range
+//   spill-fuzz-fake:fault      fail the launch
+//   spill-fuzz-fake:hang       never complete; events stay not-ready
+//   spill-fuzz-fake:slow       take 2 ms per launch instead of no time
+//   spill-fuzz-fake:crash      abort the process, as the real runtime does on
+//                              a GPU memory fault
+//   spill-fuzz-fake:write@O=H  then overwrite bytes O.. of every range that
+//                              holds them with the hex bytes H; repeatable,
+//                              to plant chosen output values
+//
+// Events record the host time at which they are queued, so with work done at
+// queue time, hipEventElapsedTime measures the launches in between.
+//
+// HIP_RUNNER_FAKE_DEVICES=N makes N devices visible (default 1). Memory,
+// streams and modules belong to the device current when they were created,
+// and a launch or copy that mixes devices fails, as it would on real GPUs
+// without peer access, so lane placement is checked without a second GPU.
+// HIP_RUNNER_FAKE_NO_MEMORY=1 makes every hipMalloc fail, a runtime error
+// outside kernel execution.
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum hipError_t {
+  hipSuccess = 0,
+  hipErrorInvalidValue = 1,
+  hipErrorInvalidDevice = 101,
+  hipErrorOutOfMemory = 2,
+  hipErrorFileNotFound = 301,
+  hipErrorNotFound = 500,
+  hipErrorNotReady = 600,
+  hipErrorLaunchFailure = 719,
+};
+
+enum hipMemcpyKind {
+  hipMemcpyHostToDevice = 1,
+  hipMemcpyDeviceToHost = 2,
+};
+
+static constexpr unsigned hipEventDisableTiming = 0x2;
+static constexpr unsigned hipStreamNonBlocking = 0x1;
+
+#define __host__
+#define __device__
+
+struct dim3 {
+  uint32_t x, y, z;
+  constexpr dim3(uint32_t vx = 1, uint32_t vy = 1, uint32_t vz = 1)
+      : x(vx), y(vy), z(vz) {}
+};
+
+struct FakeModule {
+  std::string image;
+  int device = 0;
+};
+
+struct FakeFunction {
+  FakeModule *module = nullptr;
+  std::string name;
+};
+
+struct FakeEvent {
+  bool hung = false;
+  std::chrono::steady_clock::time_point recorded;
+};
+
+struct FakeStream {
+  int device = 0;
+};
+
+using hipModule_t = FakeModule *;
+using hipFunction_t = FakeFunction *;
+using hipEvent_t = FakeEvent *;
+using hipStream_t = FakeStream *;
+
+// Shared by every mock device; allocations record their owner.
+struct FakeDevice {
+  std::map<void *, size_t> allocations;
+  std::map<void *, int> owner;
+  int current = 0;
+  std::map<std::string, FakeFunction> functions;
+  // Ranges written by host-to-device copies, i.e. the next launch's
+  // arguments.
+  std::vector<std::pair<uint8_t *, size_t>> uploaded;
+  bool hung = false;
+};
+
+inline FakeDevice &fake_device() {
+  static FakeDevice device;
+  return device;
+}
+
+inline hipError_t hipGetDeviceCount(int *count) {
+  const char *env = std::getenv("HIP_RUNNER_FAKE_DEVICES");
+  *count = env != nullptr ? std::max(1, std::atoi(env)) : 1;
+  return hipSuccess;
+}
+
+inline hipError_t hipSetDevice(int device) {
+  int count = 0;
+  hipGetDeviceCount(&count);
+  if (device < 0 || device >= count) {
+    return hipErrorInvalidDevice;
+  }
+  fake_device().current = device;
+  return hipSuccess;
+}
+
+inline hipError_t hipGetDevice(int *device) {
+  *device = fake_device().current;
+  return hipSuccess;
+}
+
+inline hipError_t hipMalloc(void **ptr, size_t size) {
+  if (std::getenv("HIP_RUNNER_FAKE_NO_MEMORY") != nullptr) {
+    return hipErrorOutOfMemory;
+  }
+  *ptr = std::malloc(size ? size : 1);
+  if (*ptr == nullptr) {
+    return hipErrorOutOfMemory;
+  }
+  FakeDevice &device = fake_device();
+  device.allocations[*ptr] = size;
+  device.owner[*ptr] = device.current;
+  return hipSuccess;
+}
+
+inline hipError_t hipFree(void *ptr) {
+  FakeDevice &device = fake_device();
+  auto found = device.allocations.find(ptr);
+  if (found == device.allocations.end()) {
+    return hipErrorInvalidValue;
+  }
+  auto *begin = static_cast<uint8_t *>(ptr);
+  auto *end = begin + found->second;
+  auto &uploaded = device.uploaded;
+  for (auto it = uploaded.begin(); it != uploaded.end();) {
+    it = it->first >= begin && it->first < end ? uploaded.erase(it)
+                                               : std::next(it);
+  }
+  device.allocations.erase(found);
+  device.owner.erase(ptr);
+  std::free(ptr);
+  return hipSuccess;
+}
+
+// The allocation holding `ptr`, or allocations.end().
+inline std::map<void *, size_t>::iterator fake_allocation(const void *ptr) {
+  auto &allocations = fake_device().allocations;
+  auto it = allocations.upper_bound(const_cast<void *>(ptr));
+  if (it == allocations.begin()) {
+    return allocations.end();
+  }
+  --it;
+  auto *begin = static_cast<const uint8_t *>(it->first);
+  return static_cast<const uint8_t *>(ptr) < begin + it->second
+             ? it
+             : allocations.end();
+}
+
+// Whether `ptr` is host memory or memory of `device`.
+inline bool fake_on_device(const void *ptr, int device) {
+  FakeDevice &fake = fake_device();
+  auto it = fake_allocation(ptr);
+  return it == fake.allocations.end() || fake.owner[it->first] == device;
+}
+
+inline hipError_t hipHostMalloc(void **ptr, size_t size, unsigned) {
+  *ptr = std::malloc(size ? size : 1);
+  return *ptr == nullptr ? hipErrorOutOfMemory : hipSuccess;
+}
+
+inline hipError_t hipHostFree(void *ptr) {
+  std::free(ptr);
+  return hipSuccess;
+}
+
+static constexpr unsigned hipHostRegisterDefault = 0x0;
+
+// Host memory needs no pinning here; registration always succeeds.
+inline hipError_t hipHostRegister(void *, size_t, unsigned) {
+  return hipSuccess;
+}
+
+inline hipError_t hipHostUnregister(void *) { return hipSuccess; }
+
+inline hipError_t hipGetLastError() { return hipSuccess; }
+
+inline hipError_t hipMemcpy(void *dst, const void *src, size_t size,
+                            hipMemcpyKind kind) {
+  std::memcpy(dst, src, size);
+  FakeDevice &device = fake_device();
+  if (kind == hipMemcpyHostToDevice &&
+      fake_allocation(dst) != device.allocations.end()) {
+    device.uploaded.emplace_back(static_cast<uint8_t *>(dst), size);
+  }
+  return hipSuccess;
+}
+
+inline hipError_t hipMemcpyAsync(void *dst, const void *src, size_t size,
+                                 hipMemcpyKind kind, hipStream_t stream) {
+  if (!fake_on_device(dst, stream->device) ||
+      !fake_on_device(src, stream->device)) {
+    return hipErrorInvalidValue;
+  }
+  return hipMemcpy(dst, src, size, kind);
+}
+
+inline hipError_t hipMemsetAsync(void *dst, int value, size_t size,
+                                 hipStream_t stream) {
+  if (!fake_on_device(dst, stream->device)) {
+    return hipErrorInvalidValue;
+  }
+  std::memset(dst, value, size);
+  return hipSuccess;
+}
+
+inline hipError_t hipStreamCreateWithFlags(hipStream_t *stream, unsigned) {
+  *stream = new FakeStream{fake_device().current};
+  return hipSuccess;
+}
+
+inline hipError_t hipStreamDestroy(hipStream_t stream) {
+  delete stream;
+  return hipSuccess;
+}
+
+inline hipError_t hipModuleLoad(hipModule_t *module, const char *path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return hipErrorFileNotFound;
+  }
+  *module = new FakeModule{std::string(std::istreambuf_iterator<char>(in),
+                                       std::istreambuf_iterator<char>()),
+                           fake_device().current};
+  return hipSuccess;
+}
+
+inline hipError_t hipModuleUnload(hipModule_t module) {
+  auto &functions = fake_device().functions;
+  for (auto it = functions.begin(); it != functions.end();) {
+    it = it->second.module == module ? functions.erase(it) : std::next(it);
+  }
+  delete module;
+  return hipSuccess;
+}
+
+inline hipError_t hipModuleGetFunction(hipFunction_t *func, hipModule_t module,
+                                       const char *name) {
+  if (module->image.find(name) == std::string::npos) {
+    return hipErrorNotFound;
+  }
+  std::string key = std::to_string(reinterpret_cast<uintptr_t>(module)) + ":" +
+                    name;
+  FakeFunction &entry = fake_device().functions[key];
+  entry.module = module;
+  entry.name = name;
+  *func = &entry;
+  return hipSuccess;
+}
+
+// The spill-fuzz-fake:write@O=H markers of a code object, as (O, bytes).
+inline std::vector<std::pair<size_t, std::vector<uint8_t>>>
+fake_writes(const std::string &image) {
+  static const std::string kMarker = "spill-fuzz-fake:write@";
+  std::vector<std::pair<size_t, std::vector<uint8_t>>> writes;
+  for (size_t at = image.find(kMarker); at != std::string::npos;
+       at = image.find(kMarker, at + 1)) {
+    const char *text = image.c_str() + at + kMarker.size();
+    char *end = nullptr;
+    size_t offset = std::strtoull(text, &end, 10);
+    if (end == text || *end != '=') {
+      continue;
+    }
+    std::vector<uint8_t> bytes;
+    for (const char *h = end + 1;
+         std::isxdigit(static_cast<unsigned char>(h[0])) &&
+         std::isxdigit(static_cast<unsigned char>(h[1]));
+         h += 2) {
+      bytes.push_back(
+          static_cast<uint8_t>(std::stoul(std::string(h, 2), nullptr, 16)));
+    }
+    writes.emplace_back(offset, std::move(bytes));
+  }
+  return writes;
+}
+
+inline hipError_t hipModuleLaunchKernel(hipFunction_t func, uint32_t, uint32_t,
+                                        uint32_t, uint32_t, uint32_t, uint32_t,
+                                        uint32_t, hipStream_t stream, void **,
+                                        void **) {
+  FakeDevice &device = fake_device();
+  if (func->module->device != stream->device) {
+    return hipErrorInvalidDevice;
+  }
+  const std::string &image = func->module->image;
+  if (image.find("spill-fuzz-fake:fault") != std::string::npos) {
+    return hipErrorLaunchFailure;
+  }
+  if (image.find("spill-fuzz-fake:crash") != std::string::npos) {
+    std::fprintf(stderr, "Memory access fault by GPU (fake runtime)\n");
+    std::abort();
+  }
+  if (image.find("spill-fuzz-fake:hang") != std::string::npos) {
+    device.hung = true;
+    return hipSuccess;
+  }
+  bool corrupt = image.find("spill-fuzz-fake:mismatch") != std::string::npos;
+  bool odd = image.find("spill-fuzz-fake:odd") != std::string::npos;
+  bool overrun = image.find("spill-fuzz-fake:overrun") != std::string::npos;
+  auto writes = fake_writes(image);
+  if (image.find("spill-fuzz-fake:slow") != std::string::npos) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  for (const auto &range : device.uploaded) {
+    uint8_t *bytes = range.first;
+    size_t size = range.second;
+    bool flip = size > 0 && (corrupt || (odd && (bytes[0] & 1) != 0));
+    for (size_t i = 0; i < size; ++i) {
+      bytes[i] = static_cast<uint8_t>(bytes[i] * 5 + 1);
+    }
+    if (flip) {
+      bytes[0] ^= 0xFF;
+    }
+    for (const auto &write : writes) {
+      if (write.first + write.second.size() <= size) {
+        std::copy(write.second.begin(), write.second.end(),
+                  bytes + write.first);
+      }
+    }
+    // Only inside the allocation, so the fake itself never writes out of
+    // bounds.
+    auto holder = fake_allocation(bytes);
+    if (overrun && static_cast<uint8_t *>(holder->first) + holder->second >
+                       bytes + size) {
+      bytes[size] ^= 0xFF;
+    }
+  }
+  device.uploaded.clear();
+  return hipSuccess;
+}
+
+inline hipError_t hipDeviceSynchronize() {
+  while (fake_device().hung) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+  }
+  return hipSuccess;
+}
+
+inline hipError_t hipEventCreateWithFlags(hipEvent_t *event, unsigned) {
+  *event = new FakeEvent;
+  return hipSuccess;
+}
+
+inline hipError_t hipEventCreate(hipEvent_t *event) {
+  return hipEventCreateWithFlags(event, 0);
+}
+
+inline hipError_t hipEventRecord(hipEvent_t event, hipStream_t) {
+  event->hung = fake_device().hung;
+  event->recorded = std::chrono::steady_clock::now();
+  return hipSuccess;
+}
+
+inline hipError_t hipEventElapsedTime(float *ms, hipEvent_t start,
+                                      hipEvent_t stop) {
+  if (start->hung || stop->hung) {
+    return hipErrorNotReady;
+  }
+  *ms = std::chrono::duration<float, std::milli>(stop->recorded -
+                                                 start->recorded)
+            .count();
+  return hipSuccess;
+}
+
+inline hipError_t hipEventQuery(hipEvent_t event) {
+  return event->hung ? hipErrorNotReady : hipSuccess;
+}
+
+inline hipError_t hipStreamWaitEvent(hipStream_t, hipEvent_t, unsigned) {
+  return hipSuccess;
+}
+
+inline hipError_t hipEventSynchronize(hipEvent_t event) {
+  while (event->hung) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+  }
+  return hipSuccess;
+}
+
+inline hipError_t hipEventDestroy(hipEvent_t event) {
+  delete event;
+  return hipSuccess;
+}
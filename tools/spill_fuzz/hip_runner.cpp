@@ -1,17 +1,70 @@
 // Simple HIP runner for differential HSACO execution.
+//
+// Runs one test per invocation, or with --serve stays up and answers test
+// requests from a local socket (or stdin/stdout), keeping the HIP runtime,
+// device buffers and recently loaded modules warm between them; with
+// --zygote the tests run in a forked worker, so a kernel that crashes the
+// runtime takes down only the worker. --connect sends the test to such a
+// server instead of running it in-process.
+// --emit-spec writes the kernel spec for a code object from its metadata
+// note, without starting the HIP runtime.
 
+#ifdef HIP_RUNNER_FAKE_BACKEND
+#include "hip_fake_runtime.h"
+#else
 #include <hip/hip_runtime.h>
+#endif
+
+#include "amdgpu_metadata.h"
+#include "input_generators.h"
+#include "output_compare.h"
+#include "philox.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
-#include <random>
+#include <iterator>
+#include <limits>
+#include <list>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+// Exit status for a kernel that did not finish within --timeout-ms; the same
+// code timeout(1) uses, which spill_fuzz.py classifies as a hang.
+static constexpr int kTimeoutExitCode = 124;
+
+// Exit status for a HIP runtime failure outside kernel execution (selecting
+// the device, allocating buffers or streams, queueing the uploads, starting a
+// server worker). It says nothing about the code under test, and
+// spill_fuzz.py counts it against the device.
+static constexpr int kDeviceErrorExitCode = 125;
+
+// Connection a --serve server is answering; a kernel timeout is reported
+// there before the process exits.
+static int g_reply_fd = -1;
+static bool write_response(int fd, int status, const std::string &message);
+
 struct ArgSpec {
   std::string kind;
   size_t size = 0;
@@ -19,11 +72,13 @@ struct ArgSpec {
 };
 
 struct BufferArg {
+  size_t arg_index = 0;
   size_t size = 0;
-  std::vector<uint8_t> init;
-  std::vector<uint8_t> out_a;
-  std::vector<uint8_t> out_b;
-  void *device_ptr = nullptr;
+  // Initial contents, in pinned host memory owned by RunnerState: a staging
+  // buffer, or a mapped file region.
+  const uint8_t *init = nullptr;
+  // How the reference and test outputs are compared.
+  CompareSpec compare;
 };
 
 struct LaunchDims {
@@ -38,6 +93,14 @@ struct ValueOverride {
   std::vector<uint8_t> bytes;
 };
 
+// A global_buffer bound to bytes [offset, offset + length) of a file; a
+// length of 0 means to the end of the file.
+struct FileRegion {
+  std::string path;
+  uint64_t offset = 0;
+  uint64_t length = 0;
+};
+
 struct InputSpec {
   bool has_seed = false;
   uint32_t seed = 12345;
@@ -45,6 +108,13 @@ struct InputSpec {
   LaunchDims launch;
   std::unordered_map<size_t, size_t> buffer_sizes;
   std::unordered_map<size_t, ValueOverride> values;
+  // Per-buffer comparison rules; `compare *` sets the default.
+  CompareSpec default_compare;
+  std::unordered_map<size_t, CompareSpec> compares;
+  // Typed generators replacing random bytes, by argument index.
+  std::unordered_map<size_t, InputGenerator> generators;
+  // Buffers read from captured data instead of generated.
+  std::unordered_map<size_t, FileRegion> files;
 };
 
 static bool load_spec(const std::string &path, std::string &kernel,
@@ -68,6 +138,89 @@ static bool load_spec(const std::string &path, std::string &kernel,
   return !kernel.empty();
 }
 
+static bool arg_kind_supported(const std::string &kind) {
+  return kind == "global_buffer" || kind == "by_value" || kind == "value";
+}
+
+// Pick the kernel to test: the first one (named `name`, if given) with at
+// least one explicit argument and only argument kinds the runner can fill.
+// Hidden arguments are left to the HIP runtime.
+static const KernelMetadata *
+select_kernel(const std::vector<KernelMetadata> &kernels,
+              const std::string &name) {
+  for (const auto &kernel : kernels) {
+    if (!name.empty() && kernel.name != name) {
+      continue;
+    }
+    size_t explicit_args = 0;
+    bool supported = true;
+    for (const auto &arg : kernel.args) {
+      if (arg.hidden()) {
+        continue;
+      }
+      ++explicit_args;
+      supported = supported && arg_kind_supported(arg.value_kind);
+    }
+    if (explicit_args != 0 && supported) {
+      return &kernel;
+    }
+  }
+  return nullptr;
+}
+
+// Write the kernel spec for `hsaco`, in the format load_spec reads. Returns
+// 0, 3 when no kernel is compatible (the input is skipped), or 2 when the
+// metadata cannot be read.
+static int emit_spec(const std::string &hsaco, const std::string &kernel_name,
+                     const std::string &out_path) {
+  std::vector<KernelMetadata> kernels;
+  std::string error;
+  if (!read_code_object_metadata(hsaco, kernels, error)) {
+    std::cerr << hsaco << ": " << error << "\n";
+    return 2;
+  }
+  const KernelMetadata *kernel = select_kernel(kernels, kernel_name);
+  if (kernel == nullptr) {
+    return 3;
+  }
+  std::ofstream out(out_path);
+  out << "kernel " << kernel->name << "\n";
+  for (const auto &arg : kernel->args) {
+    if (!arg.hidden()) {
+      out << "arg " << arg.value_kind << " " << arg.size << " "
+          << (arg.address_space.empty() ? "unknown" : arg.address_space)
+          << "\n";
+    }
+  }
+  out.close();
+  if (!out) {
+    std::cerr << "cannot write " << out_path << "\n";
+    return 2;
+  }
+  return 0;
+}
+
+// Print every kernel's full argument layout, hidden arguments included.
+static int dump_metadata(const std::string &hsaco) {
+  std::vector<KernelMetadata> kernels;
+  std::string error;
+  if (!read_code_object_metadata(hsaco, kernels, error)) {
+    std::cerr << hsaco << ": " << error << "\n";
+    return 2;
+  }
+  for (const auto &kernel : kernels) {
+    std::cout << "kernel " << kernel.name << " symbol " << kernel.symbol
+              << " kernarg_size " << kernel.kernarg_segment_size << "\n";
+    for (const auto &arg : kernel.args) {
+      std::cout << "  offset " << arg.offset << " size " << arg.size << " "
+                << arg.value_kind
+                << (arg.address_space.empty() ? "" : " " + arg.address_space)
+                << (arg.name.empty() ? "" : " " + arg.name) << "\n";
+    }
+  }
+  return 0;
+}
+
 static bool parse_hex_bytes(const std::string &hex_in,
                             std::vector<uint8_t> &out) {
   std::string hex = hex_in;
@@ -87,6 +240,97 @@ static bool parse_hex_bytes(const std::string &hex_in,
   return true;
 }
 
+// Parse a `range` bound that must fit `type`, as two's complement for the
+// signed types. std::stoull alone would take "-1" as ULLONG_MAX and a u32
+// bound of 4000000000 as valid for i32.
+static bool parse_range_bound(const std::string &text, ElementType type,
+                              uint64_t &out) {
+  unsigned bits = static_cast<unsigned>(element_size(type) * 8);
+  size_t end = 0;
+  try {
+    if (type == ElementType::kI32 || type == ElementType::kI64) {
+      long long value = std::stoll(text, &end);
+      long long max = bits == 64 ? std::numeric_limits<long long>::max()
+                                 : (1LL << (bits - 1)) - 1;
+      if (value < -max - 1 || value > max) {
+        return false;
+      }
+      out = static_cast<uint64_t>(value);
+    } else {
+      if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+        return false;
+      }
+      unsigned long long value = std::stoull(text, &end);
+      if (bits < 64 && value >> bits != 0) {
+        return false;
+      }
+      out = value;
+    }
+  } catch (const std::exception &) {
+    return false;
+  }
+  return end == text.size();
+}
+
+// Parse the rest of a `gen <index> <type> <kind> ...` line after the index.
+static bool parse_generator(std::istringstream &iss, InputGenerator &gen) {
+  std::string type, kind;
+  if (!(iss >> type >> kind) || !parse_element_type(type, gen.type)) {
+    return false;
+  }
+  bool is_float = element_type_is_float(gen.type);
+  if (kind == "uniform" && is_float) {
+    gen.kind = InputGenerator::Kind::kUniform;
+    if (!(iss >> gen.lo >> gen.hi) || !(gen.lo <= gen.hi)) {
+      return false;
+    }
+  } else if (kind == "positive" && is_float) {
+    gen.kind = InputGenerator::Kind::kPositive;
+    if (!(iss >> gen.lo >> gen.hi) || !(gen.lo > 0 && gen.lo <= gen.hi)) {
+      return false;
+    }
+  } else if (kind == "simplex" && is_float) {
+    gen.kind = InputGenerator::Kind::kSimplex;
+    if (!(iss >> gen.group) || gen.group == 0) {
+      return false;
+    }
+  } else if (kind == "range" && !is_float) {
+    gen.kind = InputGenerator::Kind::kRange;
+    std::string lo, hi;
+    if (!(iss >> lo >> hi)) {
+      return false;
+    }
+    if (!parse_range_bound(lo, gen.type, gen.int_lo) ||
+        !parse_range_bound(hi, gen.type, gen.int_hi)) {
+      return false;
+    }
+    bool is_signed =
+        gen.type == ElementType::kI32 || gen.type == ElementType::kI64;
+    if (is_signed ? static_cast<int64_t>(gen.int_lo) >
+                        static_cast<int64_t>(gen.int_hi)
+                  : gen.int_lo > gen.int_hi) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  std::string key;
+  while (iss >> key) {
+    double rate = 0.0;
+    if (!is_float || !(iss >> rate) || !(rate >= 0.0 && rate <= 1.0)) {
+      return false;
+    }
+    if (key == "nan") {
+      gen.nan_rate = rate;
+    } else if (key == "inf") {
+      gen.inf_rate = rate;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
 static bool parse_input_spec(const std::string &path, InputSpec &spec) {
   std::ifstream in(path);
   if (!in) {
@@ -175,6 +419,53 @@ static bool parse_input_spec(const std::string &path, InputSpec &spec) {
         return false;
       }
       spec.values[index] = std::move(ov);
+    } else if (tag == "gen") {
+      size_t index = 0;
+      InputGenerator gen;
+      if (!(iss >> index) || !parse_generator(iss, gen)) {
+        std::cerr << "invalid gen at line " << line_no << "\n";
+        return false;
+      }
+      spec.generators[index] = gen;
+    } else if (tag == "file") {
+      size_t index = 0;
+      FileRegion region;
+      if (!(iss >> index >> region.offset >> region.length) ||
+          !std::getline(iss >> std::ws, region.path) || region.path.empty()) {
+        std::cerr << "invalid file at line " << line_no << "\n";
+        return false;
+      }
+      spec.files[index] = region;
+    } else if (tag == "compare") {
+      std::string index, type, mode;
+      CompareSpec cmp;
+      if (!(iss >> index >> type >> mode) ||
+          !parse_element_type(type, cmp.type)) {
+        std::cerr << "invalid compare at line " << line_no << "\n";
+        return false;
+      }
+      if (mode == "exact") {
+        cmp.mode = CompareSpec::Mode::kExact;
+      } else if (mode == "ulp" && (iss >> cmp.max_ulp)) {
+        cmp.mode = CompareSpec::Mode::kUlp;
+      } else if (mode == "tol" && (iss >> cmp.rtol >> cmp.atol) &&
+                 cmp.rtol >= 0 && cmp.atol >= 0) {
+        cmp.mode = CompareSpec::Mode::kTolerance;
+      } else {
+        std::cerr << "invalid compare mode at line " << line_no << "\n";
+        return false;
+      }
+      if (index == "*") {
+        spec.default_compare = cmp;
+      } else {
+        char *end = nullptr;
+        unsigned long value = std::strtoul(index.c_str(), &end, 10);
+        if (index.empty() || *end != '\0') {
+          std::cerr << "invalid compare index at line " << line_no << "\n";
+          return false;
+        }
+        spec.compares[value] = cmp;
+      }
     } else {
       std::cerr << "unknown input spec tag at line " << line_no << "\n";
       return false;
@@ -183,12 +474,6 @@ static bool parse_input_spec(const std::string &path, InputSpec &spec) {
   return true;
 }
 
-static void fill_random(std::vector<uint8_t> &data, std::mt19937 &rng) {
-  std::uniform_int_distribution<int> dist(0, 255);
-  for (auto &b : data)
-    b = static_cast<uint8_t>(dist(rng));
-}
-
 static bool apply_value_override(const ArgSpec &arg, size_t index,
                                  const InputSpec &spec,
                                  std::vector<uint8_t> &data,
@@ -218,228 +503,2090 @@ static bool apply_value_override(const ArgSpec &arg, size_t index,
   return true;
 }
 
-static bool run_kernel(hipFunction_t func, const std::vector<ArgSpec> &args,
-                       std::vector<BufferArg> &buffers,
-                       const std::vector<std::vector<uint8_t>> &by_value,
-                       const std::vector<void *> &param_values,
-                       const LaunchDims &launch) {
-  std::vector<void *> params = param_values;
-  size_t buffer_index = 0;
+struct RunRequest {
+  std::string hsaco_a;
+  // Test variants, each compared against the single reference run.
+  std::vector<std::string> hsaco_b;
+  std::string spec_path;
+  std::string input_spec_path;
+  size_t buffer_size = 4096;
+  unsigned timeout_ms = 0;
+  // Compare outputs on the device instead of reading both copies back.
+  bool device_compare = false;
+  // --seeds: run seed_first .. seed_first + seed_count - 1. With a count of
+  // 0 the input spec seed (or the default) is used once.
+  uint32_t seed_first = 0;
+  uint32_t seed_count = 0;
+  // Canary bytes after every device buffer, checked after each run.
+  uint32_t guard_bytes = 0;
+  // --time-reps: after the comparison, time the reference and each matching
+  // variant over time_warmup untimed and time_reps timed launches.
+  uint32_t time_reps = 0;
+  uint32_t time_warmup = 3;
+};
 
-  for (const auto &arg : args) {
-    if (arg.kind != "global_buffer")
-      continue;
-    BufferArg &buf = buffers[buffer_index++];
-    if (hipMemcpy(buf.device_ptr, buf.init.data(), buf.size,
-                  hipMemcpyHostToDevice) != hipSuccess) {
+static uint64_t fnv1a(const std::string &data) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : data) {
+    hash = (hash ^ c) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// Loaded code objects keyed by device and content, so the cached reference
+// and repeated test objects stay loaded across server requests whatever
+// their paths.
+class ModuleCache {
+public:
+  explicit ModuleCache(size_t capacity) : capacity_(std::max<size_t>(2, capacity)) {}
+  ~ModuleCache() { clear(); }
+
+  // Modules belong to one device; `device` is loaded into if need be.
+  bool get(const std::string &path, int device, hipModule_t &module) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
       return false;
     }
+    std::string image((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    std::string key = std::to_string(device) + ":" +
+                      std::to_string(image.size()) + ":" +
+                      std::to_string(fnv1a(image));
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      module = it->second->second;
+      ++hits_;
+      return true;
+    }
+    if (hipSetDevice(device) != hipSuccess ||
+        hipModuleLoad(&module, path.c_str()) != hipSuccess) {
+      return false;
+    }
+    ++misses_;
+    lru_.emplace_front(key, module);
+    index_[key] = lru_.begin();
+    while (lru_.size() > capacity_) {
+      hipModuleUnload(lru_.back().second);
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+    }
+    return true;
   }
 
-  hipError_t err = hipModuleLaunchKernel(
-      func, launch.grid.x, launch.grid.y, launch.grid.z, launch.block.x,
-      launch.block.y, launch.block.z, 0, nullptr, params.data(), nullptr);
-  if (err != hipSuccess) {
-    return false;
+  void clear() {
+    for (auto &entry : lru_) {
+      hipModuleUnload(entry.second);
+    }
+    lru_.clear();
+    index_.clear();
   }
 
-  if (hipDeviceSynchronize() != hipSuccess) {
-    return false;
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+private:
+  using Entry = std::pair<std::string, hipModule_t>;
+  size_t capacity_;
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+// Pinned staging and readback allocations, and small device allocations,
+// indexed by (lane, slot), grown on demand and kept for later requests.
+class BufferPool {
+public:
+  explicit BufferPool(bool pinned_host) : pinned_host_(pinned_host) {}
+  ~BufferPool() { clear(); }
+
+  void *acquire(size_t lane, size_t slot, size_t size) {
+    if (lane >= lanes_.size()) {
+      lanes_.resize(lane + 1);
+    }
+    std::vector<Slot> &slots = lanes_[lane];
+    if (slot >= slots.size()) {
+      slots.resize(slot + 1);
+    }
+    Slot &s = slots[slot];
+    if (s.ptr != nullptr && s.capacity >= size) {
+      return s.ptr;
+    }
+    release(s);
+    size = std::max<size_t>(size, 1);
+    hipError_t err = pinned_host_ ? hipHostMalloc(&s.ptr, size, 0)
+                                  : hipMalloc(&s.ptr, size);
+    if (err != hipSuccess) {
+      s.ptr = nullptr;
+      return nullptr;
+    }
+    s.capacity = size;
+    return s.ptr;
   }
 
-  buffer_index = 0;
-  for (const auto &arg : args) {
-    if (arg.kind != "global_buffer")
-      continue;
-    BufferArg &buf = buffers[buffer_index++];
-    if (hipMemcpy(buf.out_a.data(), buf.device_ptr, buf.size,
-                  hipMemcpyDeviceToHost) != hipSuccess) {
-      return false;
+  void clear() {
+    for (auto &slots : lanes_) {
+      for (auto &s : slots) {
+        release(s);
+      }
     }
+    lanes_.clear();
   }
 
-  (void)by_value;
-  return true;
-}
+private:
+  struct Slot {
+    void *ptr = nullptr;
+    size_t capacity = 0;
+  };
 
-static bool run_kernel_b(hipFunction_t func, const std::vector<ArgSpec> &args,
-                         std::vector<BufferArg> &buffers,
-                         const std::vector<std::vector<uint8_t>> &by_value,
-                         const std::vector<void *> &param_values,
-                         const LaunchDims &launch) {
-  std::vector<void *> params = param_values;
-  size_t buffer_index = 0;
+  void release(Slot &s) {
+    if (s.ptr != nullptr) {
+      if (pinned_host_) {
+        hipHostFree(s.ptr);
+      } else {
+        hipFree(s.ptr);
+      }
+    }
+    s.ptr = nullptr;
+    s.capacity = 0;
+  }
 
-  for (const auto &arg : args) {
-    if (arg.kind != "global_buffer")
-      continue;
-    BufferArg &buf = buffers[buffer_index++];
-    if (hipMemcpy(buf.device_ptr, buf.init.data(), buf.size,
-                  hipMemcpyHostToDevice) != hipSuccess) {
-      return false;
+  bool pinned_host_;
+  std::vector<std::vector<Slot>> lanes_;
+};
+
+// Read-only mappings of input snapshot regions, pinned with hipHostRegister
+// so uploads copy straight from the page cache without a staging copy. A
+// region stays mapped while consecutive requests bind it, so a seed sweep or
+// a campaign over one snapshot maps and pins it once. If the runtime will
+// not pin a mapping, it is uploaded as pageable memory.
+class MappedFiles {
+public:
+  MappedFiles() = default;
+  MappedFiles(const MappedFiles &) = delete;
+  MappedFiles &operator=(const MappedFiles &) = delete;
+  ~MappedFiles() {
+    for (auto &entry : entries_) {
+      release(entry.second);
     }
   }
 
-  hipError_t err = hipModuleLaunchKernel(
-      func, launch.grid.x, launch.grid.y, launch.grid.z, launch.block.x,
-      launch.block.y, launch.block.z, 0, nullptr, params.data(), nullptr);
-  if (err != hipSuccess) {
-    return false;
+  // Unmap the regions the previous request did not use.
+  void begin_request() {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (!it->second.used) {
+        release(it->second);
+        it = entries_.erase(it);
+      } else {
+        it->second.used = false;
+        ++it;
+      }
+    }
   }
 
-  if (hipDeviceSynchronize() != hipSuccess) {
-    return false;
+  // The bytes of `region`, with `size` set to its length, or nullptr with
+  // `error` set. A file that changed since it was mapped is mapped again.
+  const uint8_t *acquire(const FileRegion &region, size_t &size,
+                         std::string &error) {
+    struct stat st;
+    if (stat(region.path.c_str(), &st) != 0) {
+      error = "cannot stat " + region.path + ": " + std::strerror(errno);
+      return nullptr;
+    }
+    uint64_t file_size = static_cast<uint64_t>(st.st_size);
+    uint64_t length =
+        region.length != 0 ? region.length : file_size - std::min(
+                                                 file_size, region.offset);
+    if (length == 0 || region.offset > file_size ||
+        length > file_size - region.offset) {
+      error = "file region past the end of " + region.path;
+      return nullptr;
+    }
+    std::string key = region.path + "\n" + std::to_string(region.offset) +
+                      "\n" + std::to_string(length);
+    auto found = entries_.find(key);
+    if (found != entries_.end()) {
+      Entry &entry = found->second;
+      if (entry.device == st.st_dev && entry.inode == st.st_ino &&
+          entry.file_size == file_size && entry.mtime == st.st_mtime) {
+        entry.used = true;
+        size = static_cast<size_t>(length);
+        return entry.data;
+      }
+      release(entry);
+      entries_.erase(found);
+    }
+
+    uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = region.offset / page * page;
+    Entry entry;
+    entry.span = static_cast<size_t>(region.offset - start + length);
+    int fd = open(region.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      error = "cannot open " + region.path + ": " + std::strerror(errno);
+      return nullptr;
+    }
+    entry.base = mmap(nullptr, entry.span, PROT_READ, MAP_SHARED, fd,
+                      static_cast<off_t>(start));
+    close(fd);
+    if (entry.base == MAP_FAILED) {
+      error = "cannot map " + region.path + ": " + std::strerror(errno);
+      return nullptr;
+    }
+    madvise(entry.base, entry.span, MADV_WILLNEED);
+    unsigned flags = hipHostRegisterDefault;
+#ifdef hipHostRegisterReadOnly
+    // Pinning for write would break the read-only shared mapping.
+    flags |= hipHostRegisterReadOnly;
+#endif
+    entry.pinned = hipHostRegister(entry.base, entry.span, flags) == hipSuccess;
+    if (!entry.pinned) {
+      hipGetLastError();
+    }
+    entry.data = static_cast<const uint8_t *>(entry.base) +
+                 (region.offset - start);
+    entry.device = st.st_dev;
+    entry.inode = st.st_ino;
+    entry.file_size = file_size;
+    entry.mtime = st.st_mtime;
+    entry.used = true;
+    size = static_cast<size_t>(length);
+    return entries_.emplace(key, entry).first->second.data;
   }
 
-  buffer_index = 0;
-  for (const auto &arg : args) {
-    if (arg.kind != "global_buffer")
-      continue;
-    BufferArg &buf = buffers[buffer_index++];
-    if (hipMemcpy(buf.out_b.data(), buf.device_ptr, buf.size,
-                  hipMemcpyDeviceToHost) != hipSuccess) {
-      return false;
+private:
+  struct Entry {
+    void *base = nullptr;
+    size_t span = 0;
+    const uint8_t *data = nullptr;
+    bool pinned = false;
+    bool used = false;
+    dev_t device = 0;
+    ino_t inode = 0;
+    uint64_t file_size = 0;
+    time_t mtime = 0;
+  };
+
+  static void release(Entry &entry) {
+    if (entry.pinned) {
+      hipHostUnregister(entry.base);
     }
+    munmap(entry.base, entry.span);
   }
 
-  (void)by_value;
-  return true;
-}
+  std::unordered_map<std::string, Entry> entries_;
+};
 
-int main(int argc, char **argv) {
-  std::string hsaco_a;
-  std::string hsaco_b;
-  std::string spec_path;
-  std::string input_spec_path;
-  size_t buffer_size = 4096;
+// A device's slab, shared by every request. Each request lays its buffers
+// out once per lane on the device, at kArenaAlign boundaries, each followed
+// by guard_bytes of canary, so a kernel writing past the end of an argument
+// hits the guard rather than the next buffer. The slab only grows, and only
+// between requests.
+class DeviceArena {
+public:
+  static constexpr size_t kArenaAlign = 256;
+  static constexpr uint8_t kGuardByte = 0xA5;
 
-  for (int i = 1; i < argc; ++i) {
-    std::string arg = argv[i];
-    if (arg == "--hsaco-a" && i + 1 < argc) {
-      hsaco_a = argv[++i];
-    } else if (arg == "--hsaco-b" && i + 1 < argc) {
-      hsaco_b = argv[++i];
-    } else if (arg == "--spec" && i + 1 < argc) {
-      spec_path = argv[++i];
-    } else if (arg == "--input-spec" && i + 1 < argc) {
-      input_spec_path = argv[++i];
-    } else if (arg == "--buffer-size" && i + 1 < argc) {
-      buffer_size = static_cast<size_t>(std::stoul(argv[++i]));
+  ~DeviceArena() {
+    if (slab_ != nullptr) {
+      hipFree(slab_);
     }
   }
 
-  if (hsaco_a.empty() || hsaco_b.empty() || spec_path.empty()) {
-    std::cerr << "usage: hip_runner --hsaco-a <hsaco> --hsaco-b <hsaco> "
-                 "--spec <spec> [--buffer-size N] [--input-spec path]\n";
-    return 2;
+  // Lay out buffers of `sizes` for `lanes` lanes. Invalidates pointers from
+  // the previous layout.
+  bool layout(const std::vector<size_t> &sizes, size_t lanes,
+              size_t guard_bytes) {
+    auto align = [](size_t value) {
+      return (value + kArenaAlign - 1) / kArenaAlign * kArenaAlign;
+    };
+    offsets_.clear();
+    sizes_ = sizes;
+    guard_bytes_ = guard_bytes;
+    size_t offset = 0;
+    for (size_t size : sizes) {
+      offsets_.push_back(offset);
+      offset = align(offset + size + guard_bytes);
+    }
+    stride_ = offset;
+    size_t need = std::max<size_t>(stride_ * lanes, 1);
+    if (need > capacity_) {
+      if (slab_ != nullptr) {
+        hipFree(slab_);
+        slab_ = nullptr;
+        capacity_ = 0;
+      }
+      // Grow geometrically so a slowly growing workload reallocates rarely.
+      size_t capacity = std::max(need, peak_capacity_ * 2);
+      void *slab = nullptr;
+      if (hipMalloc(&slab, capacity) != hipSuccess) {
+        // The doubled size may not fit where the exact one does.
+        capacity = need;
+        if (hipMalloc(&slab, capacity) != hipSuccess) {
+          return false;
+        }
+      }
+      slab_ = static_cast<uint8_t *>(slab);
+      capacity_ = capacity;
+      peak_capacity_ = std::max(peak_capacity_, capacity_);
+    }
+    peak_used_ = std::max(peak_used_, stride_ * lanes);
+    return true;
   }
 
-  std::string kernel;
-  std::vector<ArgSpec> args;
-  if (!load_spec(spec_path, kernel, args)) {
-    std::cerr << "failed to read spec\n";
-    return 2;
+  uint8_t *buffer(size_t lane, size_t index) const {
+    return slab_ + lane * stride_ + offsets_[index];
+  }
+  uint8_t *guard(size_t lane, size_t index) const {
+    return buffer(lane, index) + sizes_[index];
   }
+  size_t guard_bytes() const { return guard_bytes_; }
+  // Largest layout so far, and the largest slab.
+  size_t peak_used() const { return peak_used_; }
+  size_t peak_capacity() const { return peak_capacity_; }
 
-  hipModule_t mod_a = nullptr;
-  hipModule_t mod_b = nullptr;
-  if (hipModuleLoad(&mod_a, hsaco_a.c_str()) != hipSuccess ||
-      hipModuleLoad(&mod_b, hsaco_b.c_str()) != hipSuccess) {
-    std::cerr << "hipModuleLoad failed\n";
-    return 1;
+private:
+  uint8_t *slab_ = nullptr;
+  size_t capacity_ = 0;
+  size_t stride_ = 0;
+  size_t guard_bytes_ = 0;
+  size_t peak_used_ = 0;
+  size_t peak_capacity_ = 0;
+  std::vector<size_t> offsets_;
+  std::vector<size_t> sizes_;
+};
+
+// Event-timed launches of one kernel; reps is 0 when it was not timed.
+struct KernelTiming {
+  uint32_t reps = 0;
+  double median_us = 0.0;
+  double variance_us2 = 0.0;
+};
+
+struct VariantResult {
+  int status = 0;
+  std::string message;
+  // Seeds whose outputs differed from the reference, in sweep order.
+  std::vector<uint32_t> seeds;
+  KernelTiming timing;
+};
+
+// Summary of an on-device buffer comparison. Each thread folds its elements
+// into a CompareStats with the host rule (compare_element, under the
+// buffer's CompareSpec) and merges the counts into this with atomics. The
+// error maxima are non-negative doubles, kept as their bits, which order like
+// the values. The first violation's values are not reduced; the host copies
+// back a window around `first` to show them.
+struct CompareResult {
+  unsigned long long differing;
+  unsigned long long violations;
+  unsigned long long first; // element index; ~0 when nothing is violated
+  unsigned long long max_ulp;
+  unsigned long long max_abs_bits;
+  unsigned long long max_rel_bits;
+};
+
+static constexpr unsigned kCompareBlock = 256;
+static constexpr unsigned kCompareMaxBlocks = 1024;
+
+__host__ __device__ inline unsigned long long double_bits(double value) {
+  unsigned long long bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Compare elements begin, begin + stride, ... of a and b. Trailing bytes
+// that do not fill an element are indices elements.. and compare as u8,
+// exactly, reported as element `elements`, as in compare_outputs.
+__host__ __device__ inline void compare_elements(const uint8_t *a,
+                                                 const uint8_t *b, size_t size,
+                                                 const CompareSpec &spec,
+                                                 size_t begin, size_t stride,
+                                                 CompareStats &local) {
+  size_t width = element_size(spec.type);
+  size_t elements = size / width;
+  size_t count = elements + size % width;
+  for (size_t i = begin; i < count; i += stride) {
+    if (i < elements) {
+      compare_element(a, b, i, spec, local);
+      continue;
+    }
+    size_t byte = elements * width + (i - elements);
+    if (a[byte] != b[byte]) {
+      ++local.differing;
+      if (local.violations++ == 0) {
+        local.first_violation = elements;
+      }
+    }
+  }
+}
+
+#ifdef HIP_RUNNER_FAKE_BACKEND
+// The fake device runs work when it is queued, so the compare runs here.
+static hipError_t launch_compare(const uint8_t *a, const uint8_t *b,
+                                 size_t size, const CompareSpec &spec,
+                                 CompareResult *result, hipStream_t) {
+  CompareStats local;
+  compare_elements(a, b, size, spec, 0, 1, local);
+  *result = CompareResult{local.differing,
+                          local.violations,
+                          local.first_violation,
+                          local.max_ulp,
+                          double_bits(local.max_abs),
+                          double_bits(local.max_rel)};
+  return hipSuccess;
+}
+#else
+__global__ void compare_kernel(const uint8_t *a, const uint8_t *b, size_t size,
+                               CompareSpec spec, CompareResult *result) {
+  CompareStats local;
+  size_t begin = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+  compare_elements(a, b, size, spec, begin,
+                   static_cast<size_t>(gridDim.x) * blockDim.x, local);
+  // Differences are rare, so threads without any skip the atomics.
+  if (local.differing != 0) {
+    atomicAdd(&result->differing, local.differing);
+    atomicAdd(&result->violations, local.violations);
+    atomicMin(&result->first, local.first_violation);
+    atomicMax(&result->max_ulp, local.max_ulp);
+    atomicMax(&result->max_abs_bits, double_bits(local.max_abs));
+    atomicMax(&result->max_rel_bits, double_bits(local.max_rel));
   }
+}
+
+static hipError_t launch_compare(const uint8_t *a, const uint8_t *b,
+                                 size_t size, const CompareSpec &spec,
+                                 CompareResult *result, hipStream_t stream) {
+  size_t width = element_size(spec.type);
+  size_t count = size / width + size % width;
+  size_t blocks = std::min<size_t>(
+      std::max<size_t>(1, (count + kCompareBlock - 1) / kCompareBlock),
+      kCompareMaxBlocks);
+  hipLaunchKernelGGL(compare_kernel, dim3(static_cast<uint32_t>(blocks)),
+                     dim3(kCompareBlock), 0, stream, a, b, size, spec,
+                     result);
+  return hipGetLastError();
+}
+#endif
+
+// A stream with its own device buffers, readback buffers and completion
+// event. Lane 0 runs the reference; lanes 1..test_lanes run test variants.
+// With several devices, lanes are dealt round-robin over them, so lane 1 (the
+// first test variant) runs on another GPU than the reference.
+struct Lane {
+  hipStream_t stream = nullptr;
+  hipEvent_t done = nullptr;
+  // With device compare, one pinned CompareResult per buffer argument.
+  CompareResult *compare = nullptr;
+};
 
-  hipFunction_t func_a = nullptr;
-  hipFunction_t func_b = nullptr;
-  if (hipModuleGetFunction(&func_a, mod_a, kernel.c_str()) != hipSuccess ||
-      hipModuleGetFunction(&func_b, mod_b, kernel.c_str()) != hipSuccess) {
-    std::cerr << "hipModuleGetFunction failed\n";
+// `devices` is how many devices to spread lanes over (1 by default); 0 means
+// all visible.
+static size_t usable_devices(size_t devices) {
+  int visible = 0;
+  if (hipGetDeviceCount(&visible) != hipSuccess || visible < 1) {
     return 1;
   }
+  size_t count = static_cast<size_t>(visible);
+  return devices == 0 ? count : std::min(devices, count);
+}
 
-  InputSpec input_spec;
-  if (!input_spec_path.empty()) {
-    if (!parse_input_spec(input_spec_path, input_spec)) {
-      std::cerr << "failed to read input spec\n";
-      return 2;
+struct RunnerState {
+  RunnerState(size_t module_capacity, size_t lanes, size_t devices)
+      : modules(std::max(module_capacity, lanes + 1)), test_lanes(lanes),
+        device_count(usable_devices(devices)), arenas(device_count),
+        staging(true), readback(true), compare_device(false),
+        compare_host(true) {}
+
+  ~RunnerState() {
+    for (auto &lane : lanes) {
+      if (lane.done != nullptr)
+        hipEventDestroy(lane.done);
+      if (lane.stream != nullptr)
+        hipStreamDestroy(lane.stream);
     }
   }
-  std::mt19937 rng(input_spec.has_seed ? input_spec.seed : 12345);
-  LaunchDims launch = input_spec.has_launch ? input_spec.launch : LaunchDims{};
-  std::vector<BufferArg> buffers;
-  std::vector<std::vector<uint8_t>> by_value;
-  std::vector<void *> param_values;
-  std::vector<void *> device_ptrs;
 
-  size_t ptr_arg_count = 0;
-  size_t by_value_count = 0;
-  for (const auto &arg : args) {
-    if (arg.kind == "global_buffer")
-      ++ptr_arg_count;
-    else if (arg.kind == "by_value" || arg.kind == "value")
-      ++by_value_count;
+  // Make the lane's device current and return the lane, creating its stream
+  // and event on first use.
+  Lane *lane(size_t index) {
+    if (hipSetDevice(device_of(index)) != hipSuccess) {
+      return nullptr;
+    }
+    if (index >= lanes.size()) {
+      lanes.resize(index + 1);
+    }
+    Lane &l = lanes[index];
+    if (l.stream == nullptr &&
+        hipStreamCreateWithFlags(&l.stream, hipStreamNonBlocking) !=
+            hipSuccess) {
+      l.stream = nullptr;
+      return nullptr;
+    }
+    if (l.done == nullptr &&
+        hipEventCreateWithFlags(&l.done, hipEventDisableTiming) !=
+            hipSuccess) {
+      l.done = nullptr;
+      return nullptr;
+    }
+    return &l;
   }
-  device_ptrs.reserve(ptr_arg_count);
-  by_value.reserve(by_value_count);
 
-  for (size_t arg_index = 0; arg_index < args.size(); ++arg_index) {
-    const auto &arg = args[arg_index];
-    if (arg.kind == "global_buffer") {
-      BufferArg buf;
-      auto size_it = input_spec.buffer_sizes.find(arg_index);
-      buf.size = size_it == input_spec.buffer_sizes.end() ? buffer_size
-                                                          : size_it->second;
-      buf.init.resize(buf.size);
-      buf.out_a.resize(buf.size);
-      buf.out_b.resize(buf.size);
-      fill_random(buf.init, rng);
-      if (hipMalloc(&buf.device_ptr, buffer_size) != hipSuccess) {
-        std::cerr << "hipMalloc failed\n";
-        return 1;
-      }
-      buffers.push_back(std::move(buf));
-      device_ptrs.push_back(buffers.back().device_ptr);
-      param_values.push_back(&device_ptrs.back());
-    } else if (arg.kind == "by_value" || arg.kind == "value") {
-      std::vector<uint8_t> data(arg.size, 0);
-      bool override_error = false;
-      if (!apply_value_override(arg, arg_index, input_spec, data,
-                                override_error)) {
-        if (override_error) {
-          return 1;
-        }
-        fill_random(data, rng);
+  int device_of(size_t lane) const {
+    return static_cast<int>(lane % device_count);
+  }
+
+  // Lay out `lanes` lanes of `sizes`, each on its lane's device.
+  bool layout(const std::vector<size_t> &sizes, size_t lanes,
+              size_t guard_bytes) {
+    for (size_t d = 0; d < std::min(device_count, lanes); ++d) {
+      size_t device_lanes = (lanes - d + device_count - 1) / device_count;
+      if (hipSetDevice(static_cast<int>(d)) != hipSuccess ||
+          !arenas[d].layout(sizes, device_lanes, guard_bytes)) {
+        return false;
       }
-      by_value.push_back(std::move(data));
-      param_values.push_back(by_value.back().data());
-    } else {
-      std::cerr << "unsupported arg kind: " << arg.kind << "\n";
-      return 1;
     }
+    return true;
   }
 
-  if (!run_kernel(func_a, args, buffers, by_value, param_values, launch)) {
-    std::cerr << "kernel A failed\n";
-    return 1;
+  uint8_t *buffer(size_t lane, size_t index) const {
+    return arenas[lane % device_count].buffer(lane / device_count, index);
   }
-
-  if (!run_kernel_b(func_b, args, buffers, by_value, param_values, launch)) {
-    std::cerr << "kernel B failed\n";
-    return 1;
+  uint8_t *guard(size_t lane, size_t index) const {
+    return arenas[lane % device_count].guard(lane / device_count, index);
+  }
+  size_t guard_bytes() const { return arenas[0].guard_bytes(); }
+  // Summed over the devices.
+  size_t peak_used() const {
+    size_t total = 0;
+    for (const auto &arena : arenas) {
+      total += arena.peak_used();
+    }
+    return total;
+  }
+  size_t peak_capacity() const {
+    size_t total = 0;
+    for (const auto &arena : arenas) {
+      total += arena.peak_capacity();
+    }
+    return total;
   }
 
-  for (const auto &buf : buffers) {
-    if (!std::equal(buf.out_a.begin(), buf.out_a.end(), buf.out_b.begin())) {
-      std::cerr << "output mismatch\n";
-      return 1;
+  ModuleCache modules;
+  size_t test_lanes;
+  size_t device_count;
+  std::vector<DeviceArena> arenas;
+  // Initial buffer contents, shared by every lane's upload.
+  BufferPool staging;
+  MappedFiles files;
+  BufferPool readback;
+  BufferPool compare_device;
+  BufferPool compare_host;
+  std::vector<Lane> lanes;
+};
+
+// Queue upload, launch and readback of one variant on its lane; the lane's
+// event fires when the outputs are in `outputs`. Nothing waits here, so
+// lanes overlap on the device.
+//
+// With device_compare the outputs stay on the device and `outputs` holds the
+// lane's device buffers. A test variant (non-null `reference`, the reference
+// lane's buffers) then waits for the reference lane, compares each buffer
+// against it on its own stream and reads back only the CompareResults.
+//
+// Returns 0, kDeviceErrorExitCode if the lane could not be set up before the
+// launch, or 1 if the launch or anything queued after it failed; errors of a
+// faulting kernel surface in the calls that follow it.
+static int enqueue_variant(RunnerState &state, size_t lane_index,
+                            hipFunction_t func,
+                            const std::vector<ArgSpec> &args,
+                            const std::vector<BufferArg> &buffers,
+                            std::vector<std::vector<uint8_t>> &by_value,
+                            const LaunchDims &launch, bool device_compare,
+                            const std::vector<const uint8_t *> *reference,
+                            std::vector<const uint8_t *> &outputs) {
+  Lane *lane = state.lane(lane_index);
+  if (lane == nullptr) {
+    return kDeviceErrorExitCode;
+  }
+  std::vector<void *> device_ptrs(buffers.size());
+  std::vector<void *> params;
+  params.reserve(args.size());
+  outputs.assign(buffers.size(), nullptr);
+  size_t buffer_index = 0;
+  size_t value_index = 0;
+  for (const auto &arg : args) {
+    if (arg.kind != "global_buffer") {
+      params.push_back(by_value[value_index++].data());
+      continue;
     }
+    const BufferArg &buf = buffers[buffer_index];
+    void *dev = state.buffer(lane_index, buffer_index);
+    void *out = device_compare
+                    ? dev
+                    : state.readback.acquire(lane_index, buffer_index,
+                                             buf.size);
+    size_t guard_bytes = state.guard_bytes();
+    if (out == nullptr ||
+        hipMemcpyAsync(dev, buf.init, buf.size, hipMemcpyHostToDevice,
+                       lane->stream) != hipSuccess ||
+        (guard_bytes != 0 &&
+         hipMemsetAsync(state.guard(lane_index, buffer_index),
+                        DeviceArena::kGuardByte, guard_bytes,
+                        lane->stream) != hipSuccess)) {
+      return kDeviceErrorExitCode;
+    }
+    device_ptrs[buffer_index] = dev;
+    outputs[buffer_index] = static_cast<const uint8_t *>(out);
+    params.push_back(&device_ptrs[buffer_index]);
+    ++buffer_index;
   }
 
-  for (auto &buf : buffers) {
-    hipFree(buf.device_ptr);
+  if (hipModuleLaunchKernel(func, launch.grid.x, launch.grid.y, launch.grid.z,
+                            launch.block.x, launch.block.y, launch.block.z, 0,
+                            lane->stream, params.data(),
+                            nullptr) != hipSuccess) {
+    return 1;
   }
 
-  hipModuleUnload(mod_a);
-  hipModuleUnload(mod_b);
-  return 0;
+  if (device_compare) {
+    if (reference != nullptr) {
+      size_t bytes = buffers.size() * sizeof(CompareResult);
+      auto *results = static_cast<CompareResult *>(
+          state.compare_device.acquire(lane_index, 0, bytes));
+      lane->compare = static_cast<CompareResult *>(
+          state.compare_host.acquire(lane_index, 0, bytes));
+      if (results == nullptr || lane->compare == nullptr ||
+          hipStreamWaitEvent(lane->stream, state.lanes[0].done, 0) !=
+              hipSuccess) {
+        return 1;
+      }
+      for (size_t b = 0; b < buffers.size(); ++b) {
+        if (hipMemsetAsync(&results[b], 0, sizeof(CompareResult),
+                           lane->stream) != hipSuccess ||
+            hipMemsetAsync(&results[b].first, 0xFF, sizeof(results[b].first),
+                           lane->stream) != hipSuccess ||
+            launch_compare((*reference)[b], outputs[b], buffers[b].size,
+                           buffers[b].compare, &results[b],
+                           lane->stream) != hipSuccess) {
+          return 1;
+        }
+      }
+      if (hipMemcpyAsync(lane->compare, results,
+                         buffers.size() * sizeof(CompareResult),
+                         hipMemcpyDeviceToHost, lane->stream) != hipSuccess) {
+        return 1;
+      }
+    }
+    return hipEventRecord(lane->done, lane->stream) == hipSuccess ? 0 : 1;
+  }
+
+  for (size_t b = 0; b < buffers.size(); ++b) {
+    if (hipMemcpyAsync(const_cast<uint8_t *>(outputs[b]), device_ptrs[b],
+                       buffers[b].size, hipMemcpyDeviceToHost,
+                       lane->stream) != hipSuccess) {
+      return 1;
+    }
+  }
+  return hipEventRecord(lane->done, lane->stream) == hipSuccess ? 0 : 1;
+}
+
+// Wait for the given lanes and return which completed without error. After
+// timeout_ms (0 waits forever) the process exits: HIP cannot cancel a
+// running kernel, and teardown reclaims the queues.
+static std::vector<bool> wait_for_lanes(RunnerState &state,
+                                        const std::vector<size_t> &lanes,
+                                        unsigned timeout_ms) {
+  std::vector<bool> ok(lanes.size(), false);
+  if (timeout_ms == 0) {
+    for (size_t i = 0; i < lanes.size(); ++i) {
+      ok[i] = hipEventSynchronize(state.lanes[lanes[i]].done) == hipSuccess;
+    }
+    return ok;
+  }
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(timeout_ms);
+  std::vector<bool> pending(lanes.size(), true);
+  size_t remaining = lanes.size();
+  while (remaining > 0) {
+    for (size_t i = 0; i < lanes.size(); ++i) {
+      if (!pending[i])
+        continue;
+      hipError_t status = hipEventQuery(state.lanes[lanes[i]].done);
+      if (status == hipErrorNotReady)
+        continue;
+      ok[i] = status == hipSuccess;
+      pending[i] = false;
+      --remaining;
+    }
+    if (remaining == 0)
+      break;
+    if (std::chrono::steady_clock::now() >= deadline) {
+      std::cerr << "kernel timed out after " << timeout_ms << " ms\n";
+      if (g_reply_fd >= 0) {
+        write_response(g_reply_fd, kTimeoutExitCode, "kernel timed out");
+      }
+      std::_Exit(kTimeoutExitCode);
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  return ok;
+}
+
+// Time `func` on lane 0 with events: warmup untimed launches, then reps
+// timed ones. Every kernel is timed there, so timings share one device. The
+// inputs are uploaded again before every launch, outside the timed region, so
+// each run sees the same data. Kernels run one at a time so they do not
+// compete for the device. Returns false if a launch fails.
+static bool time_kernel(RunnerState &state, hipFunction_t func,
+                        const std::vector<ArgSpec> &args,
+                        const std::vector<BufferArg> &buffers,
+                        std::vector<std::vector<uint8_t>> &by_value,
+                        const LaunchDims &launch, const RunRequest &req,
+                        KernelTiming &timing) {
+  Lane *lane = state.lane(0);
+  if (lane == nullptr) {
+    return false;
+  }
+  std::vector<void *> device_ptrs(buffers.size());
+  std::vector<void *> params;
+  size_t buffer_index = 0;
+  size_t value_index = 0;
+  for (const auto &arg : args) {
+    if (arg.kind != "global_buffer") {
+      params.push_back(by_value[value_index++].data());
+      continue;
+    }
+    device_ptrs[buffer_index] = state.buffer(0, buffer_index);
+    params.push_back(&device_ptrs[buffer_index]);
+    ++buffer_index;
+  }
+  hipEvent_t start = nullptr;
+  hipEvent_t stop = nullptr;
+  if (hipEventCreate(&start) != hipSuccess) {
+    return false;
+  }
+  if (hipEventCreate(&stop) != hipSuccess) {
+    hipEventDestroy(start);
+    return false;
+  }
+  std::vector<double> samples;
+  bool ok = true;
+  for (uint32_t run = 0; ok && run < req.time_warmup + req.time_reps; ++run) {
+    for (size_t b = 0; ok && b < buffers.size(); ++b) {
+      ok = hipMemcpyAsync(device_ptrs[b], buffers[b].init, buffers[b].size,
+                          hipMemcpyHostToDevice, lane->stream) == hipSuccess;
+    }
+    ok = ok && hipEventRecord(start, lane->stream) == hipSuccess &&
+         hipModuleLaunchKernel(func, launch.grid.x, launch.grid.y,
+                               launch.grid.z, launch.block.x, launch.block.y,
+                               launch.block.z, 0, lane->stream, params.data(),
+                               nullptr) == hipSuccess &&
+         hipEventRecord(stop, lane->stream) == hipSuccess &&
+         hipEventRecord(lane->done, lane->stream) == hipSuccess &&
+         wait_for_lanes(state, {0}, req.timeout_ms)[0];
+    float ms = 0.0f;
+    if (ok && run >= req.time_warmup) {
+      ok = hipEventElapsedTime(&ms, start, stop) == hipSuccess;
+      samples.push_back(1000.0 * ms);
+    }
+  }
+  hipEventDestroy(start);
+  hipEventDestroy(stop);
+  if (!ok || samples.empty()) {
+    return ok;
+  }
+  std::sort(samples.begin(), samples.end());
+  size_t n = samples.size();
+  double mean = 0.0;
+  for (double sample : samples) {
+    mean += sample / n;
+  }
+  double squares = 0.0;
+  for (double sample : samples) {
+    squares += (sample - mean) * (sample - mean);
+  }
+  timing.reps = static_cast<uint32_t>(n);
+  timing.median_us = n % 2 ? samples[n / 2]
+                           : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+  timing.variance_us2 = n > 1 ? squares / (n - 1) : 0.0;
+  return true;
+}
+
+// Read back the guard after each of a lane's buffers. Returns where the
+// first overwritten guard is ("argument N at byte K"), or an empty string.
+static std::string check_guards(const RunnerState &state, size_t lane,
+                                const std::vector<BufferArg> &buffers) {
+  size_t guard_bytes = state.guard_bytes();
+  if (guard_bytes == 0) {
+    return "";
+  }
+  std::vector<uint8_t> guard(guard_bytes);
+  for (size_t b = 0; b < buffers.size(); ++b) {
+    std::string where = "argument " + std::to_string(buffers[b].arg_index);
+    if (hipSetDevice(state.device_of(lane)) != hipSuccess ||
+        hipMemcpy(guard.data(), state.guard(lane, b), guard_bytes,
+                  hipMemcpyDeviceToHost) != hipSuccess) {
+      return where + " (guard unreadable)";
+    }
+    auto bad = std::find_if(guard.begin(), guard.end(), [](uint8_t byte) {
+      return byte != DeviceArena::kGuardByte;
+    });
+    if (bad != guard.end()) {
+      return where + " at byte " +
+             std::to_string(buffers[b].size + (bad - guard.begin()));
+    }
+  }
+  return "";
+}
+
+// Describe the first violation in stats, with the buffer's totals.
+static std::string describe_mismatch(const BufferArg &buf,
+                                     const CompareStats &stats) {
+  const CompareSpec &cmp = buf.compare;
+  size_t width = element_size(cmp.type);
+  size_t offset = static_cast<size_t>(stats.first_violation) * width;
+  std::ostringstream out;
+  out << "output mismatch in argument " << buf.arg_index << " at byte ";
+  if (cmp.bytewise()) {
+    out << offset;
+    return out.str();
+  }
+  out << offset << " (element " << stats.first_violation << ": expected "
+      << std::setprecision(cmp.type == ElementType::kF32 ? 9 : 17)
+      << stats.expected << ", got " << stats.actual << "; "
+      << stats.violations << " of " << stats.elements << " "
+      << element_type_name(cmp.type) << " elements outside ";
+  if (cmp.mode == CompareSpec::Mode::kExact) {
+    out << "exact";
+  } else if (cmp.mode == CompareSpec::Mode::kUlp) {
+    out << "ulp " << cmp.max_ulp;
+  } else {
+    out << "rtol " << cmp.rtol << " atol " << cmp.atol;
+  }
+  out << std::setprecision(6) << ", max abs error " << stats.max_abs
+      << ", max rel error " << stats.max_rel << ", max ulp " << stats.max_ulp
+      << ")";
+  return out.str();
+}
+
+static std::string compare_buffer(const BufferArg &buf, const uint8_t *ref,
+                                  const uint8_t *test) {
+  CompareStats stats = compare_outputs(ref, test, buf.size, buf.compare);
+  return stats.violations == 0 ? "" : describe_mismatch(buf, stats);
+}
+
+// Report a device-side mismatch from its CompareResult. A bytewise compare
+// already knows the byte; a typed one copies back only the
+// kCompareBlockBytes from the first violation on, to show both values.
+static std::string describe_device_mismatch(const BufferArg &buf,
+                                            const uint8_t *ref,
+                                            const uint8_t *test,
+                                            const CompareResult &cmp) {
+  CompareStats stats;
+  size_t width = element_size(buf.compare.type);
+  stats.elements = buf.size / width;
+  stats.differing = cmp.differing;
+  stats.violations = cmp.violations;
+  stats.first_violation = cmp.first;
+  stats.max_ulp = cmp.max_ulp;
+  memcpy(&stats.max_abs, &cmp.max_abs_bits, sizeof(stats.max_abs));
+  memcpy(&stats.max_rel, &cmp.max_rel_bits, sizeof(stats.max_rel));
+  if (!buf.compare.bytewise()) {
+    size_t offset = static_cast<size_t>(cmp.first) * width;
+    size_t length = std::min(kCompareBlockBytes, buf.size - offset);
+    uint8_t want[kCompareBlockBytes];
+    uint8_t got[kCompareBlockBytes];
+    if (hipMemcpy(want, ref + offset, length, hipMemcpyDeviceToHost) ==
+            hipSuccess &&
+        hipMemcpy(got, test + offset, length, hipMemcpyDeviceToHost) ==
+            hipSuccess) {
+      CompareStats window = compare_outputs(want, got, length, buf.compare);
+      stats.expected = window.expected;
+      stats.actual = window.actual;
+    } else {
+      stats.expected = stats.actual =
+          std::numeric_limits<double>::quiet_NaN();
+    }
+  }
+  return describe_mismatch(buf, stats);
+}
+
+// Write bytes [offset, offset + size) of the random input of argument
+// arg_index under seed, as fill_inputs generates them (with the input spec's
+// generator for that argument, if any), for triage.
+static int gen_input(uint32_t arg_index, uint32_t seed, uint64_t offset,
+                     size_t size, const std::string &input_spec_path,
+                     const std::string &out_path) {
+  InputSpec input_spec;
+  if (!input_spec_path.empty() &&
+      !parse_input_spec(input_spec_path, input_spec)) {
+    return 2;
+  }
+  std::vector<uint8_t> data(size);
+  auto gen_it = input_spec.generators.find(arg_index);
+  if (gen_it == input_spec.generators.end()) {
+    philox_fill(data.data(), size, seed, arg_index, offset);
+  } else {
+    generate_input(gen_it->second, data.data(), size, seed, arg_index, offset);
+  }
+  std::ofstream out(out_path, std::ios::binary);
+  out.write(reinterpret_cast<const char *>(data.data()),
+            static_cast<std::streamsize>(size));
+  out.close();
+  if (!out) {
+    std::cerr << "cannot write " << out_path << "\n";
+    return 2;
+  }
+  return 0;
+}
+
+// Fill the initial buffer contents (in pinned staging memory) and the
+// by-value arguments for one seed. Every argument's bytes come from its own
+// Philox stream, so they depend only on (seed, argument index, offset).
+// Returns 0, or a run_request status with message set.
+static int fill_inputs(const RunRequest &req, const std::vector<ArgSpec> &args,
+                       const InputSpec &input_spec, uint32_t seed,
+                       RunnerState &state, std::vector<BufferArg> &buffers,
+                       std::vector<std::vector<uint8_t>> &by_value,
+                       std::string &message) {
+  buffers.clear();
+  by_value.clear();
+  for (size_t arg_index = 0; arg_index < args.size(); ++arg_index) {
+    const auto &arg = args[arg_index];
+    if (arg.kind == "global_buffer") {
+      BufferArg buf;
+      buf.arg_index = arg_index;
+      auto size_it = input_spec.buffer_sizes.find(arg_index);
+      buf.size = size_it == input_spec.buffer_sizes.end() ? req.buffer_size
+                                                          : size_it->second;
+      auto compare_it = input_spec.compares.find(arg_index);
+      buf.compare = compare_it == input_spec.compares.end()
+                        ? input_spec.default_compare
+                        : compare_it->second;
+      auto file_it = input_spec.files.find(arg_index);
+      if (file_it != input_spec.files.end()) {
+        // Captured data is the same for every seed and is uploaded straight
+        // from the mapping.
+        size_t region_size = 0;
+        buf.init = state.files.acquire(file_it->second, region_size, message);
+        if (buf.init == nullptr) {
+          return 2;
+        }
+        if (size_it != input_spec.buffer_sizes.end() &&
+            size_it->second != region_size) {
+          message = "buffer " + std::to_string(arg_index) +
+                    " size does not match its file region";
+          return 2;
+        }
+        buf.size = region_size;
+        buffers.push_back(buf);
+        continue;
+      }
+      auto *init = static_cast<uint8_t *>(
+          state.staging.acquire(0, buffers.size(), buf.size));
+      if (init == nullptr) {
+        message = "hipHostMalloc failed";
+        return kDeviceErrorExitCode;
+      }
+      auto gen_it = input_spec.generators.find(arg_index);
+      if (gen_it == input_spec.generators.end()) {
+        philox_fill(init, buf.size, seed, static_cast<uint32_t>(arg_index));
+      } else {
+        generate_input(gen_it->second, init, buf.size, seed,
+                       static_cast<uint32_t>(arg_index));
+      }
+      buf.init = init;
+      buffers.push_back(buf);
+    } else if (arg.kind == "by_value" || arg.kind == "value") {
+      std::vector<uint8_t> data(arg.size, 0);
+      bool override_error = false;
+      if (!apply_value_override(arg, arg_index, input_spec, data,
+                                override_error)) {
+        if (override_error) {
+          message = "invalid value override";
+          return 1;
+        }
+        auto gen_it = input_spec.generators.find(arg_index);
+        if (gen_it == input_spec.generators.end()) {
+          philox_fill_range(data.data(), data.size(), seed,
+                            static_cast<uint32_t>(arg_index), 0);
+        } else {
+          generate_range(gen_it->second, data.data(), data.size(), seed,
+                         static_cast<uint32_t>(arg_index), 0);
+        }
+      }
+      by_value.push_back(std::move(data));
+    } else {
+      message = "unsupported arg kind: " + arg.kind;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Run the reference once and every test variant on the same inputs, filling
+// one entry of `variants` per req.hsaco_b. Variants run test_lanes at a time,
+// each on its own stream and buffers, with the reference in the first wave;
+// with several devices the lanes are spread over them and outputs are
+// compared on the host, as device compare needs both sides on one device.
+// With a seed range this repeats per seed and records the seeds each variant
+// diverges on. Returns the process exit status: 0 when every variant
+// matches, 1 on a mismatch or a runtime failure, 2 on bad input files. On a
+// non-zero status, message says why. With req.time_reps, the reference and
+// every matching variant are then timed on the last seed's inputs;
+// `reference` gets the reference timing.
+static int run_request(const RunRequest &req, RunnerState &state,
+                       std::string &message,
+                       std::vector<VariantResult> &variants,
+                       KernelTiming &reference) {
+  reference = KernelTiming{};
+  state.files.begin_request();
+  variants.assign(req.hsaco_b.size(), VariantResult{});
+  std::string kernel;
+  std::vector<ArgSpec> args;
+  if (!load_spec(req.spec_path, kernel, args)) {
+    message = "failed to read spec";
+    return 2;
+  }
+
+  InputSpec input_spec;
+  if (!req.input_spec_path.empty()) {
+    if (!parse_input_spec(req.input_spec_path, input_spec)) {
+      message = "failed to read input spec";
+      return 2;
+    }
+  }
+  LaunchDims launch = input_spec.has_launch ? input_spec.launch : LaunchDims{};
+  bool device_compare = req.device_compare && state.device_count == 1;
+  if (req.device_compare && !device_compare) {
+    static bool warned = false;
+    if (!warned) {
+      std::cerr << "--device-compare needs one device; comparing the outputs "
+                   "of "
+                << state.device_count << " devices on the host\n";
+      warned = true;
+    }
+  }
+  std::vector<uint32_t> seeds;
+  if (req.seed_count == 0) {
+    seeds.push_back(input_spec.has_seed ? input_spec.seed : 12345);
+  } else {
+    for (uint32_t k = 0; k < req.seed_count; ++k) {
+      seeds.push_back(req.seed_first + k);
+    }
+  }
+
+  // Each seed refills the inputs and reruns the reference and every variant
+  // still in play; modules and device buffers stay loaded across seeds. A
+  // variant that fails to run is not retried with later seeds.
+  std::vector<BufferArg> buffers;
+  std::vector<std::vector<uint8_t>> by_value;
+  std::vector<const uint8_t *> ref_outputs;
+  std::vector<std::vector<const uint8_t *>> outputs(state.test_lanes + 1);
+  std::vector<bool> errored(variants.size(), false);
+  for (uint32_t seed : seeds) {
+    // Looked up per seed: with more variants than the module cache holds,
+    // the previous seed's waves may have evicted the reference.
+    hipModule_t mod_a = nullptr;
+    hipFunction_t func_a = nullptr;
+    if (!state.modules.get(req.hsaco_a, state.device_of(0), mod_a)) {
+      message = "hipModuleLoad failed";
+      return 1;
+    }
+    if (hipModuleGetFunction(&func_a, mod_a, kernel.c_str()) != hipSuccess) {
+      message = "hipModuleGetFunction failed";
+      return 1;
+    }
+    int status = fill_inputs(req, args, input_spec, seed, state, buffers,
+                             by_value, message);
+    if (status != 0) {
+      return status;
+    }
+    if (seed == seeds.front()) {
+      std::vector<size_t> sizes;
+      for (const auto &buf : buffers) {
+        sizes.push_back(buf.size);
+      }
+      size_t lanes = std::min(state.test_lanes, variants.size()) + 1;
+      if (!state.layout(sizes, lanes, req.guard_bytes)) {
+        message = "hipMalloc failed";
+        return kDeviceErrorExitCode;
+      }
+    }
+    size_t next = 0;
+    bool ref_pending = true;
+    while (ref_pending || next < variants.size()) {
+      // Lanes queued in this wave, and the variant each one runs.
+      std::vector<size_t> lanes;
+      std::vector<size_t> lane_variant;
+      if (ref_pending) {
+        int enqueued = enqueue_variant(state, 0, func_a, args, buffers,
+                                       by_value, launch, device_compare,
+                                       nullptr, ref_outputs);
+        if (enqueued != 0) {
+          message = "kernel A failed";
+          return enqueued;
+        }
+        lanes.push_back(0);
+        lane_variant.push_back(0);
+      }
+      for (size_t lane = 1; lane <= state.test_lanes && next < variants.size();
+           ++next) {
+        if (errored[next]) {
+          continue;
+        }
+        VariantResult &result = variants[next];
+        hipModule_t mod_b = nullptr;
+        hipFunction_t func_b = nullptr;
+        int enqueued = 1;
+        if (!state.modules.get(req.hsaco_b[next], state.device_of(lane),
+                               mod_b)) {
+          result.message = "hipModuleLoad failed";
+        } else if (hipModuleGetFunction(&func_b, mod_b, kernel.c_str()) !=
+                   hipSuccess) {
+          result.message = "hipModuleGetFunction failed";
+        } else if ((enqueued = enqueue_variant(
+                        state, lane, func_b, args, buffers, by_value, launch,
+                        device_compare, &ref_outputs, outputs[lane])) != 0) {
+          result.message = "kernel B failed";
+        } else {
+          lanes.push_back(lane);
+          lane_variant.push_back(next);
+          ++lane;
+          continue;
+        }
+        result.status = enqueued;
+        errored[next] = true;
+      }
+
+      std::vector<bool> ok = wait_for_lanes(state, lanes, req.timeout_ms);
+      for (size_t i = 0; i < lanes.size(); ++i) {
+        if (lanes[i] == 0) {
+          if (!ok[i]) {
+            message = "kernel A failed";
+            return 1;
+          }
+          std::string overrun = check_guards(state, 0, buffers);
+          if (!overrun.empty()) {
+            message = "kernel A wrote past the end of " + overrun;
+            return 1;
+          }
+          ref_pending = false;
+          continue;
+        }
+        VariantResult &result = variants[lane_variant[i]];
+        if (!ok[i]) {
+          result.status = 1;
+          result.message = "kernel B failed";
+          errored[lane_variant[i]] = true;
+          continue;
+        }
+        std::string mismatch;
+        std::string overrun = check_guards(state, lanes[i], buffers);
+        if (!overrun.empty()) {
+          mismatch = "output mismatch past the end of " + overrun;
+        }
+        for (size_t b = 0; mismatch.empty() && b < buffers.size(); ++b) {
+          const uint8_t *ref = ref_outputs[b];
+          const uint8_t *test = outputs[lanes[i]][b];
+          if (device_compare) {
+            // The device already applied the buffer's type and tolerance.
+            const CompareResult &cmp = state.lanes[lanes[i]].compare[b];
+            if (cmp.violations != 0) {
+              mismatch = describe_device_mismatch(buffers[b], ref, test, cmp);
+            }
+            continue;
+          }
+          mismatch = compare_buffer(buffers[b], ref, test);
+        }
+        if (!mismatch.empty()) {
+          if (result.seeds.empty()) {
+            result.status = 1;
+            result.message = mismatch;
+          }
+          result.seeds.push_back(seed);
+        }
+      }
+    }
+  }
+
+  if (req.time_reps != 0) {
+    hipModule_t mod = nullptr;
+    hipFunction_t func = nullptr;
+    if (!state.modules.get(req.hsaco_a, state.device_of(0), mod) ||
+        hipModuleGetFunction(&func, mod, kernel.c_str()) != hipSuccess ||
+        !time_kernel(state, func, args, buffers, by_value, launch, req,
+                     reference)) {
+      message = "timing kernel A failed";
+      return 1;
+    }
+    for (size_t v = 0; v < variants.size(); ++v) {
+      VariantResult &result = variants[v];
+      if (result.status != 0) {
+        continue;
+      }
+      if (!state.modules.get(req.hsaco_b[v], state.device_of(0), mod) ||
+          hipModuleGetFunction(&func, mod, kernel.c_str()) != hipSuccess ||
+          !time_kernel(state, func, args, buffers, by_value, launch, req,
+                       result.timing)) {
+        result.status = 1;
+        result.message = "timing kernel B failed";
+      }
+    }
+  }
+
+  size_t failed = 0;
+  size_t device_errors = 0;
+  for (auto &result : variants) {
+    if (result.status == 0) {
+      continue;
+    }
+    ++failed;
+    device_errors += result.status == kDeviceErrorExitCode;
+    if (req.seed_count != 0 && !result.seeds.empty() &&
+        result.message.rfind("output mismatch", 0) == 0) {
+      result.message += " with seed " + std::to_string(result.seeds[0]) +
+                        "; diverges on " + std::to_string(result.seeds.size()) +
+                        " of " + std::to_string(seeds.size()) + " seeds";
+    }
+  }
+  if (failed == 0) {
+    return 0;
+  }
+  if (variants.size() == 1) {
+    message = variants[0].message;
+  } else {
+    message = std::to_string(failed) + " of " +
+              std::to_string(variants.size()) + " variants failed";
+  }
+  // Only a batch whose every failure is a device error blames the device.
+  return device_errors == failed ? kDeviceErrorExitCode : 1;
+}
+
+static std::string json_string(const std::string &value) {
+  std::string out = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+// Machine-readable batch result: one verdict per test variant, in
+// --hsaco-b order.
+static std::string json_timing(const KernelTiming &timing) {
+  std::ostringstream out;
+  out << "{\"reps\": " << timing.reps << ", \"median_us\": " << timing.median_us
+      << ", \"variance_us2\": " << timing.variance_us2 << "}";
+  return out.str();
+}
+
+static bool write_report(const std::string &path, const RunRequest &req,
+                         int status, const std::string &message,
+                         const std::vector<VariantResult> &variants,
+                         const KernelTiming &reference) {
+  std::ofstream out(path);
+  out << "{\n  \"reference\": " << json_string(req.hsaco_a);
+  if (req.time_reps != 0) {
+    out << ",\n  \"reference_timing\": " << json_timing(reference);
+  }
+  out << ",\n  \"status\": " << status
+      << ",\n  \"message\": " << json_string(message)
+      << ",\n  \"variants\": [";
+  for (size_t v = 0; v < variants.size(); ++v) {
+    const VariantResult &result = variants[v];
+    const char *verdict = result.status == 0 ? "match"
+                          : result.status == kTimeoutExitCode ? "hang"
+                          : result.status == kDeviceErrorExitCode
+                              ? "device-error"
+                          : result.status > 128 ? "fault"
+                          : result.message.rfind("output mismatch", 0) == 0
+                              ? "mismatch"
+                              : "error";
+    out << (v ? "," : "") << "\n    {\"hsaco\": "
+        << json_string(v < req.hsaco_b.size() ? req.hsaco_b[v] : "")
+        << ", \"verdict\": \"" << verdict
+        << "\", \"message\": " << json_string(result.message);
+    if (req.seed_count != 0) {
+      out << ", \"diverging_seeds\": [";
+      for (size_t k = 0; k < result.seeds.size(); ++k) {
+        out << (k ? ", " : "") << result.seeds[k];
+      }
+      out << "]";
+    }
+    if (result.timing.reps != 0) {
+      out << ", \"timing\": " << json_timing(result.timing)
+          << ", \"slowdown\": "
+          << (reference.median_us > 0
+                  ? result.timing.median_us / reference.median_us
+                  : 0.0);
+    }
+    out << "}";
+  }
+  out << (variants.empty() ? "" : "\n  ") << "]\n}\n";
+  return static_cast<bool>(out);
+}
+
+// Server protocol. Every message is a frame: a little-endian u32 payload
+// length followed by the payload. Strings are a u32 length and the bytes.
+//
+//   request  u8 op = kOpRun, u32 timeout_ms, u64 buffer_size,
+//            u8 device_compare, u32 seed_first, u32 seed_count,
+//            u32 guard_bytes, u32 time_reps, u32 time_warmup,
+//            str hsaco_a, u32 n, n x str hsaco_b, str spec, str input_spec
+//   request  u8 op = kOpQuit
+//   response u8 status (the one-shot exit status), str message,
+//            timing reference,
+//            u32 n, n x (u8 variant status, str variant message,
+//                        u32 m, m x u32 diverging seed, timing)
+//   timing   u32 reps, f64 median_us, f64 variance_us2 (as u64 bits)
+//
+// Requests on a connection are answered in order; connections are served one
+// at a time, so the device runs one test at a time. If a kernel times out the
+// server answers kTimeoutExitCode and exits, because HIP cannot cancel a
+// running kernel. A --zygote server instead replaces the worker that ran it,
+// and answers 128 + signal when a worker dies mid-request (a GPU memory
+// fault aborts the process), or kDeviceErrorExitCode when it cannot start a
+// worker.
+static constexpr uint8_t kOpRun = 1;
+static constexpr uint8_t kOpQuit = 2;
+static constexpr uint32_t kMaxFrame = 1u << 20;
+
+static bool write_all(int fd, const void *data, size_t size) {
+  const char *p = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+static bool read_all(int fd, void *data, size_t size) {
+  char *p = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+template <typename T> static void put_int(std::string &out, T value) {
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+static void put_str(std::string &out, const std::string &value) {
+  put_int<uint32_t>(out, static_cast<uint32_t>(value.size()));
+  out += value;
+}
+
+template <typename T>
+static bool get_int(const std::string &in, size_t &pos, T &value) {
+  if (in.size() - pos < sizeof(T)) {
+    return false;
+  }
+  value = 0;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    value |= static_cast<T>(static_cast<uint8_t>(in[pos + i])) << (8 * i);
+  }
+  pos += sizeof(T);
+  return true;
+}
+
+static bool get_str(const std::string &in, size_t &pos, std::string &value) {
+  uint32_t size = 0;
+  if (!get_int(in, pos, size) || in.size() - pos < size) {
+    return false;
+  }
+  value = in.substr(pos, size);
+  pos += size;
+  return true;
+}
+
+static bool write_frame(int fd, const std::string &payload) {
+  std::string frame;
+  put_int<uint32_t>(frame, static_cast<uint32_t>(payload.size()));
+  frame += payload;
+  return write_all(fd, frame.data(), frame.size());
+}
+
+static bool read_frame(int fd, std::string &payload) {
+  uint8_t header[4];
+  if (!read_all(fd, header, sizeof(header))) {
+    return false;
+  }
+  uint32_t size = header[0] | header[1] << 8 | header[2] << 16 |
+                  static_cast<uint32_t>(header[3]) << 24;
+  if (size > kMaxFrame) {
+    return false;
+  }
+  payload.resize(size);
+  return read_all(fd, &payload[0], size);
+}
+
+static void put_timing(std::string &out, const KernelTiming &timing) {
+  uint64_t bits = 0;
+  put_int<uint32_t>(out, timing.reps);
+  std::memcpy(&bits, &timing.median_us, sizeof(bits));
+  put_int<uint64_t>(out, bits);
+  std::memcpy(&bits, &timing.variance_us2, sizeof(bits));
+  put_int<uint64_t>(out, bits);
+}
+
+static bool get_timing(const std::string &in, size_t &pos,
+                       KernelTiming &timing) {
+  uint64_t median = 0;
+  uint64_t variance = 0;
+  if (!get_int(in, pos, timing.reps) || !get_int(in, pos, median) ||
+      !get_int(in, pos, variance)) {
+    return false;
+  }
+  std::memcpy(&timing.median_us, &median, sizeof(median));
+  std::memcpy(&timing.variance_us2, &variance, sizeof(variance));
+  return true;
+}
+
+static bool write_response(int fd, int status, const std::string &message,
+                           const std::vector<VariantResult> &variants,
+                           const KernelTiming &reference) {
+  std::string payload;
+  put_int<uint8_t>(payload, static_cast<uint8_t>(status));
+  put_str(payload, message);
+  put_timing(payload, reference);
+  put_int<uint32_t>(payload, static_cast<uint32_t>(variants.size()));
+  for (const auto &result : variants) {
+    put_int<uint8_t>(payload, static_cast<uint8_t>(result.status));
+    put_str(payload, result.message);
+    put_int<uint32_t>(payload, static_cast<uint32_t>(result.seeds.size()));
+    for (uint32_t seed : result.seeds) {
+      put_int<uint32_t>(payload, seed);
+    }
+    put_timing(payload, result.timing);
+  }
+  return write_frame(fd, payload);
+}
+
+static bool write_response(int fd, int status, const std::string &message) {
+  return write_response(fd, status, message, {}, KernelTiming{});
+}
+
+static std::string encode_run(const RunRequest &req) {
+  std::string payload;
+  put_int<uint8_t>(payload, kOpRun);
+  put_int<uint32_t>(payload, req.timeout_ms);
+  put_int<uint64_t>(payload, req.buffer_size);
+  put_int<uint8_t>(payload, req.device_compare ? 1 : 0);
+  put_int<uint32_t>(payload, req.seed_first);
+  put_int<uint32_t>(payload, req.seed_count);
+  put_int<uint32_t>(payload, req.guard_bytes);
+  put_int<uint32_t>(payload, req.time_reps);
+  put_int<uint32_t>(payload, req.time_warmup);
+  put_str(payload, req.hsaco_a);
+  put_int<uint32_t>(payload, static_cast<uint32_t>(req.hsaco_b.size()));
+  for (const auto &path : req.hsaco_b) {
+    put_str(payload, path);
+  }
+  put_str(payload, req.spec_path);
+  put_str(payload, req.input_spec_path);
+  return payload;
+}
+
+static bool decode_run(const std::string &payload, size_t pos,
+                       RunRequest &req) {
+  uint64_t buffer_size = 0;
+  uint8_t device_compare = 0;
+  uint32_t variants = 0;
+  if (!get_int(payload, pos, req.timeout_ms) ||
+      !get_int(payload, pos, buffer_size) ||
+      !get_int(payload, pos, device_compare) ||
+      !get_int(payload, pos, req.seed_first) ||
+      !get_int(payload, pos, req.seed_count) ||
+      !get_int(payload, pos, req.guard_bytes) ||
+      !get_int(payload, pos, req.time_reps) ||
+      !get_int(payload, pos, req.time_warmup) ||
+      !get_str(payload, pos, req.hsaco_a) ||
+      !get_int(payload, pos, variants) || variants > payload.size()) {
+    return false;
+  }
+  req.hsaco_b.resize(variants);
+  for (auto &path : req.hsaco_b) {
+    if (!get_str(payload, pos, path)) {
+      return false;
+    }
+  }
+  if (!get_str(payload, pos, req.spec_path) ||
+      !get_str(payload, pos, req.input_spec_path)) {
+    return false;
+  }
+  req.buffer_size = static_cast<size_t>(buffer_size);
+  req.device_compare = device_compare != 0;
+  return pos == payload.size();
+}
+
+// Serve requests from one connection until EOF or quit. Returns false on
+// quit.
+static bool serve_connection(int in_fd, int out_fd, RunnerState &state) {
+  std::string payload;
+  while (read_frame(in_fd, payload)) {
+    size_t pos = 0;
+    uint8_t op = 0;
+    if (!get_int(payload, pos, op)) {
+      write_response(out_fd, 2, "empty request");
+      continue;
+    }
+    if (op == kOpQuit) {
+      write_response(out_fd, 0, "bye");
+      return false;
+    }
+    RunRequest req;
+    if (op != kOpRun || !decode_run(payload, pos, req)) {
+      write_response(out_fd, 2, "malformed request");
+      continue;
+    }
+    std::string message;
+    std::vector<VariantResult> variants;
+    KernelTiming reference;
+    g_reply_fd = out_fd;
+    size_t peak = state.peak_used();
+    int status = run_request(req, state, message, variants, reference);
+    g_reply_fd = -1;
+    if (state.peak_used() > peak) {
+      // spill_fuzz.py takes the campaign's peak from these lines.
+      std::cerr << "hip_runner server: peak device memory "
+                << state.peak_used() << " bytes, slab "
+                << state.peak_capacity() << " bytes" << std::endl;
+    }
+    if (!write_response(out_fd, status, message, variants, reference)) {
+      break;
+    }
+  }
+  return true;
+}
+
+// Listen on a Unix socket at `socket_path`. Returns the socket, or -1 with
+// `status` set to the exit status to fail with.
+static int listen_on(const std::string &socket_path, int &status) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "socket path too long: " << socket_path << "\n";
+    status = 2;
+    return -1;
+  }
+  std::strcpy(addr.sun_path, socket_path.c_str());
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(socket_path.c_str());
+  if (listen_fd < 0 ||
+      bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+      listen(listen_fd, 16) < 0) {
+    std::cerr << "cannot listen on " << socket_path << ": "
+              << std::strerror(errno) << "\n";
+    if (listen_fd >= 0)
+      close(listen_fd);
+    status = 1;
+    return -1;
+  }
+  return listen_fd;
+}
+
+// Accept connections on socket_path ("-" serves stdin/stdout once) and pass
+// each to serve_one(in_fd, out_fd) until it returns false (quit).
+template <typename ServeOne>
+static int accept_loop(const std::string &socket_path, ServeOne serve_one) {
+  if (socket_path == "-") {
+    serve_one(STDIN_FILENO, STDOUT_FILENO);
+    return 0;
+  }
+  int status = 0;
+  int listen_fd = listen_on(socket_path, status);
+  if (listen_fd < 0) {
+    return status;
+  }
+  bool running = true;
+  while (running) {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    running = serve_one(fd, fd);
+    close(fd);
+  }
+  close(listen_fd);
+  unlink(socket_path.c_str());
+  return 0;
+}
+
+static int serve(const std::string &socket_path, RunnerState &state) {
+  int status = accept_loop(socket_path, [&](int in_fd, int out_fd) {
+    return serve_connection(in_fd, out_fd, state);
+  });
+  std::cerr << "hip_runner server: module cache " << state.modules.hits()
+            << " hits, " << state.modules.misses() << " loads\n";
+  return status;
+}
+
+// What a worker's RunnerState is built from.
+struct ServerConfig {
+  size_t module_cache = 16;
+  size_t streams = 4;
+  size_t devices = 1;
+};
+
+// Crash-isolating server. The HIP runtime cannot be carried across fork(),
+// so the zygote itself never starts it. It forks workers that each start the
+// runtime once and then serve requests relayed to them over a socketpair,
+// keeping modules and buffers warm like a plain server. One spare worker is
+// always forked ahead and initializing, so when a kernel fault kills the
+// active worker, or a timeout makes it exit, the spare takes over without
+// waiting for runtime startup.
+class Zygote {
+public:
+  explicit Zygote(const ServerConfig &config) : config_(config) {
+    active_ = spawn();
+    spare_ = spawn();
+  }
+  Zygote(const Zygote &) = delete;
+  Zygote &operator=(const Zygote &) = delete;
+  ~Zygote() {
+    stop(active_);
+    stop(spare_);
+    std::cerr << "hip_runner zygote: " << requests_ << " requests, "
+              << faults_ << " faults, " << timeouts_ << " timeouts, "
+              << started_ << " workers started\n";
+  }
+
+  // Relay requests from one connection until EOF or quit. Returns false on
+  // quit.
+  bool serve_connection(int in_fd, int out_fd) {
+    std::string payload;
+    while (read_frame(in_fd, payload)) {
+      if (!payload.empty() && static_cast<uint8_t>(payload[0]) == kOpQuit) {
+        write_response(out_fd, 0, "bye");
+        return false;
+      }
+      ++requests_;
+      if (active_.fd < 0) {
+        recycle();
+      }
+      std::string reply;
+      if (active_.fd < 0) {
+        write_response(out_fd, kDeviceErrorExitCode,
+                       "cannot start a hip_runner worker");
+        continue;
+      }
+      if (!write_frame(active_.fd, payload) || !read_frame(active_.fd, reply)) {
+        // The worker died before answering.
+        ++faults_;
+        int status = 1;
+        std::string message = reap(active_, status);
+        std::cerr << "hip_runner zygote: worker " << message << "\n";
+        recycle();
+        if (!write_response(out_fd, status,
+                            "kernel fault: worker " + message)) {
+          break;
+        }
+        continue;
+      }
+      if (!reply.empty() &&
+          static_cast<uint8_t>(reply[0]) == kTimeoutExitCode) {
+        // The worker exits after answering a timeout.
+        ++timeouts_;
+        int status = 0;
+        reap(active_, status);
+        recycle();
+      }
+      if (!write_frame(out_fd, reply)) {
+        break;
+      }
+    }
+    return true;
+  }
+
+private:
+  struct Worker {
+    pid_t pid = -1;
+    int fd = -1;
+  };
+
+  Worker spawn() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+      return Worker{};
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      close(fds[0]);
+      close(fds[1]);
+      return Worker{};
+    }
+    if (pid == 0) {
+      close_inherited_fds(fds[1]);
+      {
+        // Constructing the state starts the runtime, before any request.
+        RunnerState state(config_.module_cache, config_.streams,
+                          config_.devices);
+        ::serve_connection(fds[1], fds[1], state);
+      }
+      std::_Exit(0);
+    }
+    close(fds[1]);
+    ++started_;
+    return Worker{pid, fds[0]};
+  }
+
+  // The spare becomes the active worker and a new spare is forked.
+  void recycle() {
+    stop(active_);
+    active_ = spare_;
+    spare_ = spawn();
+    if (active_.fd < 0) {
+      active_ = spawn();
+    }
+  }
+
+  // Wait for a worker that has died or is exiting. Returns how it ended and
+  // sets `status` to 128 + signal if a signal killed it, else its exit code
+  // (1 if that was 0, as it exited mid-request).
+  static std::string reap(Worker &worker, int &status) {
+    close(worker.fd);
+    int wstatus = 0;
+    pid_t pid = worker.pid;
+    worker = Worker{};
+    if (waitpid(pid, &wstatus, 0) != pid) {
+      status = 1;
+      return "vanished";
+    }
+    if (WIFSIGNALED(wstatus)) {
+      status = 128 + WTERMSIG(wstatus);
+      return std::string("killed by signal ") +
+             std::to_string(WTERMSIG(wstatus)) + " (" +
+             strsignal(WTERMSIG(wstatus)) + ")";
+    }
+    int code = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 1;
+    status = code != 0 ? code : 1;
+    return "exited with status " + std::to_string(code);
+  }
+
+  // Ask an idle worker to finish: it exits on EOF.
+  static void stop(Worker &worker) {
+    if (worker.pid < 0) {
+      return;
+    }
+    int status = 0;
+    reap(worker, status);
+  }
+
+  // In a new worker: close every descriptor above stderr except `keep`, so
+  // the worker holds none of the zygote's sockets or the other worker's.
+  static void close_inherited_fds(int keep) {
+    std::vector<int> fds;
+    if (DIR *dir = opendir("/proc/self/fd")) {
+      while (dirent *entry = readdir(dir)) {
+        int fd = std::atoi(entry->d_name);
+        if (fd > 2 && fd != keep && fd != dirfd(dir)) {
+          fds.push_back(fd);
+        }
+      }
+      closedir(dir);
+    }
+    for (int fd : fds) {
+      close(fd);
+    }
+  }
+
+  ServerConfig config_;
+  Worker active_;
+  Worker spare_;
+  size_t requests_ = 0;
+  size_t faults_ = 0;
+  size_t timeouts_ = 0;
+  size_t started_ = 0;
+};
+
+static int serve_zygote(const std::string &socket_path,
+                        const ServerConfig &config) {
+  Zygote zygote(config);
+  return accept_loop(socket_path, [&](int in_fd, int out_fd) {
+    return zygote.serve_connection(in_fd, out_fd);
+  });
+}
+
+// Send one request to a server. Returns -1 if no server is listening, so the
+// caller can run the request itself.
+static int run_remote(const std::string &socket_path, const RunRequest &req,
+                      std::string &message,
+                      std::vector<VariantResult> &variants,
+                      KernelTiming &reference) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    return -1;
+  }
+  std::strcpy(addr.sun_path, socket_path.c_str());
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 ||
+      connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  std::string payload;
+  int status = 1;
+  size_t pos = 0;
+  uint8_t code = 0;
+  uint32_t count = 0;
+  variants.clear();
+  if (write_frame(fd, encode_run(req)) && read_frame(fd, payload) &&
+      get_int(payload, pos, code) && get_str(payload, pos, message) &&
+      get_timing(payload, pos, reference) && get_int(payload, pos, count)) {
+    status = code;
+    for (uint32_t v = 0; v < count; ++v) {
+      VariantResult result;
+      uint8_t variant_status = 0;
+      uint32_t seeds = 0;
+      if (!get_int(payload, pos, variant_status) ||
+          !get_str(payload, pos, result.message) ||
+          !get_int(payload, pos, seeds) || seeds > payload.size()) {
+        break;
+      }
+      result.seeds.resize(seeds);
+      for (auto &seed : result.seeds) {
+        get_int(payload, pos, seed);
+      }
+      get_timing(payload, pos, result.timing);
+      result.status = variant_status;
+      variants.push_back(std::move(result));
+    }
+  } else {
+    message = "hip_runner server closed the connection";
+  }
+  close(fd);
+  return status;
+}
+
+// Parse "a..b" (inclusive) or a single seed "a".
+static bool parse_seed_range(const std::string &text, uint32_t &first,
+                             uint32_t &count) {
+  size_t dots = text.find("..");
+  try {
+    size_t used = 0;
+    unsigned long a = std::stoul(text.substr(0, dots), &used);
+    if (used != (dots == std::string::npos ? text.size() : dots)) {
+      return false;
+    }
+    unsigned long b = a;
+    if (dots != std::string::npos) {
+      b = std::stoul(text.substr(dots + 2), &used);
+      if (used != text.size() - dots - 2) {
+        return false;
+      }
+    }
+    if (b < a || b > UINT32_MAX) {
+      return false;
+    }
+    first = static_cast<uint32_t>(a);
+    count = static_cast<uint32_t>(b - a + 1);
+    return count != 0;
+  } catch (const std::exception &) {
+    return false;
+  }
+}
+
+static std::string absolute_path(const std::string &path) {
+  if (path.empty() || path[0] == '/') {
+    return path;
+  }
+  char cwd[4096];
+  if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+    return path;
+  }
+  return std::string(cwd) + "/" + path;
+}
+
+int main(int argc, char **argv) {
+  RunRequest req;
+  std::string serve_path;
+  std::string connect_path;
+  std::string report_path;
+  size_t module_cache = 16;
+  size_t streams = 4;
+  // Spreading lanes over several GPUs is opt-in: it turns off device compare.
+  size_t devices = 1;
+  bool zygote = false;
+  std::string emit_spec_path;
+  std::string dump_path;
+  std::string kernel_name;
+  std::string out_path;
+  std::string gen_arg;
+  uint32_t gen_seed = 12345;
+  uint64_t gen_offset = 0;
+  size_t gen_size = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--hsaco-a" && i + 1 < argc) {
+      req.hsaco_a = argv[++i];
+    } else if (arg == "--hsaco-b" && i + 1 < argc) {
+      req.hsaco_b.push_back(argv[++i]);
+    } else if (arg == "--spec" && i + 1 < argc) {
+      req.spec_path = argv[++i];
+    } else if (arg == "--input-spec" && i + 1 < argc) {
+      req.input_spec_path = argv[++i];
+    } else if (arg == "--buffer-size" && i + 1 < argc) {
+      req.buffer_size = static_cast<size_t>(std::stoul(argv[++i]));
+    } else if (arg == "--timeout-ms" && i + 1 < argc) {
+      req.timeout_ms = static_cast<unsigned>(std::stoul(argv[++i]));
+    } else if (arg == "--guard-bytes" && i + 1 < argc) {
+      req.guard_bytes = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--time-reps" && i + 1 < argc) {
+      req.time_reps = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--time-warmup" && i + 1 < argc) {
+      req.time_warmup = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--device-compare") {
+      req.device_compare = true;
+    } else if (arg == "--seeds" && i + 1 < argc) {
+      if (!parse_seed_range(argv[++i], req.seed_first, req.seed_count)) {
+        std::cerr << "invalid --seeds " << argv[i] << ", expected a..b\n";
+        return 2;
+      }
+    } else if (arg == "--serve" && i + 1 < argc) {
+      serve_path = argv[++i];
+    } else if (arg == "--connect" && i + 1 < argc) {
+      connect_path = argv[++i];
+    } else if (arg == "--report" && i + 1 < argc) {
+      report_path = argv[++i];
+    } else if (arg == "--module-cache" && i + 1 < argc) {
+      module_cache = static_cast<size_t>(std::stoul(argv[++i]));
+    } else if (arg == "--streams" && i + 1 < argc) {
+      streams = std::max<size_t>(1, std::stoul(argv[++i]));
+    } else if (arg == "--devices" && i + 1 < argc) {
+      devices = static_cast<size_t>(std::stoul(argv[++i]));
+    } else if (arg == "--zygote") {
+      zygote = true;
+    } else if (arg == "--emit-spec" && i + 1 < argc) {
+      emit_spec_path = argv[++i];
+    } else if (arg == "--dump-metadata" && i + 1 < argc) {
+      dump_path = argv[++i];
+    } else if (arg == "--kernel" && i + 1 < argc) {
+      kernel_name = argv[++i];
+    } else if (arg == "--out" && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if (arg == "--gen-input" && i + 1 < argc) {
+      gen_arg = argv[++i];
+    } else if (arg == "--seed" && i + 1 < argc) {
+      gen_seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--offset" && i + 1 < argc) {
+      gen_offset = std::stoull(argv[++i]);
+    } else if (arg == "--size" && i + 1 < argc) {
+      gen_size = static_cast<size_t>(std::stoull(argv[++i]));
+    }
+  }
+
+  if (!dump_path.empty()) {
+    return dump_metadata(dump_path);
+  }
+  if (!emit_spec_path.empty() && !out_path.empty()) {
+    return emit_spec(emit_spec_path, kernel_name, out_path);
+  }
+  if (!gen_arg.empty() && !out_path.empty()) {
+    return gen_input(static_cast<uint32_t>(std::stoul(gen_arg)), gen_seed,
+                     gen_offset, gen_size, req.input_spec_path, out_path);
+  }
+
+  if (!serve_path.empty()) {
+    // A client that goes away mid-reply must not kill the server.
+    signal(SIGPIPE, SIG_IGN);
+    if (zygote) {
+      return serve_zygote(serve_path,
+                          ServerConfig{module_cache, streams, devices});
+    }
+    RunnerState state(module_cache, streams, devices);
+    return serve(serve_path, state);
+  }
+
+  if (req.hsaco_a.empty() || req.hsaco_b.empty() || req.spec_path.empty()) {
+    std::cerr << "usage: hip_runner --hsaco-a <hsaco> --hsaco-b <hsaco>... "
+                 "--spec <spec> [--buffer-size N] [--input-spec path] "
+                 "[--timeout-ms N] [--report path] [--streams N] "
+                 "[--devices N] [--device-compare] [--seeds a..b] "
+                 "[--guard-bytes N] [--time-reps N [--time-warmup N]] "
+                 "[--connect socket]\n"
+                 "       hip_runner --serve <socket|-> [--module-cache N] "
+                 "[--streams N] [--devices N] [--zygote]\n"
+                 "       hip_runner --emit-spec <hsaco> --out <spec> "
+                 "[--kernel name]\n"
+                 "       hip_runner --dump-metadata <hsaco>\n"
+                 "       hip_runner --gen-input <arg> --seed S --size N "
+                 "[--offset O] [--input-spec path] --out <file>\n";
+    return 2;
+  }
+
+  std::string message;
+  std::vector<VariantResult> variants;
+  KernelTiming reference;
+  int status = -1;
+  if (!connect_path.empty()) {
+    RunRequest remote = req;
+    remote.hsaco_a = absolute_path(req.hsaco_a);
+    for (auto &path : remote.hsaco_b) {
+      path = absolute_path(path);
+    }
+    remote.spec_path = absolute_path(req.spec_path);
+    remote.input_spec_path = absolute_path(req.input_spec_path);
+    status = run_remote(connect_path, remote, message, variants, reference);
+    if (status < 0) {
+      std::cerr << "no hip_runner server at " << connect_path
+                << ", running locally\n";
+    }
+  }
+  if (status < 0) {
+    // Room for every variant, so a seed sweep loads each module once.
+    RunnerState state(req.hsaco_b.size() + 1, streams, devices);
+    status = run_request(req, state, message, variants, reference);
+  }
+  if (status > 0 && std::all_of(variants.begin(), variants.end(),
+                                [](const VariantResult &result) {
+                                  return result.status == 0;
+                                })) {
+    // A fault, a timeout or a failure before any comparison (a bad input
+    // file, a failed hipMalloc) is answered for the whole batch; no variant
+    // may be reported as a match.
+    variants.assign(req.hsaco_b.size(), VariantResult{});
+    for (auto &result : variants) {
+      result.status = status;
+      result.message = message;
+    }
+  }
+  if (status != 0) {
+    std::cerr << message << "\n";
+  }
+  if (!report_path.empty() &&
+      !write_report(report_path, req, status, message, variants, reference)) {
+    std::cerr << "cannot write report " << report_path << "\n";
+    return 2;
+  }
+  return status;
 }
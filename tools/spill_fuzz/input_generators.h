@@ -0,0 +1,154 @@
+// Typed generators for kernel inputs, from `gen` lines of the input spec.
+//
+// Random bytes decode mostly to NaNs and denormals when a kernel reads them
+// as doubles, and then reference and test agree on garbage. A generator
+// instead fills an argument with elements of one type:
+//
+//   uniform LO HI    floats uniform in [LO, HI)
+//   positive LO HI   floats log-uniform in [LO, HI], 0 < LO <= HI
+//   range LO HI      integers uniform in [LO, HI]
+//   simplex K        floats in groups of K positive elements summing to 1,
+//                    uniform on the simplex (e.g. mass fractions)
+//
+// plus, for floats, NaNs and infinities injected at given rates. Element i
+// of argument n is drawn from Philox block i of a stream separate from the
+// raw bytes, so, as with raw inputs, any byte range can be regenerated from
+// (seed, n, offset) alone. A range that ends inside an element or simplex
+// group gets that element's or group's leading bytes.
+
+#pragma once
+
+#include "output_compare.h"
+#include "philox.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// Philox domain of generated elements; raw bytes use domain 0.
+static constexpr uint32_t kGeneratorDomain = 1;
+
+struct InputGenerator {
+  enum class Kind { kUniform, kPositive, kRange, kSimplex };
+  ElementType type = ElementType::kF64;
+  Kind kind = Kind::kUniform;
+  double lo = 0.0;
+  double hi = 1.0;
+  // kRange bounds, two's complement for signed types.
+  uint64_t int_lo = 0;
+  uint64_t int_hi = 0;
+  // Elements per simplex group; 1 for the other kinds.
+  size_t group = 1;
+  double nan_rate = 0.0;
+  double inf_rate = 0.0;
+};
+
+inline bool element_type_is_float(ElementType type) {
+  return type == ElementType::kF32 || type == ElementType::kF64;
+}
+
+// [0, 1) from the top 53 bits.
+inline double unit_interval(uint64_t bits) {
+  return static_cast<double>(bits >> 11) * 0x1.0p-53;
+}
+
+// Write `units` whole groups (group elements each) starting at group
+// `first` to out.
+inline void generate_units(const InputGenerator &gen, uint32_t seed,
+                           uint32_t arg_index, uint64_t first, size_t units,
+                           uint8_t *out) {
+  size_t width = element_size(gen.type);
+  std::vector<double> values(gen.group);
+  std::vector<uint64_t> inject(gen.group);
+  for (size_t u = 0; u < units; ++u) {
+    double sum = 0.0;
+    for (size_t j = 0; j < gen.group; ++j) {
+      uint8_t block[kPhiloxBlock];
+      uint64_t bits[2];
+      philox_block(seed, arg_index, (first + u) * gen.group + j, block,
+                   kGeneratorDomain);
+      std::memcpy(bits, block, sizeof(bits));
+      inject[j] = bits[1];
+      double r = unit_interval(bits[0]);
+      switch (gen.kind) {
+      case InputGenerator::Kind::kUniform:
+        values[j] = gen.lo + r * (gen.hi - gen.lo);
+        break;
+      case InputGenerator::Kind::kPositive:
+        values[j] = std::exp(std::log(gen.lo) +
+                             r * (std::log(gen.hi) - std::log(gen.lo)));
+        break;
+      case InputGenerator::Kind::kSimplex:
+        // Normalized unit exponentials are uniform on the simplex.
+        values[j] = -std::log1p(-r);
+        sum += values[j];
+        break;
+      case InputGenerator::Kind::kRange: {
+        uint64_t span = gen.int_hi - gen.int_lo + 1;
+        uint64_t value = gen.int_lo + (span == 0 ? bits[0] : bits[0] % span);
+        std::memcpy(out + (u * gen.group + j) * width, &value, width);
+        continue;
+      }
+      }
+    }
+    if (gen.kind == InputGenerator::Kind::kRange) {
+      continue;
+    }
+    for (size_t j = 0; j < gen.group; ++j) {
+      double value = values[j];
+      if (gen.kind == InputGenerator::Kind::kSimplex) {
+        value = sum > 0.0 ? value / sum : 1.0 / gen.group;
+      }
+      double nan_draw = static_cast<uint32_t>(inject[j]) * 0x1.0p-32;
+      double inf_draw = static_cast<uint32_t>(inject[j] >> 32) * 0x1.0p-32;
+      if (nan_draw < gen.nan_rate) {
+        value = std::numeric_limits<double>::quiet_NaN();
+      } else if (inf_draw < gen.inf_rate) {
+        value = (inject[j] & 1) ? -std::numeric_limits<double>::infinity()
+                                : std::numeric_limits<double>::infinity();
+      }
+      uint8_t *dst = out + (u * gen.group + j) * width;
+      if (gen.type == ElementType::kF32) {
+        float narrow = static_cast<float>(value);
+        std::memcpy(dst, &narrow, sizeof(narrow));
+      } else {
+        std::memcpy(dst, &value, sizeof(value));
+      }
+    }
+  }
+}
+
+// Write bytes [offset, offset + size) of gen's output for (seed, arg_index)
+// to data, on one thread.
+inline void generate_range(const InputGenerator &gen, uint8_t *data,
+                           size_t size, uint32_t seed, uint32_t arg_index,
+                           uint64_t offset) {
+  static constexpr size_t kBatchUnits = 4096;
+  size_t unit = element_size(gen.type) * gen.group;
+  uint64_t end = offset + size;
+  std::vector<uint8_t> batch;
+  for (uint64_t u = offset / unit; u * unit < end; u += kBatchUnits) {
+    size_t units = static_cast<size_t>(
+        std::min<uint64_t>(kBatchUnits, (end + unit - 1) / unit - u));
+    batch.resize(units * unit);
+    generate_units(gen, seed, arg_index, u, units, batch.data());
+    uint64_t from = std::max(offset, u * unit);
+    uint64_t to = std::min(end, (u + units) * unit);
+    std::memcpy(data + (from - offset), batch.data() + (from - u * unit),
+                static_cast<size_t>(to - from));
+  }
+}
+
+// As generate_range, split across threads.
+inline void generate_input(const InputGenerator &gen, uint8_t *data,
+                           size_t size, uint32_t seed, uint32_t arg_index,
+                           uint64_t offset = 0) {
+  size_t unit = element_size(gen.type) * gen.group;
+  parallel_fill(size, unit, [&](size_t begin, size_t n) {
+    generate_range(gen, data + begin, n, seed, arg_index, offset + begin);
+  });
+}
@@ -0,0 +1,141 @@
+"""Register-limit samplers for spill_fuzz.py.
+
+The uniform sampler draws VGPR/SGPR limits independently from the configured
+ranges. The adaptive sampler learns, per input, where spilling starts and then
+concentrates on limits around that point. Interesting allocator behaviour
+happens near the spill onset and at the register allocation granule
+boundaries around it. Far above the onset nothing spills, and far below it
+almost everything does.
+"""
+
+import random
+from pathlib import Path
+from typing import Dict, Optional, Tuple
+
+
+def gfx_major(mcpu: str) -> int:
+    """Return the major version of a gfxNNN processor name (gfx90a -> 9)."""
+    digits = mcpu[3:-2]
+    return int(digits) if mcpu.startswith("gfx") and digits.isdigit() else 0
+
+
+def vgpr_alloc_granule(mcpu: str) -> int:
+    if mcpu.startswith(("gfx90a", "gfx94", "gfx95")) or gfx_major(mcpu) >= 10:
+        return 8
+    return 4
+
+
+def sgpr_alloc_granule(mcpu: str) -> int:
+    if gfx_major(mcpu) >= 10:
+        # gfx10+ allocates a fixed SGPR block; use the encoding granule.
+        return 8
+    return 16
+
+
+class UniformSampler:
+    """Independent uniform limits; the original choose_limits behaviour."""
+
+    def __init__(self, min_vgpr: int, max_vgpr: int, min_sgpr: int, max_sgpr: int) -> None:
+        self.min_vgpr = min_vgpr
+        self.max_vgpr = max_vgpr
+        self.min_sgpr = min_sgpr
+        self.max_sgpr = max_sgpr
+
+    def choose(self, rng: random.Random, input_path: Path) -> Tuple[int, int]:
+        num_vgpr = rng.randint(self.min_vgpr, self.max_vgpr)
+        num_sgpr = rng.randint(self.min_sgpr, self.max_sgpr)
+        return num_vgpr, num_sgpr
+
+    def observe(self, input_path: Path, num_vgpr: int, num_sgpr: int,
+                spills: Optional[Tuple[int, int]]) -> None:
+        pass
+
+
+class SpillBoundary:
+    """What is known about the spill onset of one register class of one input.
+
+    `spilling` is the largest limit seen to spill and `clean` the smallest seen
+    not to. Spilling is close to monotonic in the limit, so the onset lies
+    between them.
+    """
+
+    def __init__(self, low: int, high: int, granule: int) -> None:
+        self.low = low
+        self.high = high
+        self.granule = granule
+        self.spilling: Optional[int] = None
+        self.clean: Optional[int] = None
+
+    def observe(self, limit: int, spilled: bool) -> None:
+        if spilled:
+            self.spilling = limit if self.spilling is None else max(self.spilling, limit)
+        else:
+            self.clean = limit if self.clean is None else min(self.clean, limit)
+
+    def clamp(self, limit: int) -> int:
+        return max(self.low, min(self.high, limit))
+
+    def choose(self, rng: random.Random) -> int:
+        if self.spilling is None and self.clean is None:
+            return rng.randint(self.low, self.high)
+        if self.clean is None:
+            # Everything tried so far spills: search upward.
+            return rng.randint(min(self.spilling + 1, self.high), self.high)
+        if self.spilling is None:
+            # Nothing tried so far spills: search downward.
+            return rng.randint(self.low, max(self.clean - 1, self.low))
+        below, above = sorted((self.spilling, self.clean))
+        if above - below > self.granule:
+            # Randomized bisection of the bracket.
+            return rng.randint(below + 1, above - 1)
+        # Onset located to within a granule. Sample the allocation boundaries
+        # around it, where spill counts change step by step.
+        base = (above // self.granule) * self.granule
+        step = rng.randint(-2, 2) * self.granule
+        return self.clamp(base + step + rng.choice((-1, 0, 1)))
+
+
+class AdaptiveSampler:
+    """Per-input search for the spill onset, driven by observed spill counts.
+
+    With probability `explore` a limit is drawn uniformly, so that behaviour
+    far from the onset and non-monotonic inputs keep being covered.
+    """
+
+    def __init__(self, min_vgpr: int, max_vgpr: int, min_sgpr: int, max_sgpr: int,
+                 mcpu: str, explore: float = 0.15) -> None:
+        self.uniform = UniformSampler(min_vgpr, max_vgpr, min_sgpr, max_sgpr)
+        self.vgpr_granule = vgpr_alloc_granule(mcpu)
+        self.sgpr_granule = sgpr_alloc_granule(mcpu)
+        self.explore = explore
+        self.boundaries: Dict[Path, Tuple[SpillBoundary, SpillBoundary]] = {}
+
+    def boundary(self, input_path: Path) -> Tuple[SpillBoundary, SpillBoundary]:
+        pair = self.boundaries.get(input_path)
+        if pair is None:
+            u = self.uniform
+            pair = (SpillBoundary(u.min_vgpr, u.max_vgpr, self.vgpr_granule),
+                    SpillBoundary(u.min_sgpr, u.max_sgpr, self.sgpr_granule))
+            self.boundaries[input_path] = pair
+        return pair
+
+    def choose(self, rng: random.Random, input_path: Path) -> Tuple[int, int]:
+        if rng.random() < self.explore:
+            return self.uniform.choose(rng, input_path)
+        vgpr, sgpr = self.boundary(input_path)
+        return vgpr.choose(rng), sgpr.choose(rng)
+
+    def observe(self, input_path: Path, num_vgpr: int, num_sgpr: int,
+                spills: Optional[Tuple[int, int]]) -> None:
+        if spills is None:
+            return
+        vgpr, sgpr = self.boundary(input_path)
+        vgpr.observe(num_vgpr, spills[0] > 0)
+        sgpr.observe(num_sgpr, spills[1] > 0)
+
+
+def make_sampler(kind: str, min_vgpr: int, max_vgpr: int, min_sgpr: int, max_sgpr: int,
+                 mcpu: str):
+    if kind == "uniform":
+        return UniformSampler(min_vgpr, max_vgpr, min_sgpr, max_sgpr)
+    return AdaptiveSampler(min_vgpr, max_vgpr, min_sgpr, max_sgpr, mcpu)
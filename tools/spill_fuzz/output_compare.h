@@ -0,0 +1,332 @@
+// Typed, tolerance-aware comparison of reference and test kernel outputs.
+//
+// A buffer is read as an array of one element type and checked under one of
+// three rules: exact (any bit difference fails), ULP-bounded (floats within N
+// units in the last place, integers within N) or rtol/atol
+// (|expected - actual| <= atol + rtol * |expected|). Outputs of a correct
+// variant are almost entirely bit-identical, so the scan looks for differing
+// 64-byte blocks with AVX-512BW or AVX2 when the host has them (memcmp
+// otherwise) and only decodes elements inside those blocks. That keeps the
+// cost of multi-GB buffers close to a memory-bandwidth pass. hip_runner's
+// device compare runs the same per-element rule (compare_element) on the GPU.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OUTPUT_COMPARE_X86 1
+#endif
+
+// Marks the element rule for device code too when built as HIP.
+#ifdef __HIP__
+#define OUTPUT_COMPARE_HD __host__ __device__
+#else
+#define OUTPUT_COMPARE_HD
+#endif
+
+enum class ElementType { kU8, kI32, kU32, kI64, kU64, kF32, kF64 };
+
+struct CompareSpec {
+  enum class Mode { kExact, kUlp, kTolerance };
+  ElementType type = ElementType::kU8;
+  Mode mode = Mode::kExact;
+  uint64_t max_ulp = 0;
+  double rtol = 0.0;
+  double atol = 0.0;
+
+  // The untyped default, reported bytewise as before.
+  OUTPUT_COMPARE_HD bool bytewise() const {
+    return type == ElementType::kU8 && mode == Mode::kExact;
+  }
+};
+
+struct CompareStats {
+  uint64_t elements = 0;
+  // Elements whose bits differ, and those of them outside the tolerance.
+  uint64_t differing = 0;
+  uint64_t violations = 0;
+  uint64_t first_violation = std::numeric_limits<uint64_t>::max();
+  double expected = 0.0; // at first_violation
+  double actual = 0.0;
+  double max_abs = 0.0;
+  double max_rel = 0.0;
+  uint64_t max_ulp = 0;
+};
+
+OUTPUT_COMPARE_HD inline size_t element_size(ElementType type) {
+  switch (type) {
+  case ElementType::kU8:
+    return 1;
+  case ElementType::kI32:
+  case ElementType::kU32:
+  case ElementType::kF32:
+    return 4;
+  case ElementType::kI64:
+  case ElementType::kU64:
+  case ElementType::kF64:
+    return 8;
+  }
+  return 1;
+}
+
+inline const char *element_type_name(ElementType type) {
+  switch (type) {
+  case ElementType::kU8:
+    return "u8";
+  case ElementType::kI32:
+    return "i32";
+  case ElementType::kU32:
+    return "u32";
+  case ElementType::kI64:
+    return "i64";
+  case ElementType::kU64:
+    return "u64";
+  case ElementType::kF32:
+    return "f32";
+  case ElementType::kF64:
+    return "f64";
+  }
+  return "u8";
+}
+
+inline bool parse_element_type(const std::string &name, ElementType &type) {
+  for (ElementType t : {ElementType::kU8, ElementType::kI32, ElementType::kU32,
+                        ElementType::kI64, ElementType::kU64, ElementType::kF32,
+                        ElementType::kF64}) {
+    if (name == element_type_name(t)) {
+      type = t;
+      return true;
+    }
+  }
+  return false;
+}
+
+static constexpr size_t kCompareBlockBytes = 64;
+
+// Offset of the first kCompareBlockBytes block at or after `from` (a block
+// boundary) in which a and b differ, or `size` if there is none.
+inline size_t next_difference_scalar(const uint8_t *a, const uint8_t *b,
+                                     size_t size, size_t from) {
+  for (size_t off = from; off < size; off += kCompareBlockBytes) {
+    size_t n = size - off < kCompareBlockBytes ? size - off : kCompareBlockBytes;
+    if (std::memcmp(a + off, b + off, n) != 0) {
+      return off;
+    }
+  }
+  return size;
+}
+
+#ifdef OUTPUT_COMPARE_X86
+__attribute__((target("avx2"))) inline size_t
+next_difference_avx2(const uint8_t *a, const uint8_t *b, size_t size,
+                     size_t from) {
+  size_t off = from;
+  for (; off + kCompareBlockBytes <= size; off += kCompareBlockBytes) {
+    __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + off));
+    __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + off));
+    __m256i a1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + off + 32));
+    __m256i b1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + off + 32));
+    __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(a0, b0),
+                                  _mm256_cmpeq_epi8(a1, b1));
+    if (_mm256_movemask_epi8(eq) != -1) {
+      return off;
+    }
+  }
+  return next_difference_scalar(a, b, size, off);
+}
+
+__attribute__((target("avx512bw"))) inline size_t
+next_difference_avx512(const uint8_t *a, const uint8_t *b, size_t size,
+                       size_t from) {
+  size_t off = from;
+  for (; off + kCompareBlockBytes <= size; off += kCompareBlockBytes) {
+    __m512i va = _mm512_loadu_si512(a + off);
+    __m512i vb = _mm512_loadu_si512(b + off);
+    if (_mm512_cmpneq_epi8_mask(va, vb) != 0) {
+      return off;
+    }
+  }
+  return next_difference_scalar(a, b, size, off);
+}
+#endif
+
+using NextDifferenceFn = size_t (*)(const uint8_t *, const uint8_t *, size_t,
+                                    size_t);
+
+// The widest scanner the host supports. OUTPUT_COMPARE_SCAN=avx2 or scalar
+// caps it, so tests can check the scanners against each other.
+inline NextDifferenceFn select_next_difference() {
+#ifdef OUTPUT_COMPARE_X86
+  const char *cap = std::getenv("OUTPUT_COMPARE_SCAN");
+  std::string scan = cap != nullptr ? cap : "";
+  __builtin_cpu_init();
+  if (scan != "avx2" && scan != "scalar" &&
+      __builtin_cpu_supports("avx512bw")) {
+    return next_difference_avx512;
+  }
+  if (scan != "scalar" && __builtin_cpu_supports("avx2")) {
+    return next_difference_avx2;
+  }
+#endif
+  return next_difference_scalar;
+}
+
+// Floats mapped to integers that are ordered like the values, so their
+// difference is the distance in ULPs; +0 and -0 coincide.
+OUTPUT_COMPARE_HD inline int64_t ordered_bits(uint64_t bits, unsigned width) {
+  uint64_t sign = uint64_t(1) << (width - 1);
+  int64_t magnitude = static_cast<int64_t>(bits & (sign - 1));
+  return (bits & sign) ? -magnitude : magnitude;
+}
+
+OUTPUT_COMPARE_HD inline uint64_t distance(int64_t a, int64_t b) {
+  return a > b ? static_cast<uint64_t>(a) - static_cast<uint64_t>(b)
+               : static_cast<uint64_t>(b) - static_cast<uint64_t>(a);
+}
+
+// Decode element i of each side and fold it into stats.
+OUTPUT_COMPARE_HD inline void compare_element(const uint8_t *a,
+                                              const uint8_t *b, size_t i,
+                                              const CompareSpec &spec,
+                                              CompareStats &stats) {
+  size_t width = element_size(spec.type);
+  uint64_t ra = 0, rb = 0;
+  memcpy(&ra, a + i * width, width);
+  memcpy(&rb, b + i * width, width);
+  if (ra == rb) {
+    return;
+  }
+  ++stats.differing;
+
+  double va = 0.0, vb = 0.0;
+  uint64_t ulp = 0;
+  bool is_float = false;
+  switch (spec.type) {
+  case ElementType::kU8:
+  case ElementType::kU32:
+  case ElementType::kU64:
+    va = static_cast<double>(ra);
+    vb = static_cast<double>(rb);
+    ulp = ra > rb ? ra - rb : rb - ra;
+    break;
+  case ElementType::kI32: {
+    int32_t sa, sb;
+    memcpy(&sa, &ra, 4);
+    memcpy(&sb, &rb, 4);
+    va = sa;
+    vb = sb;
+    ulp = distance(sa, sb);
+    break;
+  }
+  case ElementType::kI64: {
+    int64_t sa, sb;
+    memcpy(&sa, &ra, 8);
+    memcpy(&sb, &rb, 8);
+    va = static_cast<double>(sa);
+    vb = static_cast<double>(sb);
+    ulp = distance(sa, sb);
+    break;
+  }
+  case ElementType::kF32: {
+    float fa, fb;
+    uint32_t ba = static_cast<uint32_t>(ra), bb = static_cast<uint32_t>(rb);
+    memcpy(&fa, &ba, 4);
+    memcpy(&fb, &bb, 4);
+    va = fa;
+    vb = fb;
+    ulp = distance(ordered_bits(ra, 32), ordered_bits(rb, 32));
+    is_float = true;
+    break;
+  }
+  case ElementType::kF64:
+    memcpy(&va, &ra, 8);
+    memcpy(&vb, &rb, 8);
+    ulp = distance(ordered_bits(ra, 64), ordered_bits(rb, 64));
+    is_float = true;
+    break;
+  }
+
+  double abs_err = 0.0;
+  double rel_err = 0.0;
+  if (is_float && std::isnan(va) && std::isnan(vb)) {
+    // Differing NaN payloads are not a miscompile.
+    return;
+  }
+  // An infinity against a finite value or the opposite infinity is never
+  // within tolerance, whatever the bound: |inf - x| <= rtol * |inf| holds,
+  // and FLT_MAX is one ULP from inf.
+  bool inf_mismatch =
+      is_float && (std::isinf(va) != std::isinf(vb) ||
+                   (std::isinf(va) && std::signbit(va) != std::signbit(vb)));
+  if (is_float && (std::isnan(va) || std::isnan(vb))) {
+    abs_err = rel_err = std::numeric_limits<double>::infinity();
+    ulp = std::numeric_limits<uint64_t>::max();
+  } else {
+    abs_err = std::fabs(va - vb);
+    rel_err = va != 0.0 ? abs_err / std::fabs(va)
+                        : std::numeric_limits<double>::infinity();
+  }
+  stats.max_abs = std::max(stats.max_abs, abs_err);
+  stats.max_rel = std::max(stats.max_rel, rel_err);
+  stats.max_ulp = std::max(stats.max_ulp, ulp);
+
+  bool violation = true;
+  if (!inf_mismatch && spec.mode == CompareSpec::Mode::kUlp) {
+    violation = ulp > spec.max_ulp;
+  } else if (!inf_mismatch && spec.mode == CompareSpec::Mode::kTolerance) {
+    violation = !(abs_err <= spec.atol + spec.rtol * std::fabs(va));
+  }
+  if (violation) {
+    if (stats.violations == 0) {
+      stats.first_violation = i;
+      stats.expected = va;
+      stats.actual = vb;
+    }
+    ++stats.violations;
+  }
+}
+
+// Compare `size` bytes of reference output `expected` against `actual`.
+// Trailing bytes that do not fill an element are compared as u8, exactly, and
+// a difference there is reported as element `elements`.
+inline CompareStats compare_outputs(const uint8_t *expected,
+                                    const uint8_t *actual, size_t size,
+                                    const CompareSpec &spec) {
+  static const NextDifferenceFn next_difference = select_next_difference();
+  size_t width = element_size(spec.type);
+  size_t elements = size / width;
+  CompareSpec tail_spec;
+  CompareStats stats;
+  stats.elements = elements;
+  for (size_t off = next_difference(expected, actual, size, 0); off < size;
+       off = next_difference(expected, actual, size, off)) {
+    size_t end = std::min(off + kCompareBlockBytes, size);
+    // kCompareBlockBytes is a multiple of every element size, so blocks
+    // start on element boundaries.
+    for (size_t i = off / width; i < std::min(end / width, elements); ++i) {
+      compare_element(expected, actual, i, spec, stats);
+    }
+    for (size_t byte = std::max(off, elements * width); byte < end; ++byte) {
+      CompareStats tail;
+      compare_element(expected, actual, byte, tail_spec, tail);
+      if (tail.violations != 0 && stats.violations++ == 0) {
+        stats.first_violation = elements;
+        stats.expected = tail.expected;
+        stats.actual = tail.actual;
+      }
+    }
+    off = end;
+  }
+  return stats;
+}
@@ -0,0 +1,105 @@
+// Counter-based random input bytes (Philox4x32-10, Salmon et al., SC'11).
+//
+// Byte `offset` of argument `arg_index` under `seed` is a pure function of
+// those three values: the 16-byte block holding it is Philox of the counter
+// (block index, arg_index) under the key (seed, kPhiloxStream). Any subrange
+// can therefore be regenerated on its own, and large buffers are filled by
+// several threads that each take a disjoint range.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static constexpr uint32_t kPhiloxStream = 0x5350494C; // "SPIL"
+static constexpr size_t kPhiloxBlock = 16;
+// Below this many bytes per thread, starting threads costs more than it saves.
+static constexpr size_t kPhiloxMinChunk = size_t(1) << 20;
+
+inline void philox_round(uint32_t ctr[4], const uint32_t key[2]) {
+  uint64_t p0 = uint64_t(0xD2511F53) * ctr[0];
+  uint64_t p1 = uint64_t(0xCD9E8D57) * ctr[2];
+  uint32_t c0 = static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0];
+  uint32_t c1 = static_cast<uint32_t>(p1);
+  uint32_t c2 = static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1];
+  uint32_t c3 = static_cast<uint32_t>(p0);
+  ctr[0] = c0;
+  ctr[1] = c1;
+  ctr[2] = c2;
+  ctr[3] = c3;
+}
+
+// Philox4x32-10 of ctr under key, in place; Random123's philox4x32(ctr, key).
+inline void philox4x32_10(uint32_t ctr[4], const uint32_t key[2]) {
+  uint32_t round_key[2] = {key[0], key[1]};
+  for (int round = 0; round < 10; ++round) {
+    philox_round(ctr, round_key);
+    round_key[0] += 0x9E3779B9;
+    round_key[1] += 0xBB67AE85;
+  }
+}
+
+// The 16 random bytes of block `block` (little-endian words). `domain` picks
+// an independent stream for the same argument; raw input bytes use 0.
+inline void philox_block(uint32_t seed, uint32_t arg_index, uint64_t block,
+                         uint8_t out[kPhiloxBlock], uint32_t domain = 0) {
+  uint32_t ctr[4] = {static_cast<uint32_t>(block),
+                     static_cast<uint32_t>(block >> 32), arg_index, domain};
+  const uint32_t key[2] = {seed, kPhiloxStream};
+  philox4x32_10(ctr, key);
+  for (int w = 0; w < 4; ++w) {
+    for (int b = 0; b < 4; ++b) {
+      out[4 * w + b] = static_cast<uint8_t>(ctr[w] >> (8 * b));
+    }
+  }
+}
+
+// Write bytes [offset, offset + size) of the stream for (seed, arg_index)
+// to data, on one thread.
+inline void philox_fill_range(uint8_t *data, size_t size, uint32_t seed,
+                              uint32_t arg_index, uint64_t offset) {
+  uint8_t block[kPhiloxBlock];
+  size_t done = 0;
+  while (done < size) {
+    uint64_t at = offset + done;
+    size_t skip = static_cast<size_t>(at % kPhiloxBlock);
+    size_t n = std::min(kPhiloxBlock - skip, size - done);
+    philox_block(seed, arg_index, at / kPhiloxBlock, block);
+    std::memcpy(data + done, block + skip, n);
+    done += n;
+  }
+}
+
+// Call fill(begin, n) over disjoint ranges covering [0, size), on up to
+// hardware_concurrency threads. Ranges are multiples of `align` bytes, so a
+// generator's blocks are not split between threads.
+template <typename Fill>
+inline void parallel_fill(size_t size, size_t align, Fill fill) {
+  size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  threads = std::min(threads, size / kPhiloxMinChunk);
+  if (threads <= 1) {
+    fill(size_t(0), size);
+    return;
+  }
+  size_t chunk = (size / threads + align - 1) / align * align;
+  std::vector<std::thread> workers;
+  for (size_t begin = chunk; begin < size; begin += chunk) {
+    workers.emplace_back(fill, begin, std::min(chunk, size - begin));
+  }
+  fill(size_t(0), std::min(chunk, size));
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+// As philox_fill_range, split across threads.
+inline void philox_fill(uint8_t *data, size_t size, uint32_t seed,
+                        uint32_t arg_index, uint64_t offset = 0) {
+  parallel_fill(size, kPhiloxBlock, [=](size_t begin, size_t n) {
+    philox_fill_range(data + begin, n, seed, arg_index, offset + begin);
+  });
+}
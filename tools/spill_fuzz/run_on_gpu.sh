@@ -35,24 +35,62 @@ TOOLS_DIR="${ROOT_DIR}/tools/spill_fuzz"
 
 LLC=${SPILL_FUZZ_LLC:-${LLC:-llc}}
 LD_LLD=${SPILL_FUZZ_LLD:-${LD_LLD:-ld.lld}}
-LLVM_READOBJ=${SPILL_FUZZ_LLVM_READOBJ:-${LLVM_READOBJ:-llvm-readobj}}
 MCPU=${SPILL_FUZZ_MCPU:-gfx90a}
 BUFFER_SIZE=${SPILL_FUZZ_BUFFER_SIZE:-4096}
 KERNEL_NAME=${SPILL_FUZZ_KERNEL:-}
 GPU_STRICT=${SPILL_FUZZ_GPU_STRICT:-0}
+PREBUILT_REF_OBJ=${SPILL_FUZZ_REF_OBJ:-}
+PREBUILT_TEST_OBJ=${SPILL_FUZZ_TEST_OBJ:-}
+TIMINGS=${SPILL_FUZZ_TIMINGS:-}
+REF_CACHE=${SPILL_FUZZ_REF_CACHE:-}
+# Set by spill_fuzz.py --hip-server: run tests on the warm hip_runner server.
+HIP_RUNNER_SOCKET=${SPILL_FUZZ_HIP_RUNNER_SOCKET:-}
+# Per-kernel watchdog; hip_runner exits 124 when a kernel outlives it.
+KERNEL_TIMEOUT_MS=${SPILL_FUZZ_KERNEL_TIMEOUT_MS:-0}
+# Compare outputs on the GPU and read back only mismatch summaries.
+DEVICE_COMPARE=${SPILL_FUZZ_DEVICE_COMPARE:-0}
+# Input seed range "a..b" to sweep per test, reusing the loaded modules.
+SEEDS=${SPILL_FUZZ_SEEDS:-}
+# Canary bytes after every device buffer to catch writes past the end.
+GUARD_BYTES=${SPILL_FUZZ_GUARD_BYTES:-0}
+# Event-time the reference and test kernels over this many launches (after
+# SPILL_FUZZ_TIME_WARMUP untimed ones); 0 disables timing.
+TIME_REPS=${SPILL_FUZZ_TIME_REPS:-0}
+TIME_WARMUP=${SPILL_FUZZ_TIME_WARMUP:-3}
+# Where hip_runner writes its JSON report (verdicts and timings), if set.
+REPORT=${SPILL_FUZZ_REPORT:-}
+# Set by spill_fuzz.py, which prepares these once in-process: the reference
+# source, its reference cache key and the input spec in hip_runner's format.
+PREBUILT_REF_SRC=${SPILL_FUZZ_REF_SRC:-}
+PREBUILT_REF_KEY=${SPILL_FUZZ_REF_KEY:-}
+FLAT_INPUT_SPEC=${SPILL_FUZZ_FLAT_INPUT_SPEC:-}
 
 HIP_RUNNER="${TOOLS_DIR}/hip_runner"
-META_PARSER="${TOOLS_DIR}/parse_metadata.py"
 
 if [[ ! -x "${HIP_RUNNER}" ]]; then
   "${TOOLS_DIR}/build_hip_runner.sh"
 fi
 
+# Run a command and, when spill_fuzz.py asked for stage timings, append
+# "<stage> <start> <end>" to ${TIMINGS} (EPOCHREALTIME needs bash 5).
+timed() {
+  local stage=$1 status=0 start=${EPOCHREALTIME:-}
+  shift
+  "$@" || status=$?
+  if [[ -n "${TIMINGS}" && -n "${start}" ]]; then
+    printf '%s %s %s\n' "${stage}" "${start}" "${EPOCHREALTIME}" >> "${TIMINGS}"
+  fi
+  return ${status}
+}
+
 WORK_DIR=$(mktemp -d "${TMPDIR:-/tmp}/spill_fuzz_gpu.XXXXXX")
 trap 'rm -rf "${WORK_DIR}"' EXIT
 
-REF_MIR="${WORK_DIR}/ref.mir"
-TEST_MIR="${WORK_DIR}/test.mir"
+# Keep the input's extension: llc picks the IR or MIR parser from it.
+case "${MIR_PATH}" in
+  *.ll) REF_IN="${WORK_DIR}/ref.ll" ;;
+  *) REF_IN="${WORK_DIR}/ref.mir" ;;
+esac
 REF_OBJ="${WORK_DIR}/ref.o"
 TEST_OBJ="${WORK_DIR}/test.o"
 REF_HSACO="${WORK_DIR}/ref.hsaco"
@@ -60,95 +98,142 @@ TEST_HSACO="${WORK_DIR}/test.hsaco"
 SPEC="${WORK_DIR}/kernel.spec"
 INPUT_SPEC="${WORK_DIR}/input.spec"
 
-python3 - <<'PY' "${MIR_PATH}" "${TEST_MIR}"
+# The reference is the input with its register limits raised to 256/256,
+# rewritten by the same code spill_fuzz.py uses to apply the limits.
+if [[ -n "${PREBUILT_REF_SRC}" && -f "${PREBUILT_REF_SRC}" ]]; then
+  REF_IN=${PREBUILT_REF_SRC}
+else
+  timed prepare python3 - "${TOOLS_DIR}" "${MIR_PATH}" "${REF_IN}" <<'PY'
 import sys
 from pathlib import Path
 
-src = Path(sys.argv[1]).read_text(encoding="utf-8")
-Path(sys.argv[2]).write_text(src, encoding="utf-8")
-PY
-
-python3 - <<'PY' "${MIR_PATH}" "${REF_MIR}"
-import re
-import sys
-from pathlib import Path
+sys.path.insert(0, sys.argv[1])
+from spill_fuzz import apply_reg_limits_to_ir, rewrite_mir_with_limits
 
-src = Path(sys.argv[1]).read_text(encoding="utf-8")
-if "--- |" not in src:
-    Path(sys.argv[2]).write_text(src, encoding="utf-8")
-    sys.exit(0)
-
-pre, rest = src.split("--- |", 1)
-ir, post = rest.split("...", 1)
-
-def rewrite(line: str) -> str:
-    if line.startswith("define "):
-        if "amdgpu-num-vgpr" in line or "amdgpu-num-sgpr" in line:
-            line = re.sub(r'"amdgpu-num-vgpr"="\\d+"', '"amdgpu-num-vgpr"="256"', line)
-            line = re.sub(r'"amdgpu-num-sgpr"="\\d+"', '"amdgpu-num-sgpr"="256"', line)
-        else:
-            insert = ' "amdgpu-num-vgpr"="256" "amdgpu-num-sgpr"="256"'
-            if "{" in line:
-                line = line.replace("{", insert + " {")
-            else:
-                line = line + insert
-    return line
-
-ir_lines = [rewrite(line) for line in ir.splitlines()]
-out = pre + "--- |" + "\n".join(ir_lines) + "..." + post
-Path(sys.argv[2]).write_text(out, encoding="utf-8")
+src = Path(sys.argv[2]).read_text(encoding="utf-8")
+if sys.argv[3].endswith(".ll"):
+    ref = apply_reg_limits_to_ir(src, 256, 256) + "\n"
+else:
+    ref = rewrite_mir_with_limits(src, 256, 256)
+Path(sys.argv[3]).write_text(ref, encoding="utf-8")
 PY
+fi
 
-if ! ${LLC} -mtriple=amdgcn-amd-amdhsa -mcpu="${MCPU}" -filetype=obj -o "${REF_OBJ}" "${REF_MIR}"; then
+fail_or_skip() {
   if [[ "${GPU_STRICT}" == "1" ]]; then
     exit 1
   fi
   exit 0
+}
+
+KERNEL_ARG=()
+if [[ -n "${KERNEL_NAME}" ]]; then
+  KERNEL_ARG=(--kernel "${KERNEL_NAME}")
 fi
 
-if ! ${LLC} -mtriple=amdgcn-amd-amdhsa -mcpu="${MCPU}" -filetype=obj -o "${TEST_OBJ}" "${TEST_MIR}"; then
-  if [[ "${GPU_STRICT}" == "1" ]]; then
-    exit 1
-  fi
-  exit 0
+# The reference code object and its kernel spec are the same for every limit
+# pair of an input, so they are cached under a key of the reference source,
+# mcpu, kernel selection and the llc/ld.lld versions. An entry holds either
+# ref.hsaco and kernel.spec, or a "skip" marker when the input has no
+# compatible kernel.
+REF_ENTRY=""
+if [[ -n "${REF_CACHE}" && -n "${PREBUILT_REF_KEY}" ]]; then
+  REF_ENTRY="${REF_CACHE}/${PREBUILT_REF_KEY}"
+elif [[ -n "${REF_CACHE}" ]]; then
+  REF_KEY=$({
+    printf '%s\n%s\n' "${MCPU}" "${KERNEL_NAME}"
+    ${LLC} --version 2>&1 || true
+    ${LD_LLD} --version 2>&1 || true
+    cat "${REF_IN}"
+  } | sha256sum)
+  REF_ENTRY="${REF_CACHE}/${REF_KEY%% *}"
 fi
 
-if ! ${LD_LLD} -shared -o "${REF_HSACO}" "${REF_OBJ}"; then
-  if [[ "${GPU_STRICT}" == "1" ]]; then
-    exit 1
-  fi
+if [[ -n "${REF_ENTRY}" && -f "${REF_ENTRY}/skip" ]]; then
   exit 0
 fi
+if [[ -n "${REF_ENTRY}" && -f "${REF_ENTRY}/kernel.spec" ]]; then
+  REF_HSACO="${REF_ENTRY}/ref.hsaco"
+  SPEC="${REF_ENTRY}/kernel.spec"
+else
+  # Objects prebuilt by spill_fuzz.py --compile-server skip the llc runs.
+  if [[ -n "${PREBUILT_REF_OBJ}" && -f "${PREBUILT_REF_OBJ}" ]]; then
+    cp "${PREBUILT_REF_OBJ}" "${REF_OBJ}"
+  elif ! timed ref-llc ${LLC} -mtriple=amdgcn-amd-amdhsa -mcpu="${MCPU}" -filetype=obj -o "${REF_OBJ}" "${REF_IN}"; then
+    fail_or_skip
+  fi
 
-if ! ${LD_LLD} -shared -o "${TEST_HSACO}" "${TEST_OBJ}"; then
-  if [[ "${GPU_STRICT}" == "1" ]]; then
-    exit 1
+  if ! timed link ${LD_LLD} -shared -o "${REF_HSACO}" "${REF_OBJ}"; then
+    fail_or_skip
   fi
-  exit 0
-fi
 
-KERNEL_ARG=()
-if [[ -n "${KERNEL_NAME}" ]]; then
-  KERNEL_ARG=(--kernel "${KERNEL_NAME}")
-fi
+  status=0
+  # hip_runner reads the NT_AMDGPU_METADATA note itself; exit 3 means no
+  # compatible kernel.
+  timed metadata "${HIP_RUNNER}" --emit-spec "${REF_HSACO}" --out "${SPEC}" "${KERNEL_ARG[@]}" || status=$?
+  if [[ ${status} -ne 0 && ${status} -ne 3 ]]; then
+    exit ${status}
+  fi
 
-if ! "${META_PARSER}" --llvm-readobj "${LLVM_READOBJ}" "${REF_HSACO}" --out "${SPEC}" "${KERNEL_ARG[@]}"; then
-  status=$?
+  if [[ -n "${REF_ENTRY}" ]]; then
+    # Publish the entry with a directory rename so concurrent runs never see
+    # it half written; if another run got there first, keep its entry.
+    mkdir -p "${REF_CACHE}"
+    staging=$(mktemp -d "${REF_ENTRY}.tmp.XXXXXX")
+    if [[ ${status} -eq 3 ]]; then
+      : > "${staging}/skip"
+    else
+      cp "${REF_HSACO}" "${SPEC}" "${staging}/"
+    fi
+    mv -T "${staging}" "${REF_ENTRY}" 2>/dev/null || rm -rf "${staging}"
+  fi
   if [[ ${status} -eq 3 ]]; then
     exit 0
   fi
-  exit ${status}
+fi
+
+if [[ -n "${PREBUILT_TEST_OBJ}" && -f "${PREBUILT_TEST_OBJ}" ]]; then
+  cp "${PREBUILT_TEST_OBJ}" "${TEST_OBJ}"
+elif ! timed test-llc ${LLC} -mtriple=amdgcn-amd-amdhsa -mcpu="${MCPU}" -filetype=obj -o "${TEST_OBJ}" "${MIR_PATH}"; then
+  fail_or_skip
+fi
+
+if ! timed link ${LD_LLD} -shared -o "${TEST_HSACO}" "${TEST_OBJ}"; then
+  fail_or_skip
 fi
 
 INPUT_SPEC_ARG=()
-if [[ -n "${INPUT_SPEC_JSON}" ]]; then
-  python3 "${TOOLS_DIR}/build_input_spec.py" --in "${INPUT_SPEC_JSON}" --out "${INPUT_SPEC}"
+CONNECT_ARG=()
+if [[ -n "${HIP_RUNNER_SOCKET}" ]]; then
+  CONNECT_ARG=(--connect "${HIP_RUNNER_SOCKET}")
+fi
+COMPARE_ARG=()
+if [[ "${DEVICE_COMPARE}" == "1" ]]; then
+  COMPARE_ARG=(--device-compare)
+fi
+if [[ -n "${SEEDS}" ]]; then
+  COMPARE_ARG+=(--seeds "${SEEDS}")
+fi
+if [[ "${TIME_REPS}" != "0" ]]; then
+  COMPARE_ARG+=(--time-reps "${TIME_REPS}" --time-warmup "${TIME_WARMUP}")
+fi
+if [[ -n "${REPORT}" ]]; then
+  COMPARE_ARG+=(--report "${REPORT}")
+fi
+if [[ -n "${FLAT_INPUT_SPEC}" ]]; then
+  INPUT_SPEC_ARG=(--input-spec "${FLAT_INPUT_SPEC}")
+elif [[ -n "${INPUT_SPEC_JSON}" ]]; then
+  timed input-spec python3 "${TOOLS_DIR}/build_input_spec.py" --in "${INPUT_SPEC_JSON}" --out "${INPUT_SPEC}"
   INPUT_SPEC_ARG=(--input-spec "${INPUT_SPEC}")
 fi
 
-"${HIP_RUNNER}" \
+timed hip-runner "${HIP_RUNNER}" \
   --hsaco-a "${REF_HSACO}" \
   --hsaco-b "${TEST_HSACO}" \
   --spec "${SPEC}" \
   --buffer-size "${BUFFER_SIZE}" \
+  --timeout-ms "${KERNEL_TIMEOUT_MS}" \
+  --guard-bytes "${GUARD_BYTES}" \
+  "${CONNECT_ARG[@]}" \
+  "${COMPARE_ARG[@]}" \
   "${INPUT_SPEC_ARG[@]}"
@@ -7,36 +7,34 @@ against a MIR corpus, then relies on a GPU runner to detect issues.
 
 import argparse
 import glob
+import hashlib
+import json
+import multiprocessing
 import os
+import queue
 import random
 import re
 import shlex
 import shutil
+import signal
+import socket
+import struct
 import subprocess
 import sys
 import tempfile
+import threading
+import time
+import traceback
+from collections import OrderedDict, deque
 from pathlib import Path
-from typing import List, Optional, Tuple
-NON_HSA_SHADER_CC_RE = re.compile(r"\bamdgpu_(ps|vs|gs|hs|es|ls|cs)\b")
-NON_HSA_SHADER_ATTR_RE = re.compile(r'"amdgpu-shader-type"\s*=\s*"\w+"')
-NON_HSA_FUNC_RE = re.compile(r"\bamdgpu_cs_chain_func\b")
-WMMA_INTRINSIC_RE = re.compile(r"\bllvm\.amdgcn\.wmma\.")
-OPENCL_PRINTF_RE = re.compile(r"\bllvm\.amdgcn\.printf\b")
-FLAT_ATOMIC_FADD_RE = re.compile(r"\bllvm\.amdgcn\.flat\.atomic\.fadd\b")
-R600_INTRINSIC_RE = re.compile(r"\bllvm\.r600\.")
-LEGACY_FMA_RE = re.compile(r"\bllvm\.amdgcn\.fma\.legacy\b")
-CODE_OBJECT_VERSION_RE = re.compile(r"\bCODE_OBJECT_VERSION\b")
-DYNAMIC_ALLOCA_RE = re.compile(r"\balloca\b.*\baddrspace\(5\)\b", re.IGNORECASE)
-SMFMAC_INTRINSIC_RE = re.compile(r"\bllvm\.amdgcn\.smfmac\.")
-GLOBAL_LDS_GDS_RE = re.compile(r"@[\w\.\$]+.*addrspace\((2|3)\)")
-NON_KERNEL_DEFINE_RE = re.compile(r"^define\b(?!.*\bamdgpu_kernel\b)", re.MULTILINE)
-MFMA_INTRINSIC_RE = re.compile(r"\bllvm\.amdgcn\.mfma\.")
-INVALID_ADDRSPACECAST_RE = re.compile(r"\binvalid addrspacecast\b", re.IGNORECASE)
-GFX_CALLING_CONV_RE = re.compile(r"\bamdgpu_gfx\b")
-FDOT2_INTRINSIC_RE = re.compile(r"\bllvm\.amdgcn\.fdot2\.")
-WORKGROUP_ATTR_TEST_RE = re.compile(r"\bamdgpu-max-num-workgroups\b")
-READ_REGISTER_INVALID_RE = re.compile(r"\btest_invalid_read_m0\b")
-ATOMIC_FMAX_INTRINSIC_RE = re.compile(r"\bllvm\.amdgcn\.(raw_ptr_buffer_atomic_fmax|raw_buffer_atomic_fmax|struct_ptr_buffer_atomic_fmax|struct_buffer_atomic_fmax|image_atomic_fmax|flat_atomic_fmax|global_atomic_fmax)\b")
+from typing import Dict, List, Optional, Sequence, Set, Tuple, Union
+
+from amdgpu_metadata import spill_counts
+from build_input_spec import emit_lines
+from corpus_index import find_skip_rule, update_index
+from limit_sampler import make_sampler
+from telemetry import (LatencyHistogram, PrometheusText, TelemetrySink, read_script_timings,
+                       stage_timer)
 
 
 class FuzzConfig:
@@ -49,7 +47,8 @@ class FuzzConfig:
         num_vgpr: int,
         num_sgpr: int,
         spill_sgpr_to_vgpr: Optional[bool],
-        gpu_cmd: List[str],
+        gpu_cmd: Optional[List[str]],
+        timeouts: Optional[Dict[str, float]] = None,
     ) -> None:
         self.llc = llc
         self.mcpu = mcpu
@@ -59,6 +58,401 @@ class FuzzConfig:
         self.num_sgpr = num_sgpr
         self.spill_sgpr_to_vgpr = spill_sgpr_to_vgpr
         self.gpu_cmd = gpu_cmd
+        self.timeouts = timeouts or {}
+
+    def timeout(self, stage: str) -> Optional[float]:
+        """Seconds allowed for `stage`, or None for no limit."""
+        seconds = self.timeouts.get(stage)
+        return seconds if seconds else None
+
+
+class IterationResult:
+    PASS = "pass"
+    FAIL = "fail"
+    SKIP = "skip"
+    # A stage ran past its timeout; reason holds the stage name.
+    HANG = "hang"
+
+    def __init__(self, status: str, reason: str = "", input_path: Optional[Path] = None) -> None:
+        self.status = status
+        self.reason = reason
+        self.input_path = input_path
+        self.elapsed = 0.0
+        self.num_vgpr: Optional[int] = None
+        self.num_sgpr: Optional[int] = None
+        # (vector, sgpr) spill saves in the test compile, when it was built.
+        self.spills: Optional[Tuple[int, int]] = None
+        # Whether the verdict came from the result cache; None if not looked up.
+        self.cached: Optional[bool] = None
+        # Stage name -> wall seconds spent in it during this iteration.
+        self.stage_seconds: Dict[str, float] = {}
+        # (reference, test) median kernel microseconds, when the oracle timed them.
+        self.perf: Optional[Tuple[float, float]] = None
+        # The HIP runtime failed outside kernel execution (hip_runner exit
+        # 125): the device, not the code, is suspect.
+        self.device_fault = False
+        # The GPU command died from a signal (a GPU memory fault aborts it)
+        # rather than returning a verdict; with --devices it is rerun on
+        # another device before either the code or the device is blamed.
+        self.kernel_fault = False
+        # Whether the oracle's verdict may go to the result cache: false when
+        # the command did not complete a comparison.
+        self.cacheable = True
+        # Device the oracle ran on, in campaigns with --devices.
+        self.device: Optional[str] = None
+
+
+class StageTimeout(Exception):
+    """A stage ran past its timeout and its process (group) was killed."""
+
+    def __init__(self, stage: str, command: str, artifacts: List[Path]) -> None:
+        super().__init__(f"{stage} timed out: {command}")
+        self.stage = stage
+        self.command = command
+        self.artifacts = artifacts
+
+
+class OracleJob:
+    """A compiled candidate waiting for the GPU oracle."""
+
+    def __init__(self, cfg: FuzzConfig, input_path: Path, tmp_path: Path,
+                 ref_obj: Optional[Path], test_obj: Optional[Path],
+                 spills: Optional[Tuple[int, int]]) -> None:
+        self.cfg = cfg
+        self.input_path = input_path
+        self.tmp_path = tmp_path
+        self.ref_obj = ref_obj
+        self.test_obj = test_obj
+        self.spills = spills
+        self.compile_seconds = 0.0
+        self.stage_seconds: Dict[str, float] = {}
+        # Devices that ran the job, and the one whose kernel fault is being
+        # confirmed by a rerun elsewhere, in --devices campaigns.
+        self.tried: List[str] = []
+        self.suspect: Optional[str] = None
+
+    def result(self, status: str, reason: str = "") -> IterationResult:
+        result = IterationResult(status, reason, self.input_path)
+        result.num_vgpr = self.cfg.num_vgpr
+        result.num_sgpr = self.cfg.num_sgpr
+        result.spills = self.spills
+        result.stage_seconds = dict(self.stage_seconds)
+        return result
+
+
+class StageStats:
+    """Busy and blocked time of one pipeline stage, summed over its workers.
+
+    For the compile stage, blocked time is spent waiting for room in the full
+    oracle queue (backpressure). For the oracle stage, it is spent waiting for
+    work on an empty queue.
+    """
+
+    def __init__(self, workers: int) -> None:
+        self.workers = workers
+        self.items = 0
+        self.busy_seconds = 0.0
+        self.blocked_seconds = 0.0
+
+    def merge(self, other: "StageStats") -> None:
+        self.items += other.items
+        self.busy_seconds += other.busy_seconds
+        self.blocked_seconds += other.blocked_seconds
+
+    def to_json(self, wall_seconds: float) -> dict:
+        capacity = self.workers * wall_seconds
+        return {
+            "workers": self.workers,
+            "items": self.items,
+            "busy_seconds": self.busy_seconds,
+            "blocked_seconds": self.blocked_seconds,
+            "utilization": self.busy_seconds / capacity if capacity > 0 else 0.0,
+            "blocked_fraction": self.blocked_seconds / capacity if capacity > 0 else 0.0,
+        }
+
+
+class CampaignStats:
+    """Outcome counts and timings, mergeable across workers."""
+
+    def __init__(self) -> None:
+        self.iterations = 0
+        self.outcomes: Dict[str, int] = {}
+        self.skip_reasons: Dict[str, int] = {}
+        self.failure_reasons: Dict[str, int] = {}
+        self.hang_stages: Dict[str, int] = {}
+        self.busy_seconds = 0.0
+        self.max_iteration_seconds = 0.0
+        # Input path -> distinct (vector, sgpr) spill counts reached.
+        self.spill_behaviours: Dict[str, Set[Tuple[int, int]]] = {}
+        self.cache_lookups = 0
+        self.cache_hits = 0
+        # Set by pipelined campaigns: stage name -> StageStats, and the oracle
+        # queue depth seen by each oracle worker when it took an item.
+        self.stages: Dict[str, StageStats] = {}
+        self.queue_depth_samples: List[int] = []
+        self.iteration_latency = LatencyHistogram()
+        self.stage_latency: Dict[str, LatencyHistogram] = {}
+        # "<status>/<source>" -> count, where source is "oracle" or "cache".
+        self.verdicts: Dict[str, int] = {}
+        # Input path -> (num_vgpr, num_sgpr, spills, reference us, test us) of
+        # every timed oracle run.
+        self.perf_samples: Dict[str, List[tuple]] = {}
+        # Set by campaigns with --devices: device -> DevicePool.device_stats().
+        self.devices: Dict[str, dict] = {}
+
+    def record(self, result: IterationResult) -> None:
+        self.iterations += 1
+        self.outcomes[result.status] = self.outcomes.get(result.status, 0) + 1
+        if result.status == IterationResult.SKIP:
+            self.skip_reasons[result.reason] = self.skip_reasons.get(result.reason, 0) + 1
+        elif result.status == IterationResult.FAIL:
+            self.failure_reasons[result.reason] = self.failure_reasons.get(result.reason, 0) + 1
+        elif result.status == IterationResult.HANG:
+            self.hang_stages[result.reason] = self.hang_stages.get(result.reason, 0) + 1
+        self.busy_seconds += result.elapsed
+        self.max_iteration_seconds = max(self.max_iteration_seconds, result.elapsed)
+        if result.spills is not None and result.input_path is not None:
+            self.spill_behaviours.setdefault(str(result.input_path), set()).add(result.spills)
+        if result.cached is not None:
+            self.cache_lookups += 1
+            self.cache_hits += int(result.cached)
+        if result.cached or "oracle" in result.stage_seconds:
+            verdict = f"{result.status}/{'cache' if result.cached else 'oracle'}"
+            self.verdicts[verdict] = self.verdicts.get(verdict, 0) + 1
+        if result.perf is not None and result.input_path is not None:
+            self.perf_samples.setdefault(str(result.input_path), []).append(
+                (result.num_vgpr, result.num_sgpr, result.spills) + result.perf)
+        self.iteration_latency.add(result.elapsed)
+        for stage, seconds in result.stage_seconds.items():
+            self.stage_latency.setdefault(stage, LatencyHistogram()).add(seconds)
+
+    def merge(self, other: "CampaignStats") -> None:
+        self.iterations += other.iterations
+        for mine, theirs in ((self.outcomes, other.outcomes),
+                             (self.skip_reasons, other.skip_reasons),
+                             (self.failure_reasons, other.failure_reasons),
+                             (self.hang_stages, other.hang_stages),
+                             (self.verdicts, other.verdicts)):
+            for key, count in theirs.items():
+                mine[key] = mine.get(key, 0) + count
+        self.busy_seconds += other.busy_seconds
+        self.max_iteration_seconds = max(self.max_iteration_seconds, other.max_iteration_seconds)
+        for path, behaviours in other.spill_behaviours.items():
+            self.spill_behaviours.setdefault(path, set()).update(behaviours)
+        self.cache_lookups += other.cache_lookups
+        self.cache_hits += other.cache_hits
+        for path, samples in other.perf_samples.items():
+            self.perf_samples.setdefault(path, []).extend(samples)
+        self.iteration_latency.merge(other.iteration_latency)
+        for stage, hist in other.stage_latency.items():
+            self.stage_latency.setdefault(stage, LatencyHistogram()).merge(hist)
+
+    @property
+    def failures(self) -> int:
+        return self.outcomes.get(IterationResult.FAIL, 0)
+
+    @property
+    def hangs(self) -> int:
+        return self.outcomes.get(IterationResult.HANG, 0)
+
+    @property
+    def cache_hit_rate(self) -> float:
+        return self.cache_hits / self.cache_lookups if self.cache_lookups else 0.0
+
+    @property
+    def distinct_spill_behaviours(self) -> int:
+        return sum(len(b) for b in self.spill_behaviours.values())
+
+    def to_json(self, wall_seconds: float, jobs: int, seed: Optional[int]) -> dict:
+        return {
+            "seed": seed,
+            "jobs": jobs,
+            "iterations": self.iterations,
+            "outcomes": self.outcomes,
+            "skip_reasons": self.skip_reasons,
+            "skip_ratios": self.skip_ratios(),
+            "failure_reasons": self.failure_reasons,
+            "hang_stages": self.hang_stages,
+            "verdicts": self.verdicts,
+            "wall_seconds": wall_seconds,
+            "busy_seconds": self.busy_seconds,
+            "max_iteration_seconds": self.max_iteration_seconds,
+            "iterations_per_second": self.iterations / wall_seconds if wall_seconds > 0 else 0.0,
+            "iteration_latency": self.iteration_latency.to_json(),
+            "stage_latency": {stage: hist.to_json()
+                              for stage, hist in sorted(self.stage_latency.items())},
+            "result_cache": {
+                "lookups": self.cache_lookups,
+                "hits": self.cache_hits,
+                "hit_rate": self.cache_hit_rate,
+            },
+            "distinct_spill_behaviours": self.distinct_spill_behaviours,
+            "spill_behaviours": {path: sorted(b) for path, b in sorted(self.spill_behaviours.items())},
+            "pipeline": self.pipeline_json(wall_seconds) if self.stages else None,
+            "devices": self.devices_json(wall_seconds) if self.devices else None,
+        }
+
+    def devices_json(self, wall_seconds: float) -> Dict[str, dict]:
+        devices = {}
+        for device, info in self.devices.items():
+            capacity = info["workers"] * wall_seconds
+            devices[device] = dict(info, utilization=info["busy_seconds"] / capacity
+                                   if capacity > 0 else 0.0)
+        return devices
+
+    def skip_ratios(self) -> Dict[str, float]:
+        if not self.iterations:
+            return {}
+        return {reason: count / self.iterations for reason, count in self.skip_reasons.items()}
+
+    def prometheus(self, wall_seconds: float, labels: Dict[str, str],
+                   excluded: Optional[Dict[str, int]] = None) -> str:
+        """Render the campaign so far in the Prometheus text format."""
+        prom = PrometheusText(labels)
+        prom.family("spill_fuzz_iterations_total", "counter", "Completed fuzz iterations.")
+        prom.sample("spill_fuzz_iterations_total", self.iterations)
+        prom.family("spill_fuzz_iterations_per_second", "gauge",
+                    "Iterations per second since the campaign started.")
+        prom.sample("spill_fuzz_iterations_per_second",
+                    self.iterations / wall_seconds if wall_seconds > 0 else 0.0)
+        for name, help_text, label, counts in (
+                ("spill_fuzz_outcomes_total", "Iterations by outcome.", "status", self.outcomes),
+                ("spill_fuzz_skips_total", "Skipped iterations by reason.", "reason",
+                 self.skip_reasons),
+                ("spill_fuzz_failures_total", "Failed iterations by reason.", "reason",
+                 self.failure_reasons),
+                ("spill_fuzz_hangs_total", "Timed-out iterations by stage.", "stage",
+                 self.hang_stages),
+                ("spill_fuzz_verdicts_total", "Oracle verdicts as status/source.", "verdict",
+                 self.verdicts)):
+            prom.family(name, "counter", help_text)
+            for key, count in sorted(counts.items()):
+                prom.sample(name, count, **{label: key})
+        prom.family("spill_fuzz_result_cache_lookups_total", "counter", "Result cache lookups.")
+        prom.sample("spill_fuzz_result_cache_lookups_total", self.cache_lookups)
+        prom.family("spill_fuzz_result_cache_hits_total", "counter", "Result cache hits.")
+        prom.sample("spill_fuzz_result_cache_hits_total", self.cache_hits)
+        if excluded is not None:
+            prom.family("spill_fuzz_excluded_inputs", "gauge",
+                        "Corpus inputs excluded by the index, by reason.")
+            for reason, count in sorted(excluded.items()):
+                prom.sample("spill_fuzz_excluded_inputs", count, reason=reason)
+        prom.histogram("spill_fuzz_iteration_seconds", "Wall time per iteration.",
+                       {"all": self.iteration_latency}, "scope")
+        prom.histogram("spill_fuzz_stage_seconds", "Wall time per stage and iteration.",
+                       self.stage_latency, "stage")
+        return prom.text()
+
+    def pipeline_json(self, wall_seconds: float) -> dict:
+        depths = self.queue_depth_samples
+        return {
+            "stages": {name: stage.to_json(wall_seconds) for name, stage in self.stages.items()},
+            "queue_depth_mean": sum(depths) / len(depths) if depths else 0.0,
+            "queue_depth_max": max(depths) if depths else 0,
+        }
+
+    def write_summary(self, stream, wall_seconds: float) -> None:
+        rate = self.iterations / wall_seconds if wall_seconds > 0 else 0.0
+        counts = ", ".join(f"{k} {v}" for k, v in sorted(self.outcomes.items()))
+        stream.write(f"Iterations: {self.iterations} ({counts}) in {wall_seconds:.2f}s, "
+                     f"{rate:.2f} it/s\n")
+        if self.iterations:
+            stream.write(f"Iteration time: mean {self.busy_seconds / self.iterations:.3f}s, "
+                         f"max {self.max_iteration_seconds:.3f}s\n")
+        if self.cache_lookups:
+            stream.write(f"Result cache: {self.cache_hits}/{self.cache_lookups} hits "
+                         f"({100.0 * self.cache_hit_rate:.1f}%)\n")
+        if self.spill_behaviours:
+            stream.write(f"Spill behaviours: {self.distinct_spill_behaviours} distinct "
+                         f"(vector, sgpr) spill counts across {len(self.spill_behaviours)} inputs\n")
+        if self.stage_latency:
+            parts = ", ".join(
+                f"{stage} {hist.quantile(0.5):.3f}/{hist.quantile(0.95):.3f}/{hist.quantile(0.99):.3f}"
+                for stage, hist in sorted(self.stage_latency.items(), key=lambda kv: -kv[1].total))
+            stream.write(f"Stage latency p50/p95/p99 (s): {parts}\n")
+        if self.verdicts:
+            parts = ", ".join(f"{k}={v}" for k, v in sorted(self.verdicts.items()))
+            stream.write(f"Oracle verdicts: {parts}\n")
+        for name, stage in self.stages.items():
+            info = stage.to_json(wall_seconds)
+            blocked = "blocked on full queue" if name == "compile" else "waiting for work"
+            stream.write(f"Stage {name}: {stage.workers} workers, {stage.items} items, "
+                         f"{100.0 * info['utilization']:.0f}% busy, "
+                         f"{100.0 * info['blocked_fraction']:.0f}% {blocked}\n")
+        for device, info in self.devices_json(wall_seconds).items():
+            state = ", quarantined" if info["quarantined"] else ""
+            stream.write(f"Device {device}: {info['runs']} runs, "
+                         f"{100.0 * info['utilization']:.0f}% busy, {info['stolen']} stolen, "
+                         f"{info['faults']} faults, {info['reruns']} reruns, "
+                         f"{info['probes']} probes{state}\n")
+        for title, reasons in (("Skip reasons", self.skip_reasons),
+                               ("Failure reasons", self.failure_reasons),
+                               ("Hang stages", self.hang_stages)):
+            if reasons:
+                parts = ", ".join(f"{k}={v}" for k, v in
+                                  sorted(reasons.items(), key=lambda kv: (-kv[1], kv[0])))
+                stream.write(f"{title}: {parts}\n")
+
+
+def find_perf_anomalies(perf_samples: Dict[str, List[tuple]], threshold: float,
+                        noise: float) -> List[dict]:
+    """Timed configurations that look like spill-induced performance cliffs.
+
+    A "slowdown" is a test kernel more than `threshold` times slower than its
+    reference. A "non_monotonic" one is slower, relative to the reference, by
+    more than the `noise` fraction than a configuration of the same input with
+    no more VGPRs and no more SGPRs; the one it is compared with is the
+    fastest such smaller budget.
+    """
+    anomalies: List[dict] = []
+    for path, samples in sorted(perf_samples.items()):
+        timed = [(vgpr, sgpr, spills, ref_us, test_us, test_us / ref_us)
+                 for vgpr, sgpr, spills, ref_us, test_us in samples
+                 if vgpr is not None and sgpr is not None and ref_us > 0]
+        for vgpr, sgpr, spills, ref_us, test_us, slowdown in timed:
+            entry = {"input": path, "num_vgpr": vgpr, "num_sgpr": sgpr,
+                     "spills": list(spills) if spills is not None else None,
+                     "reference_us": ref_us, "test_us": test_us, "slowdown": slowdown}
+            if slowdown > threshold:
+                anomalies.append(dict(entry, kind="slowdown"))
+            smaller = [other for other in timed
+                       if other[0] <= vgpr and other[1] <= sgpr
+                       and (other[0], other[1]) != (vgpr, sgpr)]
+            if smaller:
+                best = min(smaller, key=lambda other: other[5])
+                if slowdown > best[5] * (1.0 + noise):
+                    anomalies.append(dict(entry, kind="non_monotonic",
+                                          compared_vgpr=best[0], compared_sgpr=best[1],
+                                          compared_slowdown=best[5]))
+    return anomalies
+
+
+# Seconds each stage may run before its process group is killed and the
+# iteration is recorded as a hang. "oracle" covers the whole GPU command.
+DEFAULT_STAGE_TIMEOUTS: Dict[str, float] = {
+    "verify": 300.0,
+    "pass": 300.0,
+    "obj": 300.0,
+    "ref-obj": 300.0,
+    "isel-snapshot": 300.0,
+    "oracle": 900.0,
+}
+
+# Exit status of a GPU command whose kernel timed out (as with timeout(1)).
+KERNEL_TIMEOUT_EXIT = 124
+# hip_runner's exit status for a HIP runtime error outside kernel execution.
+DEVICE_ERROR_EXIT = 125
+
+
+def parse_stage_timeouts(overrides: List[str]) -> Dict[str, float]:
+    timeouts = dict(DEFAULT_STAGE_TIMEOUTS)
+    for item in overrides:
+        stage, sep, value = item.partition("=")
+        if not sep or stage not in timeouts:
+            raise ValueError(f"invalid --timeout {item!r}; expected one of "
+                             f"{', '.join(sorted(timeouts))}=SECONDS")
+        timeouts[stage] = float(value)
+    return timeouts
 
 
 def parse_args() -> argparse.Namespace:
@@ -73,11 +467,88 @@ def parse_args() -> argparse.Namespace:
     parser.add_argument("--max-vgpr", type=int, default=128)
     parser.add_argument("--min-sgpr", type=int, default=8)
     parser.add_argument("--max-sgpr", type=int, default=128)
+    parser.add_argument("--sampler", choices=["adaptive", "uniform"], default="uniform",
+                        help="How register limits are chosen: 'uniform' draws them "
+                             "independently; 'adaptive' searches each input's spill onset "
+                             "and samples around it")
     parser.add_argument("--verify-machineinstrs", action="store_true")
     parser.add_argument("--spill-sgpr-to-vgpr", choices=["on", "off"], default="on")
-    parser.add_argument("--gpu-cmd", required=True,
-                        help="Command to run a GPU oracle. It receives the MIR path.")
+    parser.add_argument("--gpu-cmd", default=None,
+                        help="Command to run a GPU oracle. It receives the MIR path. "
+                             "Required unless --oracle stub.")
+    parser.add_argument("--oracle", choices=["command", "stub"], default="command",
+                        help="'command' runs --gpu-cmd; 'stub' passes every candidate "
+                             "after --stub-latency seconds, for running without a GPU")
+    parser.add_argument("--stub-latency", type=float, default=0.0)
+    parser.add_argument("--stub-fault-devices", default="",
+                        help="Comma-separated --devices on which the stub oracle reports "
+                             "every run as a runtime error, to exercise quarantine")
     parser.add_argument("--out-dir", default="spill_fuzz_out")
+    parser.add_argument("--index", default=None,
+                        help="Corpus feature index path (default: <out-dir>/corpus_index.json)")
+    parser.add_argument("--mir-cache", default=None,
+                        help="Directory for cached post-ISel MIR; iterations then resume "
+                             "from -start-after=finalize-isel")
+    parser.add_argument("--result-cache", default=None,
+                        help="Directory mapping code object hashes to oracle verdicts "
+                             "(default: <out-dir>/result_cache)")
+    parser.add_argument("--no-result-cache", action="store_true",
+                        help="Run the GPU oracle for every iteration")
+    parser.add_argument("--compile-server", default=None,
+                        help="Path to a compile_server binary; keeps parsed inputs resident "
+                             "instead of spawning llc per stage")
+    parser.add_argument("--hip-server", default=None,
+                        help="Path to a hip_runner binary to keep running as a server; GPU "
+                             "commands reach it through SPILL_FUZZ_HIP_RUNNER_SOCKET")
+    parser.add_argument("--hip-module-cache", type=int, default=16,
+                        help="Code objects the hip_runner server keeps loaded")
+    parser.add_argument("--telemetry", default=None,
+                        help="JSON-lines file with one record per iteration "
+                             "(default: <out-dir>/telemetry.jsonl)")
+    parser.add_argument("--metrics-dir", default=None,
+                        help="Directory for Prometheus textfiles (default: <out-dir>/metrics)")
+    parser.add_argument("--metrics-interval", type=float, default=15.0,
+                        help="Seconds between Prometheus textfile refreshes")
+    parser.add_argument("--timeout", action="append", default=[], metavar="STAGE=SECONDS",
+                        help="Override a stage timeout (stages: "
+                             + ", ".join(sorted(DEFAULT_STAGE_TIMEOUTS)) + "); 0 disables it. "
+                             "Repeatable.")
+    parser.add_argument("--perf-reps", type=int, default=0,
+                        help="Time the reference and test kernels over N launches per oracle "
+                             "run (SPILL_FUZZ_TIME_REPS) and report performance anomalies; "
+                             "0 disables timing")
+    parser.add_argument("--perf-warmup", type=int, default=3,
+                        help="Untimed launches before the timed ones")
+    parser.add_argument("--perf-threshold", type=float, default=2.0,
+                        help="Flag a configuration whose median kernel time exceeds the "
+                             "reference's by more than this factor")
+    parser.add_argument("--perf-noise", type=float, default=0.1,
+                        help="Relative slowdown difference tolerated before a larger "
+                             "register budget counts as slower than a smaller one")
+    parser.add_argument("--kernel-timeout", type=float, default=120.0,
+                        help="Seconds hip_runner waits for each kernel before exiting with "
+                             "status 124 (passed as SPILL_FUZZ_KERNEL_TIMEOUT_MS); 0 disables")
+    parser.add_argument("--jobs", type=int, default=1,
+                        help="Number of worker processes; each gets its own RNG stream "
+                             "and scratch directory under --out-dir")
+    parser.add_argument("--pipeline", action="store_true",
+                        help="Run --jobs compile workers feeding a bounded queue that "
+                             "--oracle-jobs oracle workers drain")
+    parser.add_argument("--oracle-jobs", type=int, default=1,
+                        help="Oracle workers in --pipeline mode")
+    parser.add_argument("--queue-depth", type=int, default=4,
+                        help="Compiled candidates that may wait for the oracle in "
+                             "--pipeline mode before compile workers block")
+    parser.add_argument("--devices", default=None,
+                        help="Comma-separated GPU indices (as HIP_VISIBLE_DEVICES takes them) "
+                             "for --pipeline oracle workers: each device gets its own queue "
+                             "and --oracle-jobs workers, and idle workers steal queued work")
+    parser.add_argument("--device-fault-limit", type=int, default=3,
+                        help="Quarantine a device after this many consecutive runs that "
+                             "failed because of the device; 0 never quarantines")
+    parser.add_argument("--device-probe-interval", type=float, default=60.0,
+                        help="Seconds before a quarantined device runs one candidate as a "
+                             "probe; a clean run restores it. 0 never probes")
     return parser.parse_args()
 
 
@@ -85,15 +556,540 @@ def collect_inputs(corpus_dir: Path) -> List[Path]:
     return sorted(p for p in corpus_dir.rglob("*.ll") if p.is_file())
 
 
-def run_cmd(cmd: List[str], cwd: Optional[Path] = None) -> Tuple[int, str, str]:
-    proc = subprocess.run(
+def filter_compatible_inputs(inputs: List[Path], index: Dict[str, dict],
+                             mcpu: str) -> Tuple[List[Path], Dict[str, int]]:
+    """Split inputs into those usable on mcpu and per-reason exclusion counts."""
+    usable = []
+    excluded: Dict[str, int] = {}
+    for path in inputs:
+        rule = find_skip_rule(index[str(path.resolve())]["features"], mcpu)
+        if rule is None:
+            usable.append(path)
+        else:
+            excluded[rule[0]] = excluded.get(rule[0], 0) + 1
+    return usable, excluded
+
+
+def run_cmd(cmd: List[str], cwd: Optional[Path] = None,
+            env: Optional[Dict[str, str]] = None, timeout: Optional[float] = None,
+            stage: str = "") -> Tuple[int, str, str]:
+    """Run cmd and return (code, stdout, stderr).
+
+    The command runs in its own process group. If it outlives `timeout`, the
+    whole group (e.g. run_on_gpu.sh and its hip_runner) is killed and
+    StageTimeout is raised, naming the input files on its command line.
+    """
+    proc = subprocess.Popen(
         cmd,
         cwd=str(cwd) if cwd else None,
+        env=env,
         stdout=subprocess.PIPE,
         stderr=subprocess.PIPE,
         universal_newlines=True,
+        start_new_session=True,
     )
-    return proc.returncode, proc.stdout, proc.stderr
+    try:
+        stdout, stderr = proc.communicate(timeout=timeout)
+    except subprocess.TimeoutExpired:
+        kill_process_group(proc)
+        raise StageTimeout(stage, shlex.join(cmd), [Path(a) for a in cmd[1:] if os.path.isfile(a)])
+    except BaseException:
+        kill_process_group(proc)
+        raise
+    return proc.returncode, stdout, stderr
+
+
+def kill_process_group(proc: subprocess.Popen) -> None:
+    try:
+        os.killpg(proc.pid, signal.SIGKILL)
+    except ProcessLookupError:
+        pass
+    proc.communicate()
+
+
+class CompileServer:
+    """Client for compile_server, which keeps parsed corpus modules resident.
+
+    The protocol is documented at the top of compile_server.cpp.
+    """
+
+    def __init__(self, exe: str, mcpu: str, max_modules: int = 64) -> None:
+        self.proc = subprocess.Popen(
+            [exe, "--mcpu", mcpu],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            universal_newlines=True,
+        )
+        self.max_modules = max_modules
+        self.modules: "OrderedDict[Path, str]" = OrderedDict()
+        self.ref_objects: Dict[Path, Path] = {}
+        self.next_id = 0
+        self.last_request = ""
+
+    def request(self, line: str) -> str:
+        self.last_request = line
+        assert self.proc.stdin is not None and self.proc.stdout is not None
+        self.proc.stdin.write(line + "\n")
+        self.proc.stdin.flush()
+        reply = self.proc.stdout.readline()
+        if not reply:
+            raise RuntimeError(f"compile server exited with {self.proc.wait()}")
+        return reply.strip()
+
+    def module_id(self, path: Path) -> str:
+        if path in self.modules:
+            self.modules.move_to_end(path)
+            return self.modules[path]
+        if len(self.modules) >= self.max_modules:
+            _, evicted = self.modules.popitem(last=False)
+            self.request(f"unload {evicted}")
+        module_id = f"m{self.next_id}"
+        self.next_id += 1
+        reply = self.request(f"load {module_id} {path}")
+        if reply != "ok":
+            raise ValueError(reply)
+        self.modules[path] = module_id
+        return module_id
+
+    def compile(self, input_path: Path, cfg: "FuzzConfig", log_path: Path,
+                num_vgpr: Optional[int], num_sgpr: Optional[int],
+                stop_after: Optional[str] = None, verify: bool = False,
+                ir_out: Optional[Path] = None, out: Optional[Path] = None,
+                spill_sgpr_to_vgpr: Optional[bool] = None,
+                stage: str = "") -> Tuple[int, str]:
+        """Run one compile and return (exit code, stderr).
+
+        stderr is only read back on failure. The server kills a compile that
+        outlives cfg.timeout(stage), and StageTimeout is raised.
+        """
+        try:
+            module_id = self.module_id(input_path)
+        except ValueError as exc:
+            return 1, str(exc)
+        fields = ["compile", module_id, f"mcpu={cfg.mcpu}", f"log={log_path}"]
+        if num_vgpr is not None:
+            fields.append(f"vgpr={num_vgpr}")
+        if num_sgpr is not None:
+            fields.append(f"sgpr={num_sgpr}")
+        if stop_after:
+            fields.append(f"stop-after={stop_after}")
+        if verify:
+            fields.append("verify=1")
+        if spill_sgpr_to_vgpr is not None:
+            fields.append(f"spill-sgpr-to-vgpr={'1' if spill_sgpr_to_vgpr else '0'}")
+        if ir_out is not None:
+            fields.append(f"ir-out={ir_out}")
+        if out is not None:
+            fields.append(f"out={out}")
+        timeout = cfg.timeout(stage)
+        if timeout is not None:
+            fields.append(f"timeout-ms={int(timeout * 1000)}")
+        reply = self.request(" ".join(fields))
+        if reply == "timeout":
+            artifacts = [p for p in (input_path, ir_out) if p is not None and p.exists()]
+            raise StageTimeout(stage, self.last_request, artifacts)
+        if not reply.startswith("result "):
+            return 1, reply
+        code = int(reply.split()[1])
+        stderr = ""
+        if code != 0:
+            stderr = log_path.read_text(encoding="utf-8", errors="replace")
+        return code, stderr
+
+    def close(self) -> None:
+        if self.proc.poll() is None:
+            try:
+                self.request("quit")
+            except (BrokenPipeError, RuntimeError):
+                pass
+            self.proc.wait()
+
+
+_COMPILE_SERVER: Optional[CompileServer] = None
+
+
+def get_compile_server(args: argparse.Namespace) -> Optional[CompileServer]:
+    """Return this process's compile server, starting it on first use."""
+    global _COMPILE_SERVER
+    if args.compile_server is None:
+        return None
+    if _COMPILE_SERVER is None:
+        _COMPILE_SERVER = CompileServer(args.compile_server, args.mcpu)
+    return _COMPILE_SERVER
+
+
+def close_compile_server() -> None:
+    global _COMPILE_SERVER
+    if _COMPILE_SERVER is not None:
+        _COMPILE_SERVER.close()
+        _COMPILE_SERVER = None
+
+
+HIP_PEAK_RE = re.compile(r"^hip_runner server: peak device memory (\d+) bytes, slab (\d+) bytes$",
+                         re.MULTILINE)
+
+
+class HipRunnerServer:
+    """Supervises one `hip_runner --serve --zygote` process for the whole campaign.
+
+    The server keeps the HIP runtime, device buffers and recent modules warm
+    in a forked worker. When a kernel faults or times out (HIP cannot cancel
+    one), the worker dies and the server answers 128 + signal or 124 and
+    switches to a pre-started spare. If the server itself exits, it is
+    restarted here; until it is back, hip_runner --connect runs tests
+    in-process. The protocol is documented in hip_runner.cpp.
+    """
+
+    def __init__(self, exe: str, module_cache: int, log_path: Path,
+                 device: Optional[str] = None) -> None:
+        self.cmd = [exe, "--module-cache", str(module_cache), "--zygote"]
+        # A server for one device of a --devices pool sees only that device.
+        self.env = None if device is None else dict(os.environ, HIP_VISIBLE_DEVICES=device)
+        # Unix socket paths are limited to ~100 bytes, so do not use out-dir.
+        self.socket_dir = tempfile.mkdtemp(prefix="spill_fuzz_hip.")
+        self.socket_path = os.path.join(self.socket_dir, "hip_runner.sock")
+        log_path.parent.mkdir(parents=True, exist_ok=True)
+        self.log_path = log_path
+        self.log = open(log_path, "a", encoding="utf-8")
+        # The log is shared with earlier campaigns in the same out-dir.
+        self.log_start = self.log.tell()
+        self.closing = False
+        self.restarts = 0
+        self.proc = self.start()
+        self.supervisor = threading.Thread(target=self.supervise, daemon=True)
+        self.supervisor.start()
+
+    def start(self) -> subprocess.Popen:
+        return subprocess.Popen(self.cmd + ["--serve", self.socket_path], env=self.env,
+                                stdin=subprocess.DEVNULL, stdout=self.log, stderr=self.log)
+
+    def supervise(self) -> None:
+        while True:
+            code = self.proc.wait()
+            if self.closing:
+                return
+            sys.stderr.write(f"hip_runner server exited with {code}; restarting\n")
+            self.restarts += 1
+            self.proc = self.start()
+
+    def close(self) -> None:
+        self.closing = True
+        try:
+            with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as conn:
+                conn.settimeout(10)
+                conn.connect(self.socket_path)
+                conn.sendall(struct.pack("<IB", 1, 2))
+                conn.recv(64)
+        except OSError:
+            pass
+        try:
+            self.proc.wait(timeout=10)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+            self.proc.wait()
+        self.supervisor.join()
+        self.log.close()
+        shutil.rmtree(self.socket_dir, ignore_errors=True)
+
+    def peak_device_memory(self) -> Tuple[int, int]:
+        """Return the largest (in use, slab) device arena, in bytes, over
+        every server started for this campaign."""
+        used = slab = 0
+        try:
+            with open(self.log_path, encoding="utf-8", errors="replace") as log:
+                log.seek(self.log_start)
+                for match in HIP_PEAK_RE.finditer(log.read()):
+                    used = max(used, int(match.group(1)))
+                    slab = max(slab, int(match.group(2)))
+        except OSError:
+            pass
+        return used, slab
+
+
+class ResultCache:
+    """Persistent map from the tested code to the GPU oracle verdict.
+
+    Many (num_vgpr, num_sgpr) pairs round to the same allocation and produce a
+    byte-identical test object. The verdict for such an object is reused, so
+    the GPU command only runs for code it has not seen. The key covers the
+    test object, the input it came from (which determines the reference), the
+    llc build, the GPU command and the SPILL_FUZZ_* environment it reads, and
+    the contents of the files behind them (`oracle_files`). Each entry is a
+    small JSON file, written atomically so workers can share the directory.
+    """
+
+    def __init__(self, cache_dir: Path, mcpu: str, llc_id: str, oracle: List[str],
+                 oracle_files: Sequence[Path] = ()) -> None:
+        self.cache_dir = cache_dir
+        oracle_env = sorted((k, v) for k, v in os.environ.items() if k.startswith("SPILL_FUZZ_"))
+        contents = [[str(path), file_digest(path)] for path in oracle_files]
+        salt = json.dumps([mcpu, llc_id, oracle, oracle_env, contents])
+        self.salt = hashlib.sha256(salt.encode("utf-8")).hexdigest()
+
+    def key(self, input_digest: str, test_obj: Path) -> str:
+        obj_digest = hashlib.sha256(test_obj.read_bytes()).hexdigest()
+        return hashlib.sha256(f"{self.salt}\0{input_digest}\0{obj_digest}".encode("utf-8")).hexdigest()
+
+    def lookup(self, key: str) -> Optional[Tuple[str, str]]:
+        try:
+            entry = json.loads((self.cache_dir / f"{key}.json").read_text(encoding="utf-8"))
+        except (OSError, ValueError):
+            return None
+        return entry["status"], entry["reason"]
+
+    def store(self, key: str, status: str, reason: str) -> None:
+        self.cache_dir.mkdir(parents=True, exist_ok=True)
+
+        def produce(tmp_path: Path) -> bool:
+            tmp_path.write_text(json.dumps({"status": status, "reason": reason}) + "\n",
+                                encoding="utf-8")
+            return True
+
+        write_atomically(self.cache_dir / f"{key}.json", produce)
+
+
+def file_digest(path: Path) -> str:
+    """SHA-256 of a file's contents, or "missing" if it cannot be read."""
+    digest = hashlib.sha256()
+    try:
+        with open(path, "rb") as f:
+            for chunk in iter(lambda: f.read(1 << 20), b""):
+                digest.update(chunk)
+    except OSError:
+        return "missing"
+    return digest.hexdigest()
+
+
+def oracle_files(args: argparse.Namespace) -> List[Path]:
+    """Files whose contents decide the GPU command's verdicts: the scripts
+    and binaries it runs and the input spec it reads, with the snapshot files
+    that spec loads buffers from."""
+    if args.oracle != "command":
+        return []
+    files = [Path(arg) for arg in args.gpu_cmd if os.path.isfile(arg)]
+    # run_on_gpu.sh runs the hip_runner next to this script; a --hip-server
+    # binary runs the kernels.
+    files.append(Path(__file__).resolve().parent / "hip_runner")
+    if args.hip_server:
+        files.append(Path(args.hip_server))
+    spec_path = oracle_input_spec(args)
+    if spec_path is not None:
+        files.append(spec_path)
+        try:
+            buffers = json.loads(spec_path.read_text(encoding="utf-8")).get("buffers", {})
+        except (OSError, ValueError, AttributeError):
+            buffers = {}
+        # Relative snapshot paths are relative to the spec, as in
+        # build_input_spec.py.
+        files.extend((spec_path.parent / str(entry["file"])).resolve()
+                     for entry in buffers.values()
+                     if isinstance(entry, dict) and "file" in entry)
+    return list(dict.fromkeys(files))
+
+
+def oracle_input_spec(args: argparse.Namespace) -> Optional[Path]:
+    """The JSON input spec run_on_gpu.sh reads: its --input-spec argument, or
+    else SPILL_FUZZ_INPUT_SPEC."""
+    if "--input-spec" in args.gpu_cmd[:-1]:
+        return Path(args.gpu_cmd[args.gpu_cmd.index("--input-spec") + 1])
+    spec_path = os.environ.get("SPILL_FUZZ_INPUT_SPEC")
+    return Path(spec_path) if spec_path else None
+
+
+def gpu_tool_versions() -> str:
+    """`--version` output of the llc and ld.lld run_on_gpu.sh uses, found the
+    way the script finds them. Part of its reference cache key."""
+    versions = ""
+    for tool in (os.environ.get("SPILL_FUZZ_LLC") or os.environ.get("LLC") or "llc",
+                 os.environ.get("SPILL_FUZZ_LLD") or os.environ.get("LD_LLD") or "ld.lld"):
+        try:
+            _, out, err = run_cmd(shlex.split(tool) + ["--version"])
+        except OSError:
+            continue
+        versions += out + err
+    return versions
+
+
+def reference_source(test_path: Path) -> str:
+    """The reference for a candidate: its source with the register limits
+    raised to 256/256."""
+    src = test_path.read_text(encoding="utf-8")
+    if test_path.suffix == ".ll":
+        return apply_reg_limits_to_ir(src, 256, 256) + "\n"
+    return rewrite_mir_with_limits(src, 256, 256)
+
+
+class CommandOracle:
+    """Runs the --gpu-cmd on a candidate; a non-zero exit is a failure.
+
+    Exit status 124 means a kernel outlived SPILL_FUZZ_KERNEL_TIMEOUT_MS and is
+    reported as a hang of the "kernel" stage rather than a failure. Status 125
+    is a HIP runtime error outside kernel execution, such as a failed
+    hipMalloc: a "gpu-device" failure that says nothing about the code and
+    counts against the device. A death by signal (status above 128) is a
+    "gpu-fault" failure of the kernel, told apart from a "gpu" mismatch or
+    error.
+
+    Cacheable are the verdicts of a completed comparison (a hip_runner
+    --report whose variant matched or mismatched, or a zero exit from a
+    command that wrote no report) and kernel faults.
+
+    The reference source and its run_on_gpu.sh cache key are computed here
+    and passed as SPILL_FUZZ_REF_SRC and SPILL_FUZZ_REF_KEY, and the input
+    spec is converted once (`flat_input_spec`), so the script starts no
+    Python and no `--version` runs per candidate.
+    """
+
+    def __init__(self, gpu_cmd: List[str], kernel_timeout: float, ref_cache: Path,
+                 hip_socket: Optional[str] = None, perf_reps: int = 0,
+                 perf_warmup: int = 3, device: Optional[str] = None,
+                 flat_input_spec: Optional[Path] = None) -> None:
+        self.gpu_cmd = gpu_cmd
+        self.flat_input_spec = flat_input_spec
+        self.ref_key_prefix = "{}\n{}\n{}".format(os.environ.get("SPILL_FUZZ_MCPU", "gfx90a"),
+                                                 os.environ.get("SPILL_FUZZ_KERNEL", ""),
+                                                 gpu_tool_versions())
+        self.device = device
+        self.kernel_timeout = kernel_timeout
+        self.ref_cache = ref_cache
+        self.hip_socket = hip_socket
+        self.perf_reps = perf_reps
+        self.perf_warmup = perf_warmup
+
+    def run(self, job: OracleJob) -> IterationResult:
+        gpu_env = dict(os.environ)
+        if job.ref_obj is not None:
+            gpu_env["SPILL_FUZZ_REF_OBJ"] = str(job.ref_obj)
+        if job.test_obj is not None:
+            gpu_env["SPILL_FUZZ_TEST_OBJ"] = str(job.test_obj)
+        # run_on_gpu.sh appends its own stage timings (link, metadata, hip
+        # runner, ...) here; other commands simply leave the file absent.
+        timings_path = job.tmp_path.with_name(
+            f"{job.tmp_path.name}.{os.getpid()}.{threading.get_ident()}.timings")
+        gpu_env["SPILL_FUZZ_TIMINGS"] = str(timings_path)
+        gpu_env["SPILL_FUZZ_KERNEL_TIMEOUT_MS"] = str(int(self.kernel_timeout * 1000))
+        # run_on_gpu.sh keeps each input's reference code object and kernel
+        # spec here, so only the test variant is built per iteration.
+        gpu_env.setdefault("SPILL_FUZZ_REF_CACHE", str(self.ref_cache))
+        if self.hip_socket is not None:
+            gpu_env["SPILL_FUZZ_HIP_RUNNER_SOCKET"] = self.hip_socket
+        if self.device is not None:
+            gpu_env["HIP_VISIBLE_DEVICES"] = self.device
+        if self.flat_input_spec is not None:
+            gpu_env["SPILL_FUZZ_FLAT_INPUT_SPEC"] = str(self.flat_input_spec)
+        # Keep the extension: llc picks the IR or MIR parser from it.
+        ref_path = timings_path.with_suffix(".ref" + job.tmp_path.suffix)
+        ref_text = reference_source(job.tmp_path)
+        ref_path.write_text(ref_text, encoding="utf-8")
+        gpu_env["SPILL_FUZZ_REF_SRC"] = str(ref_path)
+        gpu_env["SPILL_FUZZ_REF_KEY"] = hashlib.sha256(
+            (self.ref_key_prefix + ref_text).encode("utf-8")).hexdigest()
+        # hip_runner writes its verdicts, and the kernel timings if asked, to
+        # its --report JSON.
+        report_path = timings_path.with_suffix(".report.json")
+        gpu_env["SPILL_FUZZ_REPORT"] = str(report_path)
+        if self.perf_reps > 0:
+            gpu_env["SPILL_FUZZ_TIME_REPS"] = str(self.perf_reps)
+            gpu_env["SPILL_FUZZ_TIME_WARMUP"] = str(self.perf_warmup)
+
+        gpu_cmd = self.gpu_cmd + [str(job.tmp_path)]
+        report = None
+        try:
+            gcode, _, gerr = run_cmd(gpu_cmd, env=gpu_env, timeout=job.cfg.timeout("oracle"),
+                                     stage="oracle")
+        finally:
+            script_timings = read_script_timings(timings_path)
+            report = read_report(report_path)
+            for path in (timings_path, report_path, ref_path):
+                if path.exists():
+                    path.unlink()
+        if gcode == KERNEL_TIMEOUT_EXIT:
+            raise StageTimeout("kernel", shlex.join(gpu_cmd), [job.tmp_path])
+        if gcode != 0:
+            sys.stderr.write(f"GPU runner failed: {gpu_cmd}\n{gerr}\n")
+        if gcode == DEVICE_ERROR_EXIT:
+            result = job.result(IterationResult.FAIL, "gpu-device")
+            result.device_fault = True
+            result.cacheable = False
+        elif gcode < 0 or gcode > 128:
+            # run_on_gpu.sh reports a signal death as 128 + signal, and so
+            # does the hip_runner server when a worker dies mid-request.
+            result = job.result(IterationResult.FAIL, "gpu-fault")
+            result.kernel_fault = True
+        else:
+            if gcode != 0:
+                result = job.result(IterationResult.FAIL, "gpu")
+            else:
+                result = job.result(IterationResult.PASS)
+                if self.perf_reps > 0:
+                    result.perf = kernel_timings(report)
+            if report is not None:
+                result.cacheable = report_verdict(report) in ("match", "mismatch")
+            else:
+                result.cacheable = gcode == 0
+        result.stage_seconds.update(script_timings)
+        return result
+
+
+def read_report(report_path: Path) -> Optional[dict]:
+    """A hip_runner --report, or None if the command wrote none."""
+    try:
+        report = json.loads(report_path.read_text(encoding="utf-8"))
+    except (OSError, ValueError):
+        return None
+    return report if isinstance(report, dict) else None
+
+
+def report_verdict(report: dict) -> Optional[str]:
+    """The verdict of a report's (single) test variant."""
+    try:
+        return report["variants"][0]["verdict"]
+    except (KeyError, IndexError, TypeError):
+        return None
+
+
+def kernel_timings(report: Optional[dict]) -> Optional[Tuple[float, float]]:
+    """(reference, test) median microseconds from a hip_runner report, if timed."""
+    try:
+        reference = report["reference_timing"]["median_us"]
+        test = report["variants"][0]["timing"]["median_us"]
+    except (KeyError, IndexError, TypeError):
+        return None
+    return float(reference), float(test)
+
+
+class StubOracle:
+    """Passes every candidate after a fixed delay that stands in for a GPU run.
+
+    A faulty stub instead fails every candidate with a runtime error, standing
+    in for a broken GPU.
+    """
+
+    def __init__(self, latency: float, faulty: bool = False) -> None:
+        self.latency = latency
+        self.faulty = faulty
+
+    def run(self, job: OracleJob) -> IterationResult:
+        if self.latency > 0:
+            time.sleep(self.latency)
+        if self.faulty:
+            result = job.result(IterationResult.FAIL, "gpu-device")
+            result.device_fault = True
+            result.cacheable = False
+            return result
+        return job.result(IterationResult.PASS)
+
+
+def make_oracle(args: argparse.Namespace, device: Optional[str] = None):
+    """The oracle for this process, or for the workers of one --devices device."""
+    if args.oracle == "stub":
+        faulty = device is not None and device in args.stub_fault_devices.split(",")
+        return StubOracle(args.stub_latency, faulty)
+    server = args.hip_server_proc if device is None else args.device_hip_servers.get(device)
+    hip_socket = server.socket_path if server else None
+    return CommandOracle(args.gpu_cmd, args.kernel_timeout, Path(args.out_dir) / "ref_cache",
+                         hip_socket, args.perf_reps, args.perf_warmup, device,
+                         args.flat_input_spec)
 
 
 def resolve_llc(llc_arg: str) -> str:
@@ -136,146 +1132,72 @@ def resolve_gpu_cmd(gpu_cmd: str) -> List[str]:
     return argv
 
 
-def apply_reg_limits_to_ir(ir_text: str, num_vgpr: int, num_sgpr: int) -> str:
+def apply_reg_limits_to_ir(ir_text: str, num_vgpr: Optional[int],
+                           num_sgpr: Optional[int]) -> str:
+    """Set amdgpu-num-vgpr and amdgpu-num-sgpr on every function defined in
+    ir_text; a None limit is left as it is."""
+    limits = {"amdgpu-num-vgpr": num_vgpr, "amdgpu-num-sgpr": num_sgpr}
+    insert = "".join(f' "{name}"="{value}"' for name, value in limits.items()
+                     if value is not None)
+
     def insert_attrs_before_metadata(line: str, attrs: str) -> str:
         meta_idx = line.find(" !")
         if meta_idx != -1:
             return line[:meta_idx] + attrs + line[meta_idx:]
         return line + attrs
 
+    def insert_attrs_before_body(line: str, attrs: str) -> str:
+        brace_idx = line.find("{")
+        meta_idx = line.find(" !")
+        if brace_idx == -1 or (meta_idx != -1 and meta_idx < brace_idx):
+            return insert_attrs_before_metadata(line, attrs)
+        return line[:brace_idx] + attrs + line[brace_idx:]
+
     lines = ir_text.splitlines()
     out_lines = []
     in_define = False
     pending_insert = False
     for line in lines:
-        if line.startswith("define "):
+        # MIR files embed the IR module indented by two spaces.
+        stripped = line.lstrip()
+        if stripped.startswith("define "):
             in_define = True
             pending_insert = True
 
         if in_define:
-            if "amdgpu-num-vgpr" in line or "amdgpu-num-sgpr" in line:
-                line = re.sub(r'"amdgpu-num-vgpr"="\d+"',
-                              f'"amdgpu-num-vgpr"="{num_vgpr}"', line)
-                line = re.sub(r'"amdgpu-num-sgpr"="\d+"',
-                              f'"amdgpu-num-sgpr"="{num_sgpr}"', line)
+            present = [name for name in limits if name in line]
+            if present:
+                for name, value in limits.items():
+                    if value is None:
+                        continue
+                    if name in present:
+                        line = re.sub(f'"{name}"="\\d+"', f'"{name}"="{value}"', line)
+                    else:
+                        line = insert_attrs_before_body(line, f' "{name}"="{value}"')
                 pending_insert = False
             elif pending_insert and "{" in line:
-                insert = f' "amdgpu-num-vgpr"="{num_vgpr}" "amdgpu-num-sgpr"="{num_sgpr}"'
-                brace_idx = line.find("{")
-                meta_idx = line.find(" !")
-                if meta_idx != -1 and meta_idx < brace_idx:
-                    line = line[:meta_idx] + insert + line[meta_idx:]
-                else:
-                    line = line[:brace_idx] + insert + line[brace_idx:]
+                line = insert_attrs_before_body(line, insert)
                 pending_insert = False
             elif pending_insert and line.strip() == "{":
-                insert = f' "amdgpu-num-vgpr"="{num_vgpr}" "amdgpu-num-sgpr"="{num_sgpr}"'
                 if out_lines:
                     out_lines[-1] = insert_attrs_before_metadata(out_lines[-1], insert)
                 pending_insert = False
-        if in_define and line.startswith("}"):
+        if in_define and stripped.startswith("}"):
             in_define = False
             pending_insert = False
         out_lines.append(line)
     return "\n".join(out_lines)
 
 
-def has_non_hsa_shader_cc(ir_text: str) -> bool:
-    return (NON_HSA_SHADER_CC_RE.search(ir_text) is not None
-            or NON_HSA_SHADER_ATTR_RE.search(ir_text) is not None
-            or NON_HSA_FUNC_RE.search(ir_text) is not None)
-
-
-def has_unsupported_wmma(ir_text: str, mcpu: str) -> bool:
-    if not WMMA_INTRINSIC_RE.search(ir_text):
-        return False
-    return not (mcpu.startswith("gfx11") or mcpu.startswith("gfx12"))
-
-
-def has_unsupported_flat_atomic_fadd(ir_text: str, mcpu: str) -> bool:
-    if not FLAT_ATOMIC_FADD_RE.search(ir_text):
-        return False
-    return not (mcpu.startswith("gfx94") or mcpu.startswith("gfx95"))
-
-
-def has_unsupported_smfmac(ir_text: str, mcpu: str) -> bool:
-    if not SMFMAC_INTRINSIC_RE.search(ir_text):
-        return False
-    return not mcpu.startswith("gfx95")
-
-
-def has_opencl_printf(ir_text: str) -> bool:
-    return OPENCL_PRINTF_RE.search(ir_text) is not None
-
-
-def has_r600_intrinsics(ir_text: str) -> bool:
-    return R600_INTRINSIC_RE.search(ir_text) is not None
-
-
-def has_legacy_fma(ir_text: str) -> bool:
-    return LEGACY_FMA_RE.search(ir_text) is not None
-
-
-def has_code_object_version_token(ir_text: str) -> bool:
-    return CODE_OBJECT_VERSION_RE.search(ir_text) is not None
-
-
-def has_dynamic_alloca(ir_text: str) -> bool:
-    return DYNAMIC_ALLOCA_RE.search(ir_text) is not None
-
-
-def has_lds_gds_in_non_kernel(ir_text: str) -> bool:
-    return GLOBAL_LDS_GDS_RE.search(ir_text) is not None and NON_KERNEL_DEFINE_RE.search(ir_text) is not None
-
-
-def has_unsupported_mfma(ir_text: str, mcpu: str) -> bool:
-    if not MFMA_INTRINSIC_RE.search(ir_text):
-        return False
-    return not (mcpu.startswith("gfx90") or mcpu.startswith("gfx94") or mcpu.startswith("gfx95"))
-
-
-def has_invalid_addrspacecast(ir_text: str) -> bool:
-    return INVALID_ADDRSPACECAST_RE.search(ir_text) is not None
-
-
-def has_gfx_calling_conv(ir_text: str) -> bool:
-    return GFX_CALLING_CONV_RE.search(ir_text) is not None
-
-
-def has_unsupported_fdot2(ir_text: str, mcpu: str) -> bool:
-    if not FDOT2_INTRINSIC_RE.search(ir_text):
-        return False
-    return not (mcpu.startswith("gfx94") or mcpu.startswith("gfx95"))
-
-
-def has_workgroup_attr_tests(ir_text: str) -> bool:
-    return WORKGROUP_ATTR_TEST_RE.search(ir_text) is not None
-
-
-def has_invalid_read_register_tests(ir_text: str) -> bool:
-    return READ_REGISTER_INVALID_RE.search(ir_text) is not None
-
-
-def has_unsupported_atomic_fmax(ir_text: str, mcpu: str) -> bool:
-    if not ATOMIC_FMAX_INTRINSIC_RE.search(ir_text):
-        return False
-    return not (mcpu.startswith("gfx10") or mcpu.startswith("gfx11") or mcpu.startswith("gfx94") or mcpu.startswith("gfx95"))
-
-
 def rewrite_mir_with_limits(mir_text: str, num_vgpr: int, num_sgpr: int) -> str:
     if "--- |" not in mir_text:
         return mir_text
     pre, rest = mir_text.split("--- |", 1)
-    ir, post = rest.split("...", 1)
+    # The embedded IR ends at the YAML document end marker, not at the first
+    # "..." (vararg declarations contain one).
+    ir, post = rest.split("\n...\n", 1)
     ir = apply_reg_limits_to_ir(ir, num_vgpr, num_sgpr)
-    return pre + "--- |" + ir + "..." + post
-
-
-def choose_limits(rng: random.Random, min_vgpr: int, max_vgpr: int,
-                  min_sgpr: int, max_sgpr: int) -> Tuple[int, int]:
-    num_vgpr = rng.randint(min_vgpr, max_vgpr)
-    num_sgpr = rng.randint(min_sgpr, max_sgpr)
-    return num_vgpr, num_sgpr
+    return pre + "--- |" + ir + "\n...\n" + post
 
 
 def resolve_pass_name(passes: str) -> str:
@@ -287,7 +1209,8 @@ def resolve_pass_name(passes: str) -> str:
     return pass_list[0]
 
 
-def build_llc_cmd_for_pass(cfg: FuzzConfig, ir_path: Path, pass_name: str) -> List[str]:
+def build_llc_cmd_for_pass(cfg: FuzzConfig, ir_path: Path, pass_name: str,
+                           start_after: Optional[str] = None) -> List[str]:
     cmd = [
         cfg.llc,
         f"-mtriple=amdgcn-amd-amdhsa",
@@ -298,6 +1221,8 @@ def build_llc_cmd_for_pass(cfg: FuzzConfig, ir_path: Path, pass_name: str) -> Li
         "/dev/null",
         str(ir_path),
     ]
+    if start_after is not None:
+        cmd.append(f"-start-after={start_after}")
     if cfg.verify_machine_instrs:
         cmd.append("-verify-machineinstrs")
     if cfg.spill_sgpr_to_vgpr is not None:
@@ -305,9 +1230,42 @@ def build_llc_cmd_for_pass(cfg: FuzzConfig, ir_path: Path, pass_name: str) -> Li
     return cmd
 
 
-def build_llc_cmd(cfg: FuzzConfig, ir_path: Path) -> List[str]:
+def build_llc_cmd(cfg: FuzzConfig, ir_path: Path, start_after: Optional[str] = None) -> List[str]:
     pass_name = resolve_pass_name(cfg.passes)
-    return build_llc_cmd_for_pass(cfg, ir_path, pass_name)
+    return build_llc_cmd_for_pass(cfg, ir_path, pass_name, start_after)
+
+
+def build_obj_cmd(cfg: FuzzConfig, in_path: Path, out_path: Path,
+                  start_after: Optional[str] = None) -> List[str]:
+    cmd = [
+        cfg.llc,
+        "-mtriple=amdgcn-amd-amdhsa",
+        f"-mcpu={cfg.mcpu}",
+        "-filetype=obj",
+        "-o",
+        str(out_path),
+        str(in_path),
+    ]
+    if start_after is not None:
+        cmd.append(f"-start-after={start_after}")
+    if cfg.spill_sgpr_to_vgpr is not None:
+        cmd.append(f"-amdgpu-spill-sgpr-to-vgpr={'1' if cfg.spill_sgpr_to_vgpr else '0'}")
+    return cmd
+
+
+def build_isel_snapshot_cmd(cfg: FuzzConfig, ir_path: Path, out_path: Path) -> List[str]:
+    # No VGPR limit or spill options: nothing before register allocation reads
+    # them. The SGPR limit is set in ir_path (see ensure_isel_snapshot).
+    return [
+        cfg.llc,
+        "-mtriple=amdgcn-amd-amdhsa",
+        f"-mcpu={cfg.mcpu}",
+        "-stop-after=finalize-isel",
+        "-verify-machineinstrs",
+        "-o",
+        str(out_path),
+        str(ir_path),
+    ]
 
 
 def build_pre_ra_verifier_cmd(cfg: FuzzConfig, ir_path: Path) -> List[str]:
@@ -326,10 +1284,15 @@ def build_pre_ra_verifier_cmd(cfg: FuzzConfig, ir_path: Path) -> List[str]:
     return cmd
 
 
-def run_iteration(rng: random.Random, inputs: List[Path], out_dir: Path, args: argparse.Namespace) -> int:
+def compile_candidate(rng: random.Random, sampler, inputs: List[Path], out_dir: Path,
+                      args: argparse.Namespace) -> Union[IterationResult, OracleJob]:
+    """Pick a configuration and run the compile stages.
+
+    Returns the final result when compilation fails or the result cache already
+    has a verdict, and otherwise the job for the oracle stage.
+    """
     input_path = rng.choice(inputs)
-    num_vgpr, num_sgpr = choose_limits(rng, args.min_vgpr, args.max_vgpr,
-                                       args.min_sgpr, args.max_sgpr)
+    num_vgpr, num_sgpr = sampler.choose(rng, input_path)
     spill_sgpr = None
     if args.spill_sgpr_to_vgpr == "on":
         spill_sgpr = True
@@ -345,92 +1308,946 @@ def run_iteration(rng: random.Random, inputs: List[Path], out_dir: Path, args: a
         num_sgpr=num_sgpr,
         spill_sgpr_to_vgpr=spill_sgpr,
         gpu_cmd=args.gpu_cmd,
+        timeouts=args.stage_timeouts,
     )
 
-    ir_text = input_path.read_text(encoding="utf-8")
-    if has_non_hsa_shader_cc(ir_text):
-        sys.stderr.write(f"Skipping non-HSA shader module: {input_path}\n")
-        return 0
-    if has_unsupported_wmma(ir_text, cfg.mcpu):
-        sys.stderr.write(f"Skipping WMMA module for mcpu {cfg.mcpu}: {input_path}\n")
-        return 0
-    if has_unsupported_flat_atomic_fadd(ir_text, cfg.mcpu):
-        sys.stderr.write(f"Skipping flat atomic fadd module for mcpu {cfg.mcpu}: {input_path}\n")
-        return 0
-    if has_unsupported_smfmac(ir_text, cfg.mcpu):
-        sys.stderr.write(f"Skipping smfmac module for mcpu {cfg.mcpu}: {input_path}\n")
-        return 0
-    if has_unsupported_mfma(ir_text, cfg.mcpu):
-        sys.stderr.write(f"Skipping mfma module for mcpu {cfg.mcpu}: {input_path}\n")
-        return 0
-    if has_opencl_printf(ir_text):
-        sys.stderr.write(f"Skipping OpenCL printf module: {input_path}\n")
-        return 0
-    if has_r600_intrinsics(ir_text):
-        sys.stderr.write(f"Skipping r600 intrinsic module: {input_path}\n")
-        return 0
-    if has_legacy_fma(ir_text):
-        sys.stderr.write(f"Skipping legacy fma intrinsic module: {input_path}\n")
-        return 0
-    if has_code_object_version_token(ir_text):
-        sys.stderr.write(f"Skipping CODE_OBJECT_VERSION module: {input_path}\n")
-        return 0
-    if has_dynamic_alloca(ir_text):
-        sys.stderr.write(f"Skipping dynamic alloca module: {input_path}\n")
-        return 0
-    if has_lds_gds_in_non_kernel(ir_text):
-        sys.stderr.write(f"Skipping LDS/GDS globals in non-kernel module: {input_path}\n")
-        return 0
-    if has_invalid_addrspacecast(ir_text):
-        sys.stderr.write(f"Skipping invalid addrspacecast module: {input_path}\n")
-        return 0
-    if has_gfx_calling_conv(ir_text):
-        sys.stderr.write(f"Skipping amdgpu_gfx calling convention module: {input_path}\n")
-        return 0
-    if has_unsupported_fdot2(ir_text, cfg.mcpu):
-        sys.stderr.write(f"Skipping fdot2 module for mcpu {cfg.mcpu}: {input_path}\n")
-        return 0
-    if has_workgroup_attr_tests(ir_text):
-        sys.stderr.write(f"Skipping workgroup attribute error test module: {input_path}\n")
-        return 0
-    if has_invalid_read_register_tests(ir_text):
-        sys.stderr.write(f"Skipping invalid read_register test module: {input_path}\n")
-        return 0
-    if has_unsupported_atomic_fmax(ir_text, cfg.mcpu):
-        sys.stderr.write(f"Skipping atomic fmax module for mcpu {cfg.mcpu}: {input_path}\n")
-        return 0
-
-    mutated_text = apply_reg_limits_to_ir(ir_text, num_vgpr, num_sgpr)
     out_dir.mkdir(parents=True, exist_ok=True)
+    timings: Dict[str, float] = {}
+    try:
+        outcome = run_stages(cfg, input_path, out_dir, args, timings)
+    except StageTimeout as exc:
+        outcome = hang_result(exc, input_path, args)
+    outcome.stage_seconds = timings
+    if isinstance(outcome, IterationResult):
+        outcome.num_vgpr = num_vgpr
+        outcome.num_sgpr = num_sgpr
+        sampler.observe(input_path, num_vgpr, num_sgpr, None)
+        return outcome
+    sampler.observe(input_path, num_vgpr, num_sgpr, outcome.spills)
+    with stage_timer(timings, "cache-lookup"):
+        cached = lookup_cached_verdict(outcome, args)
+    return cached if cached is not None else outcome
+
+
+def run_iteration(rng: random.Random, sampler, inputs: List[Path], out_dir: Path,
+                  args: argparse.Namespace) -> IterationResult:
+    outcome = compile_candidate(rng, sampler, inputs, out_dir, args)
+    if isinstance(outcome, OracleJob):
+        return run_oracle(outcome, args)
+    return outcome
+
+
+def run_stages(cfg: FuzzConfig, input_path: Path, out_dir: Path, args: argparse.Namespace,
+               timings: Dict[str, float]) -> Union[IterationResult, OracleJob]:
+    """Run the compile stages, adding each stage's wall time to timings."""
+    if args.mir_cache is not None:
+        return run_iteration_from_snapshot(cfg, input_path, out_dir, args, timings)
+
+    num_vgpr, num_sgpr = cfg.num_vgpr, cfg.num_sgpr
     tmp_path = out_dir / f"{input_path.stem}.vgpr{num_vgpr}.sgpr{num_sgpr}.ll"
-    tmp_path.write_text(mutated_text, encoding="utf-8")
+    server = get_compile_server(args)
+    if server is not None:
+        return run_iteration_on_server(server, cfg, input_path, tmp_path, out_dir, timings,
+                                       args.input_digests[str(input_path.resolve())])
+
+    with stage_timer(timings, "read"):
+        ir_text = input_path.read_text(encoding="utf-8")
+        mutated_text = apply_reg_limits_to_ir(ir_text, num_vgpr, num_sgpr)
+        tmp_path.write_text(mutated_text, encoding="utf-8")
 
     verify_cmd = build_pre_ra_verifier_cmd(cfg, tmp_path)
-    vcode, _, vstderr = run_cmd(verify_cmd)
+    with stage_timer(timings, "verify"):
+        vcode, _, vstderr = run_cmd(verify_cmd, timeout=cfg.timeout("verify"), stage="verify")
     if vcode != 0:
         sys.stderr.write(f"IR failed machine verifier before passes: {verify_cmd}\n{vstderr}\n")
-        return 1
+        return IterationResult(IterationResult.FAIL, "pre-ra-verifier", input_path)
 
     cmd = build_llc_cmd(cfg, tmp_path)
-    code, _, stderr = run_cmd(cmd)
+    with stage_timer(timings, "pass"):
+        code, _, stderr = run_cmd(cmd, timeout=cfg.timeout("pass"), stage="pass")
     if code != 0:
         sys.stderr.write(f"llc failed: {cmd}\n{stderr}\n")
-        return 1
-
-    gpu_cmd = cfg.gpu_cmd + [str(tmp_path)]
-    gcode, _, gerr = run_cmd(gpu_cmd)
-    if gcode != 0:
-        sys.stderr.write(f"GPU runner failed: {gpu_cmd}\n{gerr}\n")
-        return 1
-
-    return 0
+        return IterationResult(IterationResult.FAIL, "llc", input_path)
+
+    test_obj = tmp_path.with_suffix(".o")
+    cmd = build_obj_cmd(cfg, tmp_path, test_obj)
+    with stage_timer(timings, "obj"):
+        ocode, _, ostderr = run_cmd(cmd, timeout=cfg.timeout("obj"), stage="obj")
+    if ocode != 0:
+        sys.stderr.write(f"llc failed to emit the test object: {cmd}\n{ostderr}\n")
+        return IterationResult(IterationResult.FAIL, "obj", input_path)
+    return OracleJob(cfg, input_path, tmp_path, None, test_obj, spill_counts(test_obj))
+
+
+def run_iteration_on_server(server: CompileServer, cfg: FuzzConfig, input_path: Path,
+                            tmp_path: Path, out_dir: Path, timings: Dict[str, float],
+                            input_digest: str) -> Union[IterationResult, OracleJob]:
+    """Same stages as run_iteration, but every llc run goes to the compile server.
+
+    The server also emits the reference and test code objects, which are handed
+    to the GPU command through SPILL_FUZZ_REF_OBJ/SPILL_FUZZ_TEST_OBJ so it does
+    not have to run llc again. The reference is named by the input's digest:
+    corpus files in different directories can share a stem.
+    """
+    log_path = out_dir / "compile_server.log"
+    with stage_timer(timings, "verify"):
+        vcode, vstderr = server.compile(input_path, cfg, log_path, cfg.num_vgpr, cfg.num_sgpr,
+                                        stop_after="finalize-isel", verify=True, ir_out=tmp_path,
+                                        spill_sgpr_to_vgpr=cfg.spill_sgpr_to_vgpr, stage="verify")
+    if vcode != 0:
+        sys.stderr.write(f"IR failed machine verifier before passes: {server.last_request}\n"
+                         f"{vstderr}\n")
+        return IterationResult(IterationResult.FAIL, "pre-ra-verifier", input_path)
+
+    with stage_timer(timings, "pass"):
+        code, stderr = server.compile(input_path, cfg, log_path, cfg.num_vgpr, cfg.num_sgpr,
+                                      stop_after=resolve_pass_name(cfg.passes),
+                                      verify=cfg.verify_machine_instrs,
+                                      spill_sgpr_to_vgpr=cfg.spill_sgpr_to_vgpr, stage="pass")
+    if code != 0:
+        sys.stderr.write(f"llc failed: {server.last_request}\n{stderr}\n")
+        return IterationResult(IterationResult.FAIL, "llc", input_path)
+
+    test_obj = tmp_path.with_suffix(".o")
+    with stage_timer(timings, "obj"):
+        ocode, ostderr = server.compile(input_path, cfg, log_path, cfg.num_vgpr, cfg.num_sgpr,
+                                        out=test_obj, spill_sgpr_to_vgpr=cfg.spill_sgpr_to_vgpr,
+                                        stage="obj")
+    if ocode != 0:
+        sys.stderr.write(f"llc failed to emit the test object: {server.last_request}\n"
+                         f"{ostderr}\n")
+        return IterationResult(IterationResult.FAIL, "obj", input_path)
+    spills = spill_counts(test_obj)
+    ref_obj = server.ref_objects.get(input_path)
+    if ref_obj is None:
+        ref_obj = out_dir / f"{input_digest[:16]}.ref.o"
+        with stage_timer(timings, "ref-obj"):
+            rcode, _ = server.compile(input_path, cfg, log_path, 256, 256, out=ref_obj,
+                                      spill_sgpr_to_vgpr=cfg.spill_sgpr_to_vgpr, stage="ref-obj")
+        if rcode == 0:
+            server.ref_objects[input_path] = ref_obj
+        else:
+            ref_obj = None
+    return OracleJob(cfg, input_path, tmp_path, ref_obj, test_obj, spills)
+
+
+def lookup_cached_verdict(job: OracleJob, args: argparse.Namespace) -> Optional[IterationResult]:
+    """Return the recorded verdict for an identical test object, if any."""
+    cache: Optional[ResultCache] = args.result_cache_store
+    if cache is None or job.test_obj is None:
+        return None
+    verdict = cache.lookup(cache.key(args.input_digests[str(job.input_path.resolve())], job.test_obj))
+    if verdict is None:
+        return None
+    result = job.result(verdict[0], verdict[1])
+    result.cached = True
+    if result.status == IterationResult.FAIL:
+        sys.stderr.write(f"cached GPU failure for identical code: {job.tmp_path}\n")
+    return result
+
+
+def run_oracle(job: OracleJob, args: argparse.Namespace, oracle=None,
+               store: bool = True) -> IterationResult:
+    """Run the configured oracle (or `oracle`) on job and, unless `store` is
+    false, record its verdict in the result cache (see store_result)."""
+    start = time.monotonic()
+    try:
+        result = (oracle or args.oracle_impl).run(job)
+    except StageTimeout as exc:
+        exc.artifacts += [p for p in (job.ref_obj, job.test_obj)
+                          if p is not None and p not in exc.artifacts]
+        result = hang_result(exc, job.input_path, args)
+        result.num_vgpr = job.cfg.num_vgpr
+        result.num_sgpr = job.cfg.num_sgpr
+        result.spills = job.spills
+        result.stage_seconds = dict(job.stage_seconds)
+    result.stage_seconds["oracle"] = time.monotonic() - start
+    if store:
+        store_result(job, result, args)
+    return result
+
+
+def store_result(job: OracleJob, result: IterationResult, args: argparse.Namespace) -> None:
+    """Record an oracle verdict in the result cache.
+
+    Hangs are not cached: a rerun may be the only way to tell a slow machine
+    from a miscompiled loop. Neither are device errors, which are the
+    device's rather than the code's, nor runs that did not complete a
+    comparison.
+    """
+    cache: Optional[ResultCache] = args.result_cache_store
+    if (cache is not None and job.test_obj is not None and result.status != IterationResult.HANG
+            and not result.device_fault and result.cacheable):
+        cache.store(cache.key(args.input_digests[str(job.input_path.resolve())], job.test_obj),
+                    result.status, result.reason)
+        result.cached = False
+
+
+def hang_result(exc: StageTimeout, input_path: Path, args: argparse.Namespace) -> IterationResult:
+    """Preserve the artifacts of a timed-out stage and return its HANG result."""
+    dest = preserve_hang(Path(args.out_dir) / "hangs", input_path, exc)
+    sys.stderr.write(f"{exc}\nartifacts preserved in {dest}\n")
+    return IterationResult(IterationResult.HANG, exc.stage, input_path)
+
+
+def preserve_hang(hangs_dir: Path, input_path: Path, exc: StageTimeout) -> Path:
+    """Copy the artifacts of a hang to their own directory for reproduction."""
+    hangs_dir.mkdir(parents=True, exist_ok=True)
+    prefix = f"{input_path.stem}.{exc.stage}.{time.strftime('%Y%m%d-%H%M%S')}-{os.getpid()}."
+    dest = Path(tempfile.mkdtemp(prefix=prefix, dir=str(hangs_dir)))
+    for artifact in exc.artifacts:
+        if artifact.is_file():
+            shutil.copy2(artifact, dest / artifact.name)
+    (dest / "command.txt").write_text(f"input: {input_path}\nstage: {exc.stage}\n{exc.command}\n",
+                                      encoding="utf-8")
+    return dest
+
+
+def llc_build_id(llc: str) -> str:
+    """Identify an llc build, so cached MIR is never reused across compilers."""
+    path = os.path.realpath(llc)
+    st = os.stat(path)
+    _, version, _ = run_cmd([llc, "--version"])
+    ident = f"{path}\0{st.st_size}\0{st.st_mtime_ns}\0{version}"
+    return hashlib.sha256(ident.encode("utf-8")).hexdigest()[:16]
+
+
+def write_atomically(path: Path, produce) -> bool:
+    """Call produce(tmp_path) and rename the result into place if it succeeds.
+
+    Workers share the cache directory, so entries only ever appear complete.
+    """
+    tmp_path = path.with_name(f"{path.name}.tmp{os.getpid()}")
+    try:
+        ok = produce(tmp_path)
+    except BaseException:
+        if tmp_path.exists():
+            tmp_path.unlink()
+        raise
+    if ok:
+        os.replace(tmp_path, path)
+    elif tmp_path.exists():
+        tmp_path.unlink()
+    return ok
+
+
+def isel_snapshot_key(input_digest: str, mcpu: str, llc_id: str) -> str:
+    """The post-ISel MIR cache key: input content, mcpu and llc build. Each
+    SGPR budget has its own snapshot under it (see ensure_isel_snapshot)."""
+    return hashlib.sha256(f"{input_digest}\0{mcpu}\0{llc_id}".encode("utf-8")).hexdigest()
+
+
+def ensure_isel_snapshot(cfg: FuzzConfig, input_path: Path, input_digest: str,
+                         cache_dir: Path, llc_id: str, server: Optional[CompileServer],
+                         num_sgpr: int) -> Tuple[Optional[Path], str, str, bool]:
+    """Return (snapshot path or None, cache key, verifier stderr, whether the
+    verifier failure was already cached).
+
+    ISel reserves the scratch resource descriptor in the highest SGPRs the
+    budget allows and records it in machineFunctionInfo (scratchRSrcReg), so
+    the snapshot is built with amdgpu-num-sgpr set and keyed by num_sgpr as
+    well. The post-ISel MIR is verified with -verify-machineinstrs when it is
+    first built; a verifier failure is cached per input, so it is not
+    recomputed for other budgets.
+    """
+    base = isel_snapshot_key(input_digest, cfg.mcpu, llc_id)
+    key = f"{base}.sgpr{num_sgpr}"
+    mir_path = cache_dir / f"{key}.isel.mir"
+    failed_path = cache_dir / f"{base}.verify-failed"
+    if mir_path.exists():
+        return mir_path, key, "", False
+    if failed_path.exists():
+        return None, key, failed_path.read_text(encoding="utf-8", errors="replace"), True
+
+    cache_dir.mkdir(parents=True, exist_ok=True)
+    stderr = ""
+
+    def produce(tmp_path: Path) -> bool:
+        nonlocal stderr
+        if server is not None:
+            code, stderr = server.compile(input_path, cfg, cache_dir / f"{key}.log", None,
+                                          num_sgpr, stop_after="finalize-isel", verify=True,
+                                          out=tmp_path, stage="isel-snapshot")
+            return code == 0
+        ir_path = tmp_path.with_name(tmp_path.name + ".ll")
+        ir_path.write_text(apply_reg_limits_to_ir(input_path.read_text(encoding="utf-8"),
+                                                  None, num_sgpr) + "\n", encoding="utf-8")
+        try:
+            code, _, stderr = run_cmd(build_isel_snapshot_cmd(cfg, ir_path, tmp_path),
+                                      timeout=cfg.timeout("isel-snapshot"), stage="isel-snapshot")
+        finally:
+            ir_path.unlink()
+        return code == 0
+
+    if write_atomically(mir_path, produce):
+        return mir_path, key, "", False
+    failed_path.write_text(stderr, encoding="utf-8")
+    return None, key, stderr, False
+
+
+def run_iteration_from_snapshot(cfg: FuzzConfig, input_path: Path, out_dir: Path,
+                                args: argparse.Namespace,
+                                timings: Dict[str, float]) -> Union[IterationResult, OracleJob]:
+    """Run the post-RA stages of an iteration from the cached post-ISel MIR.
+
+    The snapshot for the configuration's SGPR budget is resumed with the
+    register limits applied to the function attributes embedded in the MIR,
+    and every llc run resumes with -start-after=finalize-isel. The GPU command
+    is always handed both objects: rebuilding them from the post-ISel MIR
+    without -start-after would run a different pipeline. A verifier failure
+    is reported once; later draws of the same input find it cached and skip.
+    """
+    cache_dir = Path(args.mir_cache)
+    input_digest = args.input_digests[str(input_path.resolve())]
+    with stage_timer(timings, "isel-snapshot"):
+        snapshot, _, vstderr, known = ensure_isel_snapshot(
+            cfg, input_path, input_digest, cache_dir, args.llc_build_id,
+            get_compile_server(args), cfg.num_sgpr)
+    if snapshot is None and known:
+        return IterationResult(IterationResult.SKIP, "pre-ra-verifier", input_path)
+    if snapshot is None:
+        sys.stderr.write(f"IR failed machine verifier before passes: {input_path}\n{vstderr}\n")
+        return IterationResult(IterationResult.FAIL, "pre-ra-verifier", input_path)
+
+    tmp_path = out_dir / f"{input_path.stem}.vgpr{cfg.num_vgpr}.sgpr{cfg.num_sgpr}.mir"
+    with stage_timer(timings, "read"):
+        mir_text = snapshot.read_text(encoding="utf-8")
+        tmp_path.write_text(rewrite_mir_with_limits(mir_text, cfg.num_vgpr, cfg.num_sgpr),
+                            encoding="utf-8")
+
+    cmd = build_llc_cmd(cfg, tmp_path, start_after="finalize-isel")
+    with stage_timer(timings, "pass"):
+        code, _, stderr = run_cmd(cmd, timeout=cfg.timeout("pass"), stage="pass")
+    if code != 0:
+        sys.stderr.write(f"llc failed: {cmd}\n{stderr}\n")
+        return IterationResult(IterationResult.FAIL, "llc", input_path)
+
+    test_obj = tmp_path.with_suffix(".o")
+    cmd = build_obj_cmd(cfg, tmp_path, test_obj, start_after="finalize-isel")
+    with stage_timer(timings, "obj"):
+        ocode, _, ostderr = run_cmd(cmd, timeout=cfg.timeout("obj"), stage="obj")
+    if ocode != 0:
+        sys.stderr.write(f"llc failed to emit the test object: {cmd}\n{ostderr}\n")
+        return IterationResult(IterationResult.FAIL, "obj", input_path)
+    spills = spill_counts(test_obj)
+    with stage_timer(timings, "isel-snapshot"):
+        ref_snapshot, key, _, _ = ensure_isel_snapshot(
+            cfg, input_path, input_digest, cache_dir, args.llc_build_id,
+            get_compile_server(args), 256)
+    if ref_snapshot is None:
+        sys.stderr.write(f"IR failed machine verifier with the reference limits: {input_path}\n")
+        return IterationResult(IterationResult.FAIL, "pre-ra-verifier", input_path)
+    ref_obj = cache_dir / f"{key}.ref.o"
+    if not ref_obj.exists():
+        ref_mir = cache_dir / f"{key}.ref.mir"
+
+        def write_ref_mir(tmp: Path) -> bool:
+            tmp.write_text(rewrite_mir_with_limits(ref_snapshot.read_text(encoding="utf-8"),
+                                                   256, 256), encoding="utf-8")
+            return True
+
+        def build_ref_obj(tmp: Path) -> bool:
+            cmd = build_obj_cmd(cfg, ref_mir, tmp, start_after="finalize-isel")
+            return run_cmd(cmd, timeout=cfg.timeout("ref-obj"), stage="ref-obj")[0] == 0
+
+        with stage_timer(timings, "ref-obj"):
+            if not ref_mir.exists():
+                write_atomically(ref_mir, write_ref_mir)
+            built = write_atomically(ref_obj, build_ref_obj)
+        if not built:
+            sys.stderr.write(f"llc failed to emit the reference object: {ref_mir}\n")
+            return IterationResult(IterationResult.FAIL, "ref-obj", input_path)
+    return OracleJob(cfg, input_path, tmp_path, ref_obj, test_obj, spills)
+
+
+def new_sampler(args: argparse.Namespace):
+    return make_sampler(args.sampler, args.min_vgpr, args.max_vgpr,
+                        args.min_sgpr, args.max_sgpr, args.mcpu)
+
+
+def timed_iteration(rng: random.Random, sampler, inputs: List[Path], out_dir: Path,
+                    args: argparse.Namespace) -> IterationResult:
+    start = time.monotonic()
+    result = run_iteration(rng, sampler, inputs, out_dir, args)
+    result.elapsed = time.monotonic() - start
+    return result
+
+
+class CampaignRecorder:
+    """Counts results into CampaignStats and streams them to telemetry.
+
+    Every iteration is appended to the JSON-lines file. The Prometheus textfile
+    is refreshed every --metrics-interval seconds and once more on close().
+    Parallel workers each own a textfile labelled with their worker id; the
+    textfile collector reads them all.
+    """
+
+    def __init__(self, args: argparse.Namespace, stats: CampaignStats,
+                 worker_id: Optional[int] = None) -> None:
+        out_dir = Path(args.out_dir)
+        metrics_dir = Path(args.metrics_dir) if args.metrics_dir else out_dir / "metrics"
+        name = "spill_fuzz.prom" if worker_id is None else f"spill_fuzz_worker{worker_id}.prom"
+        jsonl_path = Path(args.telemetry) if args.telemetry else out_dir / "telemetry.jsonl"
+        self.sink = TelemetrySink(jsonl_path, metrics_dir / name, args.metrics_interval)
+        self.stats = stats
+        self.labels = {} if worker_id is None else {"worker": str(worker_id)}
+        # Startup figures are reported once, not by every worker.
+        self.excluded = args.excluded_inputs if worker_id in (None, 0) else None
+        self.start = time.monotonic()
+
+    def render(self) -> str:
+        return self.stats.prometheus(time.monotonic() - self.start, self.labels, self.excluded)
+
+    def record(self, result: IterationResult, worker_id: int = 0) -> None:
+        self.stats.record(result)
+        self.sink.iteration({
+            "time": time.time(),
+            "worker": worker_id,
+            "input": str(result.input_path),
+            "num_vgpr": result.num_vgpr,
+            "num_sgpr": result.num_sgpr,
+            "status": result.status,
+            "reason": result.reason,
+            "cached": result.cached,
+            "spills": result.spills,
+            "elapsed": result.elapsed,
+            "stages": result.stage_seconds,
+            "device": result.device,
+        })
+        self.sink.refresh(self.render)
+
+    def close(self) -> None:
+        self.sink.refresh(self.render, force=True)
+        self.sink.close()
+
+
+def derive_worker_seed(base_seed: int, worker_id: int) -> int:
+    """Return a 64-bit seed for worker `worker_id` that depends only on `base_seed`."""
+    digest = hashlib.sha256(f"spill_fuzz:{base_seed}:{worker_id}".encode("utf-8")).digest()
+    return int.from_bytes(digest[:8], "little")
+
+
+def worker_out_dir(out_dir: Path, worker_id: int) -> Path:
+    return out_dir / f"worker{worker_id}"
+
+
+def claim_iteration(budget) -> bool:
+    with budget.get_lock():
+        if budget.value <= 0:
+            return False
+        budget.value -= 1
+        return True
+
+
+def campaign_worker(worker_id: int, seed: int, inputs: List[Path], args: argparse.Namespace,
+                    budget, results) -> None:
+    rng = random.Random(seed)
+    sampler = new_sampler(args)
+    out_dir = worker_out_dir(Path(args.out_dir), worker_id)
+    stats = CampaignStats()
+    recorder = CampaignRecorder(args, stats, worker_id)
+    try:
+        while claim_iteration(budget):
+            recorder.record(timed_iteration(rng, sampler, inputs, out_dir, args), worker_id)
+    finally:
+        close_compile_server()
+        recorder.close()
+        results.put((worker_id, stats))
+
+
+def run_parallel_campaign(inputs: List[Path], args: argparse.Namespace,
+                          base_seed: int) -> CampaignStats:
+    # Iterations are claimed from a shared budget rather than pre-split, so a
+    # worker stuck on a slow input does not leave the others idle at the end.
+    budget = multiprocessing.Value("l", args.iterations)
+    results = multiprocessing.Queue()
+    workers = []
+    for worker_id in range(args.jobs):
+        seed = derive_worker_seed(base_seed, worker_id)
+        proc = multiprocessing.Process(
+            target=campaign_worker,
+            args=(worker_id, seed, inputs, args, budget, results),
+            name=f"spill_fuzz-worker{worker_id}",
+        )
+        proc.start()
+        workers.append(proc)
+
+    stats = CampaignStats()
+    pending = set(range(args.jobs))
+    while pending:
+        try:
+            worker_id, worker_stats = results.get(timeout=1.0)
+        except queue.Empty:
+            if not any(p.is_alive() for p in workers):
+                sys.stderr.write(f"workers exited without reporting: {sorted(pending)}\n")
+                break
+            continue
+        pending.discard(worker_id)
+        stats.merge(worker_stats)
+    for proc in workers:
+        proc.join()
+    return stats
+
+
+def compile_stage_worker(worker_id: int, seed: int, inputs: List[Path],
+                         args: argparse.Namespace, budget, jobs) -> None:
+    """Compile candidates and put them on the bounded oracle queue.
+
+    Results that need no oracle run (compile failures, cache hits) travel on
+    the same queue, so the oracle stage is the only place results are counted.
+    The last item is ("done", worker_id, StageStats).
+    """
+    rng = random.Random(seed)
+    sampler = new_sampler(args)
+    out_dir = worker_out_dir(Path(args.out_dir), worker_id)
+    stage = StageStats(1)
+    try:
+        while claim_iteration(budget):
+            start = time.monotonic()
+            outcome = compile_candidate(rng, sampler, inputs, out_dir, args)
+            elapsed = time.monotonic() - start
+            if isinstance(outcome, OracleJob):
+                outcome.compile_seconds = elapsed
+            else:
+                outcome.elapsed = elapsed
+            stage.items += 1
+            stage.busy_seconds += elapsed
+            start = time.monotonic()
+            jobs.put(("item", worker_id, outcome))
+            stage.blocked_seconds += time.monotonic() - start
+    finally:
+        close_compile_server()
+        jobs.put(("done", worker_id, stage))
+
+
+def record_oracle_stage(recorder: CampaignRecorder, stage: StageStats, lock: threading.Lock,
+                        result: IterationResult, worker_id: int, depth: int, waited: float,
+                        busy: float) -> None:
+    with lock:
+        recorder.record(result, worker_id)
+        recorder.stats.queue_depth_samples.append(depth)
+        stage.items += 1
+        stage.blocked_seconds += waited
+        stage.busy_seconds += busy
+
+
+def run_oracle_guarded(job: OracleJob, args: argparse.Namespace, oracle=None,
+                       store: bool = True) -> IterationResult:
+    """run_oracle for the oracle threads: an exception fails the job, with the
+    traceback on stderr, instead of killing the thread. A dead thread would
+    stop draining the queue and hang the compile workers in put()."""
+    try:
+        return run_oracle(job, args, oracle, store)
+    except Exception as exc:
+        sys.stderr.write(f"oracle failed on {job.input_path}:\n{traceback.format_exc()}")
+        result = job.result(IterationResult.FAIL,
+                            "oracle-error: " + traceback.format_exception_only(type(exc), exc)[-1].strip())
+        result.cacheable = False
+        return result
+
+
+def record_oracle_stage_guarded(*record_args) -> None:
+    """record_oracle_stage for the oracle threads; a failure to record one
+    result is reported and the thread moves on to the next job."""
+    try:
+        record_oracle_stage(*record_args)
+    except Exception:
+        sys.stderr.write(f"cannot record an oracle result:\n{traceback.format_exc()}")
+
+
+def oracle_stage_worker(args: argparse.Namespace, jobs, recorder: CampaignRecorder,
+                        stage: StageStats, lock: threading.Lock) -> None:
+    """Drain the oracle queue until a None sentinel arrives."""
+    while True:
+        start = time.monotonic()
+        entry = jobs.get()
+        waited = time.monotonic() - start
+        if entry is None:
+            break
+        kind, worker_id, payload = entry
+        if kind == "done":
+            with lock:
+                recorder.stats.stages["compile"].merge(payload)
+            continue
+        try:
+            depth = jobs.qsize()
+        except NotImplementedError:
+            depth = 0
+        result = payload
+        busy = 0.0
+        if isinstance(payload, OracleJob):
+            start = time.monotonic()
+            result = run_oracle_guarded(payload, args)
+            busy = time.monotonic() - start
+            result.elapsed = payload.compile_seconds + busy
+        record_oracle_stage_guarded(recorder, stage, lock, result, worker_id, depth, waited, busy)
+
+
+def parse_devices(spec: str) -> List[str]:
+    """Split a --devices list such as "0,1,2,3" into device indices."""
+    devices = [part.strip() for part in spec.split(",") if part.strip()]
+    if not devices or not all(d.isdigit() for d in devices) or len(set(devices)) != len(devices):
+        raise ValueError(f"invalid --devices {spec!r}, expected distinct indices such as 0,1,2,3")
+    return devices
+
+
+class DevicePool:
+    """Per-device oracle queues for --pipeline campaigns with --devices.
+
+    Each device has a queue and --oracle-jobs worker threads whose GPU
+    commands see only that device. A candidate is queued on a device picked
+    from its input, so an input's reference stays loaded on one device's
+    hip_runner server; a worker whose queue is empty steals from the tail of
+    the longest other queue.
+
+    Only runtime errors outside kernel execution count against a device
+    outright. A kernel fault is rerun on a device that has not run the
+    candidate yet (see retry), and device_oracle_worker blames the first
+    device only if the rerun is clean. A device charged fault_limit times in
+    a row is quarantined: its queue moves to the other devices and its
+    workers idle until, probe_interval seconds later, one of them runs a
+    single candidate as a probe. A clean probe restores the device; any other
+    outcome keeps it out for another interval. The last healthy device is
+    never quarantined, so the campaign always drains.
+    """
+
+    def __init__(self, devices: List[str], capacity: int, workers: int, fault_limit: int,
+                 probe_interval: float = 60.0) -> None:
+        self.devices = devices
+        self.capacity = capacity
+        self.workers = workers
+        self.fault_limit = fault_limit
+        self.probe_interval = probe_interval
+        self.queues: Dict[str, deque] = {device: deque() for device in devices}
+        self.cond = threading.Condition()
+        self.closed = False
+        # Jobs taken and not finished; a running job may still be requeued.
+        self.running = 0
+        self.quarantined: Set[str] = set()
+        # Quarantined device -> monotonic time of its next probe.
+        self.probe_at: Dict[str, float] = {}
+        # Device -> the job it runs as a probe.
+        self.probing: Dict[str, OracleJob] = {}
+        self.stats = {device: {"workers": workers, "runs": 0, "busy_seconds": 0.0, "stolen": 0,
+                               "faults": 0, "reruns": 0, "probes": 0, "quarantined": False}
+                      for device in devices}
+        self.consecutive_faults = {device: 0 for device in devices}
+
+    def pending(self) -> int:
+        return sum(len(q) for q in self.queues.values())
+
+    def home(self, job: OracleJob) -> str:
+        healthy = [d for d in self.devices if d not in self.quarantined]
+        digest = hashlib.sha256(str(job.input_path).encode("utf-8")).digest()
+        return healthy[int.from_bytes(digest[:4], "little") % len(healthy)]
+
+    def untried(self, job: OracleJob) -> List[str]:
+        return [d for d in self.devices if d not in self.quarantined and d not in job.tried]
+
+    def target(self, job: OracleJob) -> str:
+        """The job's home device, or the least loaded healthy device that has
+        not run it if home has."""
+        home = self.home(job)
+        untried = self.untried(job)
+        if home in untried or not untried:
+            return home
+        return min(untried, key=lambda d: len(self.queues[d]))
+
+    def put(self, worker_id: int, job: OracleJob) -> None:
+        """Queue job on its home device, blocking while `capacity` jobs wait."""
+        with self.cond:
+            while self.pending() >= self.capacity:
+                self.cond.wait()
+            self.queues[self.home(job)].append((worker_id, job))
+            self.cond.notify_all()
+
+    def retry(self, worker_id: int, job: OracleJob) -> bool:
+        """Requeue a job that is still running, at the head of a healthy device
+        that has not run it; False if there is none."""
+        with self.cond:
+            if not self.untried(job):
+                return False
+            device = self.target(job)
+            self.queues[device].appendleft((worker_id, job))
+            self.stats[device]["reruns"] += 1
+            self.cond.notify_all()
+            return True
+
+    def close(self) -> None:
+        with self.cond:
+            self.closed = True
+            self.cond.notify_all()
+
+    def steal(self, device: str) -> Optional[Tuple[int, OracleJob]]:
+        """Remove the job nearest the tail of the longest queue that device
+        has not run yet."""
+        for victim in sorted(self.queues.values(), key=len, reverse=True):
+            for i in range(len(victim) - 1, -1, -1):
+                if device not in victim[i][1].tried:
+                    entry = victim[i]
+                    del victim[i]
+                    return entry
+        return None
+
+    def take(self, device: str) -> Optional[Tuple[int, OracleJob, int]]:
+        """Return (compile worker id, job, jobs still queued) for a worker on
+        device, or None once the pool is closed and drained. A worker's own
+        queue is always served; it steals only jobs its device has not run.
+        Workers of a quarantined device wait for its probe."""
+        with self.cond:
+            while True:
+                if self.closed and not self.pending() and not self.running:
+                    return None
+                timeout = None
+                entry = None
+                if device not in self.quarantined:
+                    if self.queues[device]:
+                        entry = self.queues[device].popleft()
+                    else:
+                        entry = self.steal(device)
+                        if entry is not None:
+                            self.stats[device]["stolen"] += 1
+                elif self.probe_interval > 0 and device not in self.probing:
+                    timeout = self.probe_at[device] - time.monotonic()
+                    if timeout <= 0:
+                        timeout = None
+                        entry = self.steal(device)
+                        if entry is not None:
+                            self.probing[device] = entry[1]
+                            self.stats[device]["probes"] += 1
+                            sys.stderr.write(f"device {device}: probing\n")
+                if entry is None:
+                    self.cond.wait(timeout)
+                    continue
+                entry[1].tried.append(device)
+                self.running += 1
+                self.cond.notify_all()
+                return entry[0], entry[1], self.pending()
+
+    def finish(self, device: str, job: OracleJob, seconds: float) -> None:
+        """Account a run of job on device. Call it after judge and retry, so
+        the pool does not drain while the job may still be requeued."""
+        with self.cond:
+            stats = self.stats[device]
+            stats["runs"] += 1
+            stats["busy_seconds"] += seconds
+            if self.probing.get(device) is job:
+                del self.probing[device]
+                if device in self.quarantined:
+                    self.probe_at[device] = time.monotonic() + self.probe_interval
+            self.running -= 1
+            self.cond.notify_all()
+
+    def judge(self, device: str, fault: Optional[bool], job: Optional[OracleJob] = None) -> None:
+        """Charge (fault true) or clear (false) device for a run of job;
+        None is no evidence either way, such as a hang. A charge may
+        quarantine the device; a clean probe restores it."""
+        if fault is None:
+            return
+        with self.cond:
+            if not fault:
+                self.consecutive_faults[device] = 0
+                if job is not None and self.probing.get(device) is job:
+                    self.quarantined.discard(device)
+                    self.stats[device]["quarantined"] = False
+                    sys.stderr.write(f"device {device}: probe passed; restored\n")
+                    self.cond.notify_all()
+                return
+            self.stats[device]["faults"] += 1
+            self.consecutive_faults[device] += 1
+            if (self.fault_limit <= 0 or self.consecutive_faults[device] < self.fault_limit
+                    or device in self.quarantined
+                    or len(self.quarantined) + 1 >= len(self.devices)):
+                return
+            self.quarantined.add(device)
+            self.stats[device]["quarantined"] = True
+            self.probe_at[device] = time.monotonic() + self.probe_interval
+            sys.stderr.write(f"device {device}: {self.consecutive_faults[device]} faults in a "
+                             f"row; quarantined\n")
+            orphans = self.queues[device]
+            self.queues[device] = deque()
+            for worker_id, orphan in orphans:
+                self.queues[self.target(orphan)].append((worker_id, orphan))
+            self.cond.notify_all()
+
+
+def dispatch_oracle_jobs(jobs, pool: DevicePool, recorder: CampaignRecorder, stage: StageStats,
+                         lock: threading.Lock) -> None:
+    """Move candidates from the pipeline queue into the device pool until a
+    None sentinel arrives; results that need no oracle are recorded here."""
+    while True:
+        entry = jobs.get()
+        if entry is None:
+            break
+        kind, worker_id, payload = entry
+        if kind == "done":
+            with lock:
+                recorder.stats.stages["compile"].merge(payload)
+        elif isinstance(payload, OracleJob):
+            pool.put(worker_id, payload)
+        else:
+            record_oracle_stage_guarded(recorder, stage, lock, payload, worker_id, pool.pending(),
+                                        0.0, 0.0)
+    pool.close()
+
+
+def device_oracle_worker(args: argparse.Namespace, device: str, pool: DevicePool,
+                         recorder: CampaignRecorder, stage: StageStats,
+                         lock: threading.Lock, oracle=None) -> None:
+    """Run candidates from the pool on `device` until it closes.
+
+    A runtime error charges the device and the candidate is rerun elsewhere.
+    A kernel fault is rerun on another device with the device as its suspect:
+    a second fault is the code's, a clean rerun is the suspect's. The verdict
+    goes to the result cache only once it is settled.
+    """
+    oracle = oracle or make_oracle(args, device)
+    while True:
+        start = time.monotonic()
+        taken = pool.take(device)
+        waited = time.monotonic() - start
+        if taken is None:
+            break
+        worker_id, job, depth = taken
+        start = time.monotonic()
+        result = run_oracle_guarded(job, args, oracle, store=False)
+        busy = time.monotonic() - start
+        result.elapsed = job.compile_seconds + busy
+        result.device = device
+        rerun = False
+        if result.device_fault:
+            pool.judge(device, True, job)
+            rerun = pool.retry(worker_id, job)
+        elif result.kernel_fault and job.suspect is None:
+            # Set before the job is requeued: another worker may take it at once.
+            job.suspect = device
+            rerun = pool.retry(worker_id, job)
+            if not rerun:
+                job.suspect = None
+        elif result.status == IterationResult.HANG:
+            pool.judge(device, None, job)
+        else:
+            if job.suspect is not None and not result.kernel_fault:
+                sys.stderr.write(f"device {job.suspect}: kernel fault not reproduced on device "
+                                 f"{device}: {job.input_path}\n")
+                pool.judge(job.suspect, True)
+            pool.judge(device, False, job)
+        if not rerun:
+            store_result(job, result, args)
+        pool.finish(device, job, busy)
+        if not rerun:
+            record_oracle_stage_guarded(recorder, stage, lock, result, worker_id, depth, waited,
+                                        busy)
+
+
+def run_pipelined_campaign(inputs: List[Path], args: argparse.Namespace,
+                           base_seed: int) -> CampaignStats:
+    # Compile workers are processes (llc and the compile server are CPU bound).
+    # Oracle workers are threads in this process: they spend their time waiting
+    # on the GPU command. The queue bound keeps compile workers from running
+    # ahead of the GPU; when it is full they block in put().
+    budget = multiprocessing.Value("l", args.iterations)
+    jobs = multiprocessing.Queue(maxsize=args.queue_depth)
+    workers = []
+    for worker_id in range(args.jobs):
+        seed = derive_worker_seed(base_seed, worker_id)
+        proc = multiprocessing.Process(
+            target=compile_stage_worker,
+            args=(worker_id, seed, inputs, args, budget, jobs),
+            name=f"spill_fuzz-compile{worker_id}",
+        )
+        proc.start()
+        workers.append(proc)
+
+    stats = CampaignStats()
+    stats.stages["compile"] = StageStats(args.jobs)
+    lock = threading.Lock()
+    recorder = CampaignRecorder(args, stats)
+    pool = None
+    if args.devices:
+        # One dispatcher reads the queue; --oracle-jobs workers per device
+        # run the candidates.
+        pool = DevicePool(args.devices, args.queue_depth * len(args.devices), args.oracle_jobs,
+                          args.device_fault_limit, args.device_probe_interval)
+        oracle_stage = StageStats(args.oracle_jobs * len(args.devices))
+        readers = [threading.Thread(target=dispatch_oracle_jobs,
+                                    args=(jobs, pool, recorder, oracle_stage, lock),
+                                    name="spill_fuzz-dispatch")]
+        threads = readers + [
+            threading.Thread(target=device_oracle_worker,
+                             args=(args, device, pool, recorder, oracle_stage, lock),
+                             name=f"spill_fuzz-oracle{device}.{i}")
+            for device in args.devices for i in range(args.oracle_jobs)]
+    else:
+        oracle_stage = StageStats(args.oracle_jobs)
+        threads = readers = [threading.Thread(target=oracle_stage_worker,
+                                              args=(args, jobs, recorder, oracle_stage, lock),
+                                              name=f"spill_fuzz-oracle{i}")
+                             for i in range(args.oracle_jobs)]
+    stats.stages["oracle"] = oracle_stage
+    for thread in threads:
+        thread.start()
+    for proc in workers:
+        proc.join()
+    for _ in readers:
+        jobs.put(None)
+    for thread in threads:
+        thread.join()
+    if pool is not None:
+        stats.devices = pool.stats
+    recorder.close()
+    return stats
+
+
+def run_campaign(inputs: List[Path], args: argparse.Namespace, out_dir: Path) -> CampaignStats:
+    # Every mode prints its seed, and summary.json records it, so a run
+    # without --seed can be reproduced.
+    if args.seed is None:
+        args.seed = random.SystemRandom().getrandbits(63)
+    if args.pipeline:
+        devices = f" on each of devices {','.join(args.devices)}" if args.devices else ""
+        sys.stderr.write(f"campaign seed {args.seed}, {args.jobs} compile workers, "
+                         f"{args.oracle_jobs} oracle workers{devices}, "
+                         f"queue depth {args.queue_depth}\n")
+        stats = run_pipelined_campaign(inputs, args, args.seed)
+    elif args.jobs == 1:
+        sys.stderr.write(f"campaign seed {args.seed}\n")
+        rng = random.Random(args.seed)
+        sampler = new_sampler(args)
+        stats = CampaignStats()
+        recorder = CampaignRecorder(args, stats)
+        try:
+            for _ in range(args.iterations):
+                recorder.record(timed_iteration(rng, sampler, inputs, out_dir, args))
+        finally:
+            close_compile_server()
+            recorder.close()
+    else:
+        sys.stderr.write(f"campaign seed {args.seed}, {args.jobs} workers\n")
+        stats = run_parallel_campaign(inputs, args, args.seed)
+    return stats
 
 
 def main() -> int:
     args = parse_args()
     args.llc = resolve_llc(args.llc)
+    if args.compile_server is not None and not os.access(args.compile_server, os.X_OK):
+        sys.stderr.write(f"compile server not executable: {args.compile_server}\n")
+        return 2
+    if args.hip_server is not None and not os.access(args.hip_server, os.X_OK):
+        sys.stderr.write(f"hip_runner not executable: {args.hip_server}\n")
+        return 2
+    if args.oracle == "command":
+        if args.gpu_cmd is None:
+            sys.stderr.write("--gpu-cmd is required unless --oracle stub\n")
+            return 2
+        try:
+            args.gpu_cmd = resolve_gpu_cmd(args.gpu_cmd)
+        except ValueError as exc:
+            sys.stderr.write(f"{exc}\n")
+            return 2
     try:
-        args.gpu_cmd = resolve_gpu_cmd(args.gpu_cmd)
+        args.stage_timeouts = parse_stage_timeouts(args.timeout)
     except ValueError as exc:
         sys.stderr.write(f"{exc}\n")
         return 2
@@ -440,15 +2257,127 @@ def main() -> int:
         sys.stderr.write(f"No .ll inputs found in {corpus_dir}\n")
         return 2
 
-    out_dir = Path(args.out_dir)
-    rng = random.Random(args.seed)
+    if args.jobs < 1 or args.oracle_jobs < 1 or args.queue_depth < 1:
+        sys.stderr.write("--jobs, --oracle-jobs and --queue-depth must be at least 1\n")
+        return 2
+    try:
+        args.devices = parse_devices(args.devices) if args.devices is not None else []
+    except ValueError as exc:
+        sys.stderr.write(f"{exc}\n")
+        return 2
+    if args.devices and not args.pipeline:
+        sys.stderr.write("--devices needs --pipeline\n")
+        return 2
 
-    failures = 0
-    for _ in range(args.iterations):
-        failures += run_iteration(rng, inputs, out_dir, args)
+    out_dir = Path(args.out_dir)
+    index_path = Path(args.index) if args.index else out_dir / "corpus_index.json"
+    index_start = time.monotonic()
+    index, rescanned = update_index(index_path, inputs, args.jobs)
+    inputs, excluded = filter_compatible_inputs(inputs, index, args.mcpu)
+    index_seconds = time.monotonic() - index_start
+    args.excluded_inputs = excluded
+    sys.stderr.write(f"corpus index: {len(index)} inputs ({rescanned} rescanned), "
+                     f"{len(inputs)} usable on {args.mcpu} in {index_seconds:.2f}s\n")
+    if excluded:
+        parts = ", ".join(f"{k}={v}" for k, v in sorted(excluded.items(), key=lambda kv: (-kv[1], kv[0])))
+        sys.stderr.write(f"Excluded inputs: {parts}\n")
+    if not inputs:
+        sys.stderr.write(f"No inputs in {corpus_dir} are usable on {args.mcpu}\n")
+        return 2
+    args.input_digests = {str(p.resolve()): index[str(p.resolve())]["sha256"] for p in inputs}
+    if args.mir_cache is not None or not args.no_result_cache:
+        args.llc_build_id = llc_build_id(args.llc)
+    if args.mir_cache is not None:
+        # Inputs whose post-ISel MIR already failed the verifier were reported
+        # when the failure was cached; drawing them again would only repeat it.
+        failed = [p for p in inputs if (Path(args.mir_cache) / (isel_snapshot_key(
+            args.input_digests[str(p.resolve())], args.mcpu, args.llc_build_id)
+            + ".verify-failed")).exists()]
+        if failed:
+            excluded["pre-ra-verifier"] = len(failed)
+            sys.stderr.write(f"Excluded inputs that failed the verifier: {len(failed)}\n")
+            inputs = [p for p in inputs if p not in failed]
+        if not inputs:
+            sys.stderr.write(f"No inputs in {corpus_dir} pass the machine verifier\n")
+            return 2
+    args.flat_input_spec = None
+    spec_path = oracle_input_spec(args) if args.oracle == "command" else None
+    if spec_path is not None:
+        # Converted once here rather than by run_on_gpu.sh on every candidate.
+        try:
+            spec_lines = emit_lines(json.loads(spec_path.read_text(encoding="utf-8")),
+                                    spec_path.parent)
+        except (OSError, ValueError, TypeError, AttributeError) as exc:
+            sys.stderr.write(f"invalid input spec {spec_path}: {exc}\n")
+            return 2
+        out_dir.mkdir(parents=True, exist_ok=True)
+        args.flat_input_spec = out_dir / "input.spec"
+        args.flat_input_spec.write_text("\n".join(spec_lines) + "\n", encoding="utf-8")
+    args.result_cache_store = None
+    if not args.no_result_cache:
+        cache_dir = Path(args.result_cache) if args.result_cache else out_dir / "result_cache"
+        oracle_ident = args.gpu_cmd if args.oracle == "command" else [f"stub:{args.stub_latency}"]
+        args.result_cache_store = ResultCache(cache_dir, args.mcpu, args.llc_build_id, oracle_ident,
+                                              oracle_files(args))
+
+    args.hip_server_proc = None
+    args.device_hip_servers = {}
+    if args.hip_server is not None and args.oracle == "command":
+        if args.devices:
+            for device in args.devices:
+                args.device_hip_servers[device] = HipRunnerServer(
+                    args.hip_server, args.hip_module_cache,
+                    out_dir / f"hip_runner_server.dev{device}.log", device)
+        else:
+            args.hip_server_proc = HipRunnerServer(args.hip_server, args.hip_module_cache,
+                                                   out_dir / "hip_runner_server.log")
+    hip_servers = list(args.device_hip_servers.values())
+    if args.hip_server_proc is not None:
+        hip_servers.append(args.hip_server_proc)
+    args.oracle_impl = make_oracle(args)
+
+    start = time.monotonic()
+    try:
+        stats = run_campaign(inputs, args, out_dir)
+    finally:
+        for server in hip_servers:
+            server.close()
+    wall_seconds = time.monotonic() - start
 
-    if failures:
-        sys.stderr.write(f"Failures: {failures}\n")
+    stats.write_summary(sys.stderr, wall_seconds)
+    out_dir.mkdir(parents=True, exist_ok=True)
+    summary = stats.to_json(wall_seconds, args.jobs, args.seed)
+    if hip_servers:
+        peaks = [server.peak_device_memory() for server in hip_servers]
+        used = max(peak[0] for peak in peaks)
+        slab = max(peak[1] for peak in peaks)
+        sys.stderr.write(f"HIP runner peak device memory: {used} bytes (slab {slab} bytes)\n")
+        summary["hip_peak_device_bytes"] = used
+        summary["hip_peak_slab_bytes"] = slab
+    if args.perf_reps > 0:
+        anomalies = find_perf_anomalies(stats.perf_samples, args.perf_threshold, args.perf_noise)
+        timed = sum(len(samples) for samples in stats.perf_samples.values())
+        kinds = {kind: sum(1 for a in anomalies if a["kind"] == kind)
+                 for kind in ("slowdown", "non_monotonic")}
+        sys.stderr.write(f"Performance anomalies: {len(anomalies)} in {timed} timed runs "
+                         f"({kinds['slowdown']} slowdown > {args.perf_threshold:g}x, "
+                         f"{kinds['non_monotonic']} non-monotonic in register budget)\n")
+        for anomaly in anomalies:
+            sys.stderr.write(f"  {anomaly['kind']}: {anomaly['input']} vgpr={anomaly['num_vgpr']} "
+                             f"sgpr={anomaly['num_sgpr']} {anomaly['slowdown']:.2f}x reference\n")
+        summary["perf_timed_runs"] = timed
+        summary["perf_anomalies"] = anomalies
+    summary["excluded_inputs"] = excluded
+    summary["index_seconds"] = index_seconds
+    (out_dir / "summary.json").write_text(json.dumps(summary, indent=2) + "\n", encoding="utf-8")
+
+    if stats.failures:
+        sys.stderr.write(f"Failures: {stats.failures}\n")
+        return 1
+    if stats.hangs:
+        sys.stderr.write(f"Hangs: {stats.hangs} (artifacts in {out_dir / 'hangs'})\n")
+        return 1
+    if stats.iterations < args.iterations:
         return 1
     return 0
 
@@ -0,0 +1,175 @@
+"""Latency histograms and metric writers for spill_fuzz.py.
+
+Histograms use logarithmic buckets, so they stay small over long campaigns,
+merge across workers by adding counts, and give quantiles to within about 2%.
+Every process writes its iteration records to a shared JSON-lines file and
+keeps a Prometheus textfile up to date for node_exporter's textfile
+collector.
+"""
+
+import json
+import math
+import os
+import time
+from contextlib import contextmanager
+from pathlib import Path
+from typing import Dict, Iterator, List, Optional
+
+QUANTILES = (0.5, 0.95, 0.99)
+
+
+class LatencyHistogram:
+    GROWTH = 1.02
+    FLOOR = 1e-6
+
+    def __init__(self) -> None:
+        self.buckets: Dict[int, int] = {}
+        self.count = 0
+        self.total = 0.0
+        self.max = 0.0
+
+    def add(self, seconds: float) -> None:
+        index = 0
+        if seconds > self.FLOOR:
+            index = math.ceil(math.log(seconds / self.FLOOR, self.GROWTH))
+        self.buckets[index] = self.buckets.get(index, 0) + 1
+        self.count += 1
+        self.total += seconds
+        self.max = max(self.max, seconds)
+
+    def merge(self, other: "LatencyHistogram") -> None:
+        for index, count in other.buckets.items():
+            self.buckets[index] = self.buckets.get(index, 0) + count
+        self.count += other.count
+        self.total += other.total
+        self.max = max(self.max, other.max)
+
+    def quantile(self, q: float) -> float:
+        """Return the upper bound of the bucket holding the q-quantile."""
+        if not self.count:
+            return 0.0
+        rank = q * self.count
+        seen = 0
+        for index in sorted(self.buckets):
+            seen += self.buckets[index]
+            if seen >= rank:
+                return min(self.FLOOR * self.GROWTH ** index, self.max)
+        return self.max
+
+    def to_json(self) -> dict:
+        info = {
+            "count": self.count,
+            "mean": self.total / self.count if self.count else 0.0,
+            "max": self.max,
+        }
+        for q in QUANTILES:
+            info[f"p{int(q * 100)}"] = self.quantile(q)
+        return info
+
+
+@contextmanager
+def stage_timer(timings: Dict[str, float], stage: str) -> Iterator[None]:
+    """Add the wall time of the with-block to timings[stage]."""
+    start = time.monotonic()
+    try:
+        yield
+    finally:
+        timings[stage] = timings.get(stage, 0.0) + time.monotonic() - start
+
+
+def read_script_timings(path: Path) -> Dict[str, float]:
+    """Parse "<stage> <start> <end>" lines written by run_on_gpu.sh."""
+    timings: Dict[str, float] = {}
+    try:
+        lines = path.read_text(encoding="utf-8").splitlines()
+    except OSError:
+        return timings
+    for line in lines:
+        parts = line.split()
+        if len(parts) != 3:
+            continue
+        try:
+            seconds = float(parts[2]) - float(parts[1])
+        except ValueError:
+            continue
+        timings[parts[0]] = timings.get(parts[0], 0.0) + seconds
+    return timings
+
+
+def _labels(labels: Dict[str, str]) -> str:
+    if not labels:
+        return ""
+    def escape(value: str) -> str:
+        return value.replace("\\", "\\\\").replace('"', '\\"').replace("\n", "\\n")
+    return "{" + ",".join(f'{k}="{escape(str(v))}"' for k, v in labels.items()) + "}"
+
+
+class PrometheusText:
+    """Accumulates metric families in the Prometheus text exposition format."""
+
+    def __init__(self, base_labels: Dict[str, str]) -> None:
+        self.base_labels = base_labels
+        self.lines: List[str] = []
+
+    def family(self, name: str, kind: str, help_text: str) -> None:
+        self.lines.append(f"# HELP {name} {help_text}")
+        self.lines.append(f"# TYPE {name} {kind}")
+
+    def sample(self, name: str, value: float, **labels: str) -> None:
+        merged = dict(self.base_labels)
+        merged.update(labels)
+        self.lines.append(f"{name}{_labels(merged)} {value:.9g}")
+
+    def histogram(self, name: str, help_text: str, histograms: Dict[str, LatencyHistogram],
+                  label: str) -> None:
+        self.family(name, "summary", help_text)
+        for key, hist in sorted(histograms.items()):
+            for q in QUANTILES:
+                self.sample(name, hist.quantile(q), **{label: key, "quantile": str(q)})
+            self.sample(f"{name}_sum", hist.total, **{label: key})
+            self.sample(f"{name}_count", hist.count, **{label: key})
+
+    def text(self) -> str:
+        return "\n".join(self.lines) + "\n"
+
+
+class TelemetrySink:
+    """Per-process writer for iteration records and the Prometheus textfile.
+
+    Records are appended to the JSON-lines file with one write() each on an
+    O_APPEND descriptor, so workers can share the file. The textfile is
+    rewritten at most every `interval` seconds, through a rename so that the
+    collector never reads a partial file.
+    """
+
+    def __init__(self, jsonl_path: Optional[Path], prom_path: Optional[Path],
+                 interval: float) -> None:
+        self.fd: Optional[int] = None
+        if jsonl_path is not None:
+            jsonl_path.parent.mkdir(parents=True, exist_ok=True)
+            self.fd = os.open(str(jsonl_path), os.O_WRONLY | os.O_CREAT | os.O_APPEND, 0o644)
+        self.prom_path = prom_path
+        self.interval = interval
+        self.last_refresh = 0.0
+
+    def iteration(self, record: dict) -> None:
+        if self.fd is not None:
+            os.write(self.fd, (json.dumps(record, sort_keys=True) + "\n").encode("utf-8"))
+
+    def refresh(self, render, force: bool = False) -> None:
+        """Rewrite the textfile with render() if it is due (or force is set)."""
+        if self.prom_path is None:
+            return
+        now = time.monotonic()
+        if not force and now - self.last_refresh < self.interval:
+            return
+        self.last_refresh = now
+        self.prom_path.parent.mkdir(parents=True, exist_ok=True)
+        tmp_path = self.prom_path.with_name(f"{self.prom_path.name}.tmp{os.getpid()}")
+        tmp_path.write_text(render(), encoding="utf-8")
+        os.replace(tmp_path, self.prom_path)
+
+    def close(self) -> None:
+        if self.fd is not None:
+            os.close(self.fd)
+            self.fd = None
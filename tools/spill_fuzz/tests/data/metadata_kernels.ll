@@ -0,0 +1,34 @@
+; Kernels for the metadata golden tests. Regenerate the objects with
+;   llc -mtriple=amdgcn-amd-amdhsa -mcpu=gfx90a -filetype=obj \
+;     -o metadata_kernels.o metadata_kernels.ll
+;   ld.lld -shared -o metadata_kernels.hsaco metadata_kernels.o
+; scale takes two buffers and a by-value count, and reads the global offset
+; through the implicit argument pointer, so it also has hidden arguments.
+target triple = "amdgcn-amd-amdhsa"
+
+define amdgpu_kernel void @scale(float addrspace(1)* %out, float addrspace(1)* %in, i32 %n) #0 {
+entry:
+  %implicit = call i8 addrspace(4)* @llvm.amdgcn.implicitarg.ptr()
+  %offset.ptr = bitcast i8 addrspace(4)* %implicit to i32 addrspace(4)*
+  %offset = load i32, i32 addrspace(4)* %offset.ptr
+  %local = call i32 @llvm.amdgcn.workitem.id.x()
+  %id = add i32 %local, %offset
+  %in.range = icmp slt i32 %id, %n
+  br i1 %in.range, label %body, label %exit
+
+body:
+  %src = getelementptr float, float addrspace(1)* %in, i32 %id
+  %v = load float, float addrspace(1)* %src
+  %m = fmul float %v, 2.0
+  %dst = getelementptr float, float addrspace(1)* %out, i32 %id
+  store float %m, float addrspace(1)* %dst
+  br label %exit
+
+exit:
+  ret void
+}
+
+declare i8 addrspace(4)* @llvm.amdgcn.implicitarg.ptr()
+declare i32 @llvm.amdgcn.workitem.id.x()
+
+attributes #0 = { nounwind "amdgpu-implicitarg-num-bytes"="56" }
@@ -0,0 +1,4 @@
+kernel scale
+arg global_buffer 8 global
+arg global_buffer 8 global
+arg by_value 4 unknown
@@ -0,0 +1,13 @@
+; A kernel without explicit arguments, which hip_runner cannot fill, so
+; --emit-spec exits 3:
+;   llc -mtriple=amdgcn-amd-amdhsa -mcpu=gfx90a -filetype=obj \
+;     -o no_args.o no_args.ll
+;   ld.lld -shared -o no_args.hsaco no_args.o
+target triple = "amdgcn-amd-amdhsa"
+
+define amdgpu_kernel void @no_args() #0 {
+entry:
+  ret void
+}
+
+attributes #0 = { nounwind }
@@ -0,0 +1,493 @@
+; 96 values live at once: spills to scratch under tight register limits, so
+; the scratch resource descriptor SGPRs depend on the SGPR budget.
+target triple = "amdgcn-amd-amdhsa"
+
+define amdgpu_kernel void @pressure(float addrspace(1)* %out, float addrspace(1)* %in) #0 {
+entry:
+  %id = call i32 @llvm.amdgcn.workitem.id.x()
+  %o0 = add i32 %id, 0
+  %p0 = getelementptr float, float addrspace(1)* %in, i32 %o0
+  %v0 = load volatile float, float addrspace(1)* %p0
+  %o1 = add i32 %id, 64
+  %p1 = getelementptr float, float addrspace(1)* %in, i32 %o1
+  %v1 = load volatile float, float addrspace(1)* %p1
+  %o2 = add i32 %id, 128
+  %p2 = getelementptr float, float addrspace(1)* %in, i32 %o2
+  %v2 = load volatile float, float addrspace(1)* %p2
+  %o3 = add i32 %id, 192
+  %p3 = getelementptr float, float addrspace(1)* %in, i32 %o3
+  %v3 = load volatile float, float addrspace(1)* %p3
+  %o4 = add i32 %id, 256
+  %p4 = getelementptr float, float addrspace(1)* %in, i32 %o4
+  %v4 = load volatile float, float addrspace(1)* %p4
+  %o5 = add i32 %id, 320
+  %p5 = getelementptr float, float addrspace(1)* %in, i32 %o5
+  %v5 = load volatile float, float addrspace(1)* %p5
+  %o6 = add i32 %id, 384
+  %p6 = getelementptr float, float addrspace(1)* %in, i32 %o6
+  %v6 = load volatile float, float addrspace(1)* %p6
+  %o7 = add i32 %id, 448
+  %p7 = getelementptr float, float addrspace(1)* %in, i32 %o7
+  %v7 = load volatile float, float addrspace(1)* %p7
+  %o8 = add i32 %id, 512
+  %p8 = getelementptr float, float addrspace(1)* %in, i32 %o8
+  %v8 = load volatile float, float addrspace(1)* %p8
+  %o9 = add i32 %id, 576
+  %p9 = getelementptr float, float addrspace(1)* %in, i32 %o9
+  %v9 = load volatile float, float addrspace(1)* %p9
+  %o10 = add i32 %id, 640
+  %p10 = getelementptr float, float addrspace(1)* %in, i32 %o10
+  %v10 = load volatile float, float addrspace(1)* %p10
+  %o11 = add i32 %id, 704
+  %p11 = getelementptr float, float addrspace(1)* %in, i32 %o11
+  %v11 = load volatile float, float addrspace(1)* %p11
+  %o12 = add i32 %id, 768
+  %p12 = getelementptr float, float addrspace(1)* %in, i32 %o12
+  %v12 = load volatile float, float addrspace(1)* %p12
+  %o13 = add i32 %id, 832
+  %p13 = getelementptr float, float addrspace(1)* %in, i32 %o13
+  %v13 = load volatile float, float addrspace(1)* %p13
+  %o14 = add i32 %id, 896
+  %p14 = getelementptr float, float addrspace(1)* %in, i32 %o14
+  %v14 = load volatile float, float addrspace(1)* %p14
+  %o15 = add i32 %id, 960
+  %p15 = getelementptr float, float addrspace(1)* %in, i32 %o15
+  %v15 = load volatile float, float addrspace(1)* %p15
+  %o16 = add i32 %id, 1024
+  %p16 = getelementptr float, float addrspace(1)* %in, i32 %o16
+  %v16 = load volatile float, float addrspace(1)* %p16
+  %o17 = add i32 %id, 1088
+  %p17 = getelementptr float, float addrspace(1)* %in, i32 %o17
+  %v17 = load volatile float, float addrspace(1)* %p17
+  %o18 = add i32 %id, 1152
+  %p18 = getelementptr float, float addrspace(1)* %in, i32 %o18
+  %v18 = load volatile float, float addrspace(1)* %p18
+  %o19 = add i32 %id, 1216
+  %p19 = getelementptr float, float addrspace(1)* %in, i32 %o19
+  %v19 = load volatile float, float addrspace(1)* %p19
+  %o20 = add i32 %id, 1280
+  %p20 = getelementptr float, float addrspace(1)* %in, i32 %o20
+  %v20 = load volatile float, float addrspace(1)* %p20
+  %o21 = add i32 %id, 1344
+  %p21 = getelementptr float, float addrspace(1)* %in, i32 %o21
+  %v21 = load volatile float, float addrspace(1)* %p21
+  %o22 = add i32 %id, 1408
+  %p22 = getelementptr float, float addrspace(1)* %in, i32 %o22
+  %v22 = load volatile float, float addrspace(1)* %p22
+  %o23 = add i32 %id, 1472
+  %p23 = getelementptr float, float addrspace(1)* %in, i32 %o23
+  %v23 = load volatile float, float addrspace(1)* %p23
+  %o24 = add i32 %id, 1536
+  %p24 = getelementptr float, float addrspace(1)* %in, i32 %o24
+  %v24 = load volatile float, float addrspace(1)* %p24
+  %o25 = add i32 %id, 1600
+  %p25 = getelementptr float, float addrspace(1)* %in, i32 %o25
+  %v25 = load volatile float, float addrspace(1)* %p25
+  %o26 = add i32 %id, 1664
+  %p26 = getelementptr float, float addrspace(1)* %in, i32 %o26
+  %v26 = load volatile float, float addrspace(1)* %p26
+  %o27 = add i32 %id, 1728
+  %p27 = getelementptr float, float addrspace(1)* %in, i32 %o27
+  %v27 = load volatile float, float addrspace(1)* %p27
+  %o28 = add i32 %id, 1792
+  %p28 = getelementptr float, float addrspace(1)* %in, i32 %o28
+  %v28 = load volatile float, float addrspace(1)* %p28
+  %o29 = add i32 %id, 1856
+  %p29 = getelementptr float, float addrspace(1)* %in, i32 %o29
+  %v29 = load volatile float, float addrspace(1)* %p29
+  %o30 = add i32 %id, 1920
+  %p30 = getelementptr float, float addrspace(1)* %in, i32 %o30
+  %v30 = load volatile float, float addrspace(1)* %p30
+  %o31 = add i32 %id, 1984
+  %p31 = getelementptr float, float addrspace(1)* %in, i32 %o31
+  %v31 = load volatile float, float addrspace(1)* %p31
+  %o32 = add i32 %id, 2048
+  %p32 = getelementptr float, float addrspace(1)* %in, i32 %o32
+  %v32 = load volatile float, float addrspace(1)* %p32
+  %o33 = add i32 %id, 2112
+  %p33 = getelementptr float, float addrspace(1)* %in, i32 %o33
+  %v33 = load volatile float, float addrspace(1)* %p33
+  %o34 = add i32 %id, 2176
+  %p34 = getelementptr float, float addrspace(1)* %in, i32 %o34
+  %v34 = load volatile float, float addrspace(1)* %p34
+  %o35 = add i32 %id, 2240
+  %p35 = getelementptr float, float addrspace(1)* %in, i32 %o35
+  %v35 = load volatile float, float addrspace(1)* %p35
+  %o36 = add i32 %id, 2304
+  %p36 = getelementptr float, float addrspace(1)* %in, i32 %o36
+  %v36 = load volatile float, float addrspace(1)* %p36
+  %o37 = add i32 %id, 2368
+  %p37 = getelementptr float, float addrspace(1)* %in, i32 %o37
+  %v37 = load volatile float, float addrspace(1)* %p37
+  %o38 = add i32 %id, 2432
+  %p38 = getelementptr float, float addrspace(1)* %in, i32 %o38
+  %v38 = load volatile float, float addrspace(1)* %p38
+  %o39 = add i32 %id, 2496
+  %p39 = getelementptr float, float addrspace(1)* %in, i32 %o39
+  %v39 = load volatile float, float addrspace(1)* %p39
+  %o40 = add i32 %id, 2560
+  %p40 = getelementptr float, float addrspace(1)* %in, i32 %o40
+  %v40 = load volatile float, float addrspace(1)* %p40
+  %o41 = add i32 %id, 2624
+  %p41 = getelementptr float, float addrspace(1)* %in, i32 %o41
+  %v41 = load volatile float, float addrspace(1)* %p41
+  %o42 = add i32 %id, 2688
+  %p42 = getelementptr float, float addrspace(1)* %in, i32 %o42
+  %v42 = load volatile float, float addrspace(1)* %p42
+  %o43 = add i32 %id, 2752
+  %p43 = getelementptr float, float addrspace(1)* %in, i32 %o43
+  %v43 = load volatile float, float addrspace(1)* %p43
+  %o44 = add i32 %id, 2816
+  %p44 = getelementptr float, float addrspace(1)* %in, i32 %o44
+  %v44 = load volatile float, float addrspace(1)* %p44
+  %o45 = add i32 %id, 2880
+  %p45 = getelementptr float, float addrspace(1)* %in, i32 %o45
+  %v45 = load volatile float, float addrspace(1)* %p45
+  %o46 = add i32 %id, 2944
+  %p46 = getelementptr float, float addrspace(1)* %in, i32 %o46
+  %v46 = load volatile float, float addrspace(1)* %p46
+  %o47 = add i32 %id, 3008
+  %p47 = getelementptr float, float addrspace(1)* %in, i32 %o47
+  %v47 = load volatile float, float addrspace(1)* %p47
+  %o48 = add i32 %id, 3072
+  %p48 = getelementptr float, float addrspace(1)* %in, i32 %o48
+  %v48 = load volatile float, float addrspace(1)* %p48
+  %o49 = add i32 %id, 3136
+  %p49 = getelementptr float, float addrspace(1)* %in, i32 %o49
+  %v49 = load volatile float, float addrspace(1)* %p49
+  %o50 = add i32 %id, 3200
+  %p50 = getelementptr float, float addrspace(1)* %in, i32 %o50
+  %v50 = load volatile float, float addrspace(1)* %p50
+  %o51 = add i32 %id, 3264
+  %p51 = getelementptr float, float addrspace(1)* %in, i32 %o51
+  %v51 = load volatile float, float addrspace(1)* %p51
+  %o52 = add i32 %id, 3328
+  %p52 = getelementptr float, float addrspace(1)* %in, i32 %o52
+  %v52 = load volatile float, float addrspace(1)* %p52
+  %o53 = add i32 %id, 3392
+  %p53 = getelementptr float, float addrspace(1)* %in, i32 %o53
+  %v53 = load volatile float, float addrspace(1)* %p53
+  %o54 = add i32 %id, 3456
+  %p54 = getelementptr float, float addrspace(1)* %in, i32 %o54
+  %v54 = load volatile float, float addrspace(1)* %p54
+  %o55 = add i32 %id, 3520
+  %p55 = getelementptr float, float addrspace(1)* %in, i32 %o55
+  %v55 = load volatile float, float addrspace(1)* %p55
+  %o56 = add i32 %id, 3584
+  %p56 = getelementptr float, float addrspace(1)* %in, i32 %o56
+  %v56 = load volatile float, float addrspace(1)* %p56
+  %o57 = add i32 %id, 3648
+  %p57 = getelementptr float, float addrspace(1)* %in, i32 %o57
+  %v57 = load volatile float, float addrspace(1)* %p57
+  %o58 = add i32 %id, 3712
+  %p58 = getelementptr float, float addrspace(1)* %in, i32 %o58
+  %v58 = load volatile float, float addrspace(1)* %p58
+  %o59 = add i32 %id, 3776
+  %p59 = getelementptr float, float addrspace(1)* %in, i32 %o59
+  %v59 = load volatile float, float addrspace(1)* %p59
+  %o60 = add i32 %id, 3840
+  %p60 = getelementptr float, float addrspace(1)* %in, i32 %o60
+  %v60 = load volatile float, float addrspace(1)* %p60
+  %o61 = add i32 %id, 3904
+  %p61 = getelementptr float, float addrspace(1)* %in, i32 %o61
+  %v61 = load volatile float, float addrspace(1)* %p61
+  %o62 = add i32 %id, 3968
+  %p62 = getelementptr float, float addrspace(1)* %in, i32 %o62
+  %v62 = load volatile float, float addrspace(1)* %p62
+  %o63 = add i32 %id, 4032
+  %p63 = getelementptr float, float addrspace(1)* %in, i32 %o63
+  %v63 = load volatile float, float addrspace(1)* %p63
+  %o64 = add i32 %id, 4096
+  %p64 = getelementptr float, float addrspace(1)* %in, i32 %o64
+  %v64 = load volatile float, float addrspace(1)* %p64
+  %o65 = add i32 %id, 4160
+  %p65 = getelementptr float, float addrspace(1)* %in, i32 %o65
+  %v65 = load volatile float, float addrspace(1)* %p65
+  %o66 = add i32 %id, 4224
+  %p66 = getelementptr float, float addrspace(1)* %in, i32 %o66
+  %v66 = load volatile float, float addrspace(1)* %p66
+  %o67 = add i32 %id, 4288
+  %p67 = getelementptr float, float addrspace(1)* %in, i32 %o67
+  %v67 = load volatile float, float addrspace(1)* %p67
+  %o68 = add i32 %id, 4352
+  %p68 = getelementptr float, float addrspace(1)* %in, i32 %o68
+  %v68 = load volatile float, float addrspace(1)* %p68
+  %o69 = add i32 %id, 4416
+  %p69 = getelementptr float, float addrspace(1)* %in, i32 %o69
+  %v69 = load volatile float, float addrspace(1)* %p69
+  %o70 = add i32 %id, 4480
+  %p70 = getelementptr float, float addrspace(1)* %in, i32 %o70
+  %v70 = load volatile float, float addrspace(1)* %p70
+  %o71 = add i32 %id, 4544
+  %p71 = getelementptr float, float addrspace(1)* %in, i32 %o71
+  %v71 = load volatile float, float addrspace(1)* %p71
+  %o72 = add i32 %id, 4608
+  %p72 = getelementptr float, float addrspace(1)* %in, i32 %o72
+  %v72 = load volatile float, float addrspace(1)* %p72
+  %o73 = add i32 %id, 4672
+  %p73 = getelementptr float, float addrspace(1)* %in, i32 %o73
+  %v73 = load volatile float, float addrspace(1)* %p73
+  %o74 = add i32 %id, 4736
+  %p74 = getelementptr float, float addrspace(1)* %in, i32 %o74
+  %v74 = load volatile float, float addrspace(1)* %p74
+  %o75 = add i32 %id, 4800
+  %p75 = getelementptr float, float addrspace(1)* %in, i32 %o75
+  %v75 = load volatile float, float addrspace(1)* %p75
+  %o76 = add i32 %id, 4864
+  %p76 = getelementptr float, float addrspace(1)* %in, i32 %o76
+  %v76 = load volatile float, float addrspace(1)* %p76
+  %o77 = add i32 %id, 4928
+  %p77 = getelementptr float, float addrspace(1)* %in, i32 %o77
+  %v77 = load volatile float, float addrspace(1)* %p77
+  %o78 = add i32 %id, 4992
+  %p78 = getelementptr float, float addrspace(1)* %in, i32 %o78
+  %v78 = load volatile float, float addrspace(1)* %p78
+  %o79 = add i32 %id, 5056
+  %p79 = getelementptr float, float addrspace(1)* %in, i32 %o79
+  %v79 = load volatile float, float addrspace(1)* %p79
+  %o80 = add i32 %id, 5120
+  %p80 = getelementptr float, float addrspace(1)* %in, i32 %o80
+  %v80 = load volatile float, float addrspace(1)* %p80
+  %o81 = add i32 %id, 5184
+  %p81 = getelementptr float, float addrspace(1)* %in, i32 %o81
+  %v81 = load volatile float, float addrspace(1)* %p81
+  %o82 = add i32 %id, 5248
+  %p82 = getelementptr float, float addrspace(1)* %in, i32 %o82
+  %v82 = load volatile float, float addrspace(1)* %p82
+  %o83 = add i32 %id, 5312
+  %p83 = getelementptr float, float addrspace(1)* %in, i32 %o83
+  %v83 = load volatile float, float addrspace(1)* %p83
+  %o84 = add i32 %id, 5376
+  %p84 = getelementptr float, float addrspace(1)* %in, i32 %o84
+  %v84 = load volatile float, float addrspace(1)* %p84
+  %o85 = add i32 %id, 5440
+  %p85 = getelementptr float, float addrspace(1)* %in, i32 %o85
+  %v85 = load volatile float, float addrspace(1)* %p85
+  %o86 = add i32 %id, 5504
+  %p86 = getelementptr float, float addrspace(1)* %in, i32 %o86
+  %v86 = load volatile float, float addrspace(1)* %p86
+  %o87 = add i32 %id, 5568
+  %p87 = getelementptr float, float addrspace(1)* %in, i32 %o87
+  %v87 = load volatile float, float addrspace(1)* %p87
+  %o88 = add i32 %id, 5632
+  %p88 = getelementptr float, float addrspace(1)* %in, i32 %o88
+  %v88 = load volatile float, float addrspace(1)* %p88
+  %o89 = add i32 %id, 5696
+  %p89 = getelementptr float, float addrspace(1)* %in, i32 %o89
+  %v89 = load volatile float, float addrspace(1)* %p89
+  %o90 = add i32 %id, 5760
+  %p90 = getelementptr float, float addrspace(1)* %in, i32 %o90
+  %v90 = load volatile float, float addrspace(1)* %p90
+  %o91 = add i32 %id, 5824
+  %p91 = getelementptr float, float addrspace(1)* %in, i32 %o91
+  %v91 = load volatile float, float addrspace(1)* %p91
+  %o92 = add i32 %id, 5888
+  %p92 = getelementptr float, float addrspace(1)* %in, i32 %o92
+  %v92 = load volatile float, float addrspace(1)* %p92
+  %o93 = add i32 %id, 5952
+  %p93 = getelementptr float, float addrspace(1)* %in, i32 %o93
+  %v93 = load volatile float, float addrspace(1)* %p93
+  %o94 = add i32 %id, 6016
+  %p94 = getelementptr float, float addrspace(1)* %in, i32 %o94
+  %v94 = load volatile float, float addrspace(1)* %p94
+  %o95 = add i32 %id, 6080
+  %p95 = getelementptr float, float addrspace(1)* %in, i32 %o95
+  %v95 = load volatile float, float addrspace(1)* %p95
+  %q0 = getelementptr float, float addrspace(1)* %out, i32 %o0
+  store volatile float %v0, float addrspace(1)* %q0
+  %q1 = getelementptr float, float addrspace(1)* %out, i32 %o1
+  store volatile float %v1, float addrspace(1)* %q1
+  %q2 = getelementptr float, float addrspace(1)* %out, i32 %o2
+  store volatile float %v2, float addrspace(1)* %q2
+  %q3 = getelementptr float, float addrspace(1)* %out, i32 %o3
+  store volatile float %v3, float addrspace(1)* %q3
+  %q4 = getelementptr float, float addrspace(1)* %out, i32 %o4
+  store volatile float %v4, float addrspace(1)* %q4
+  %q5 = getelementptr float, float addrspace(1)* %out, i32 %o5
+  store volatile float %v5, float addrspace(1)* %q5
+  %q6 = getelementptr float, float addrspace(1)* %out, i32 %o6
+  store volatile float %v6, float addrspace(1)* %q6
+  %q7 = getelementptr float, float addrspace(1)* %out, i32 %o7
+  store volatile float %v7, float addrspace(1)* %q7
+  %q8 = getelementptr float, float addrspace(1)* %out, i32 %o8
+  store volatile float %v8, float addrspace(1)* %q8
+  %q9 = getelementptr float, float addrspace(1)* %out, i32 %o9
+  store volatile float %v9, float addrspace(1)* %q9
+  %q10 = getelementptr float, float addrspace(1)* %out, i32 %o10
+  store volatile float %v10, float addrspace(1)* %q10
+  %q11 = getelementptr float, float addrspace(1)* %out, i32 %o11
+  store volatile float %v11, float addrspace(1)* %q11
+  %q12 = getelementptr float, float addrspace(1)* %out, i32 %o12
+  store volatile float %v12, float addrspace(1)* %q12
+  %q13 = getelementptr float, float addrspace(1)* %out, i32 %o13
+  store volatile float %v13, float addrspace(1)* %q13
+  %q14 = getelementptr float, float addrspace(1)* %out, i32 %o14
+  store volatile float %v14, float addrspace(1)* %q14
+  %q15 = getelementptr float, float addrspace(1)* %out, i32 %o15
+  store volatile float %v15, float addrspace(1)* %q15
+  %q16 = getelementptr float, float addrspace(1)* %out, i32 %o16
+  store volatile float %v16, float addrspace(1)* %q16
+  %q17 = getelementptr float, float addrspace(1)* %out, i32 %o17
+  store volatile float %v17, float addrspace(1)* %q17
+  %q18 = getelementptr float, float addrspace(1)* %out, i32 %o18
+  store volatile float %v18, float addrspace(1)* %q18
+  %q19 = getelementptr float, float addrspace(1)* %out, i32 %o19
+  store volatile float %v19, float addrspace(1)* %q19
+  %q20 = getelementptr float, float addrspace(1)* %out, i32 %o20
+  store volatile float %v20, float addrspace(1)* %q20
+  %q21 = getelementptr float, float addrspace(1)* %out, i32 %o21
+  store volatile float %v21, float addrspace(1)* %q21
+  %q22 = getelementptr float, float addrspace(1)* %out, i32 %o22
+  store volatile float %v22, float addrspace(1)* %q22
+  %q23 = getelementptr float, float addrspace(1)* %out, i32 %o23
+  store volatile float %v23, float addrspace(1)* %q23
+  %q24 = getelementptr float, float addrspace(1)* %out, i32 %o24
+  store volatile float %v24, float addrspace(1)* %q24
+  %q25 = getelementptr float, float addrspace(1)* %out, i32 %o25
+  store volatile float %v25, float addrspace(1)* %q25
+  %q26 = getelementptr float, float addrspace(1)* %out, i32 %o26
+  store volatile float %v26, float addrspace(1)* %q26
+  %q27 = getelementptr float, float addrspace(1)* %out, i32 %o27
+  store volatile float %v27, float addrspace(1)* %q27
+  %q28 = getelementptr float, float addrspace(1)* %out, i32 %o28
+  store volatile float %v28, float addrspace(1)* %q28
+  %q29 = getelementptr float, float addrspace(1)* %out, i32 %o29
+  store volatile float %v29, float addrspace(1)* %q29
+  %q30 = getelementptr float, float addrspace(1)* %out, i32 %o30
+  store volatile float %v30, float addrspace(1)* %q30
+  %q31 = getelementptr float, float addrspace(1)* %out, i32 %o31
+  store volatile float %v31, float addrspace(1)* %q31
+  %q32 = getelementptr float, float addrspace(1)* %out, i32 %o32
+  store volatile float %v32, float addrspace(1)* %q32
+  %q33 = getelementptr float, float addrspace(1)* %out, i32 %o33
+  store volatile float %v33, float addrspace(1)* %q33
+  %q34 = getelementptr float, float addrspace(1)* %out, i32 %o34
+  store volatile float %v34, float addrspace(1)* %q34
+  %q35 = getelementptr float, float addrspace(1)* %out, i32 %o35
+  store volatile float %v35, float addrspace(1)* %q35
+  %q36 = getelementptr float, float addrspace(1)* %out, i32 %o36
+  store volatile float %v36, float addrspace(1)* %q36
+  %q37 = getelementptr float, float addrspace(1)* %out, i32 %o37
+  store volatile float %v37, float addrspace(1)* %q37
+  %q38 = getelementptr float, float addrspace(1)* %out, i32 %o38
+  store volatile float %v38, float addrspace(1)* %q38
+  %q39 = getelementptr float, float addrspace(1)* %out, i32 %o39
+  store volatile float %v39, float addrspace(1)* %q39
+  %q40 = getelementptr float, float addrspace(1)* %out, i32 %o40
+  store volatile float %v40, float addrspace(1)* %q40
+  %q41 = getelementptr float, float addrspace(1)* %out, i32 %o41
+  store volatile float %v41, float addrspace(1)* %q41
+  %q42 = getelementptr float, float addrspace(1)* %out, i32 %o42
+  store volatile float %v42, float addrspace(1)* %q42
+  %q43 = getelementptr float, float addrspace(1)* %out, i32 %o43
+  store volatile float %v43, float addrspace(1)* %q43
+  %q44 = getelementptr float, float addrspace(1)* %out, i32 %o44
+  store volatile float %v44, float addrspace(1)* %q44
+  %q45 = getelementptr float, float addrspace(1)* %out, i32 %o45
+  store volatile float %v45, float addrspace(1)* %q45
+  %q46 = getelementptr float, float addrspace(1)* %out, i32 %o46
+  store volatile float %v46, float addrspace(1)* %q46
+  %q47 = getelementptr float, float addrspace(1)* %out, i32 %o47
+  store volatile float %v47, float addrspace(1)* %q47
+  %q48 = getelementptr float, float addrspace(1)* %out, i32 %o48
+  store volatile float %v48, float addrspace(1)* %q48
+  %q49 = getelementptr float, float addrspace(1)* %out, i32 %o49
+  store volatile float %v49, float addrspace(1)* %q49
+  %q50 = getelementptr float, float addrspace(1)* %out, i32 %o50
+  store volatile float %v50, float addrspace(1)* %q50
+  %q51 = getelementptr float, float addrspace(1)* %out, i32 %o51
+  store volatile float %v51, float addrspace(1)* %q51
+  %q52 = getelementptr float, float addrspace(1)* %out, i32 %o52
+  store volatile float %v52, float addrspace(1)* %q52
+  %q53 = getelementptr float, float addrspace(1)* %out, i32 %o53
+  store volatile float %v53, float addrspace(1)* %q53
+  %q54 = getelementptr float, float addrspace(1)* %out, i32 %o54
+  store volatile float %v54, float addrspace(1)* %q54
+  %q55 = getelementptr float, float addrspace(1)* %out, i32 %o55
+  store volatile float %v55, float addrspace(1)* %q55
+  %q56 = getelementptr float, float addrspace(1)* %out, i32 %o56
+  store volatile float %v56, float addrspace(1)* %q56
+  %q57 = getelementptr float, float addrspace(1)* %out, i32 %o57
+  store volatile float %v57, float addrspace(1)* %q57
+  %q58 = getelementptr float, float addrspace(1)* %out, i32 %o58
+  store volatile float %v58, float addrspace(1)* %q58
+  %q59 = getelementptr float, float addrspace(1)* %out, i32 %o59
+  store volatile float %v59, float addrspace(1)* %q59
+  %q60 = getelementptr float, float addrspace(1)* %out, i32 %o60
+  store volatile float %v60, float addrspace(1)* %q60
+  %q61 = getelementptr float, float addrspace(1)* %out, i32 %o61
+  store volatile float %v61, float addrspace(1)* %q61
+  %q62 = getelementptr float, float addrspace(1)* %out, i32 %o62
+  store volatile float %v62, float addrspace(1)* %q62
+  %q63 = getelementptr float, float addrspace(1)* %out, i32 %o63
+  store volatile float %v63, float addrspace(1)* %q63
+  %q64 = getelementptr float, float addrspace(1)* %out, i32 %o64
+  store volatile float %v64, float addrspace(1)* %q64
+  %q65 = getelementptr float, float addrspace(1)* %out, i32 %o65
+  store volatile float %v65, float addrspace(1)* %q65
+  %q66 = getelementptr float, float addrspace(1)* %out, i32 %o66
+  store volatile float %v66, float addrspace(1)* %q66
+  %q67 = getelementptr float, float addrspace(1)* %out, i32 %o67
+  store volatile float %v67, float addrspace(1)* %q67
+  %q68 = getelementptr float, float addrspace(1)* %out, i32 %o68
+  store volatile float %v68, float addrspace(1)* %q68
+  %q69 = getelementptr float, float addrspace(1)* %out, i32 %o69
+  store volatile float %v69, float addrspace(1)* %q69
+  %q70 = getelementptr float, float addrspace(1)* %out, i32 %o70
+  store volatile float %v70, float addrspace(1)* %q70
+  %q71 = getelementptr float, float addrspace(1)* %out, i32 %o71
+  store volatile float %v71, float addrspace(1)* %q71
+  %q72 = getelementptr float, float addrspace(1)* %out, i32 %o72
+  store volatile float %v72, float addrspace(1)* %q72
+  %q73 = getelementptr float, float addrspace(1)* %out, i32 %o73
+  store volatile float %v73, float addrspace(1)* %q73
+  %q74 = getelementptr float, float addrspace(1)* %out, i32 %o74
+  store volatile float %v74, float addrspace(1)* %q74
+  %q75 = getelementptr float, float addrspace(1)* %out, i32 %o75
+  store volatile float %v75, float addrspace(1)* %q75
+  %q76 = getelementptr float, float addrspace(1)* %out, i32 %o76
+  store volatile float %v76, float addrspace(1)* %q76
+  %q77 = getelementptr float, float addrspace(1)* %out, i32 %o77
+  store volatile float %v77, float addrspace(1)* %q77
+  %q78 = getelementptr float, float addrspace(1)* %out, i32 %o78
+  store volatile float %v78, float addrspace(1)* %q78
+  %q79 = getelementptr float, float addrspace(1)* %out, i32 %o79
+  store volatile float %v79, float addrspace(1)* %q79
+  %q80 = getelementptr float, float addrspace(1)* %out, i32 %o80
+  store volatile float %v80, float addrspace(1)* %q80
+  %q81 = getelementptr float, float addrspace(1)* %out, i32 %o81
+  store volatile float %v81, float addrspace(1)* %q81
+  %q82 = getelementptr float, float addrspace(1)* %out, i32 %o82
+  store volatile float %v82, float addrspace(1)* %q82
+  %q83 = getelementptr float, float addrspace(1)* %out, i32 %o83
+  store volatile float %v83, float addrspace(1)* %q83
+  %q84 = getelementptr float, float addrspace(1)* %out, i32 %o84
+  store volatile float %v84, float addrspace(1)* %q84
+  %q85 = getelementptr float, float addrspace(1)* %out, i32 %o85
+  store volatile float %v85, float addrspace(1)* %q85
+  %q86 = getelementptr float, float addrspace(1)* %out, i32 %o86
+  store volatile float %v86, float addrspace(1)* %q86
+  %q87 = getelementptr float, float addrspace(1)* %out, i32 %o87
+  store volatile float %v87, float addrspace(1)* %q87
+  %q88 = getelementptr float, float addrspace(1)* %out, i32 %o88
+  store volatile float %v88, float addrspace(1)* %q88
+  %q89 = getelementptr float, float addrspace(1)* %out, i32 %o89
+  store volatile float %v89, float addrspace(1)* %q89
+  %q90 = getelementptr float, float addrspace(1)* %out, i32 %o90
+  store volatile float %v90, float addrspace(1)* %q90
+  %q91 = getelementptr float, float addrspace(1)* %out, i32 %o91
+  store volatile float %v91, float addrspace(1)* %q91
+  %q92 = getelementptr float, float addrspace(1)* %out, i32 %o92
+  store volatile float %v92, float addrspace(1)* %q92
+  %q93 = getelementptr float, float addrspace(1)* %out, i32 %o93
+  store volatile float %v93, float addrspace(1)* %q93
+  %q94 = getelementptr float, float addrspace(1)* %out, i32 %o94
+  store volatile float %v94, float addrspace(1)* %q94
+  %q95 = getelementptr float, float addrspace(1)* %out, i32 %o95
+  store volatile float %v95, float addrspace(1)* %q95
+  ret void
+}
+
+declare i32 @llvm.amdgcn.workitem.id.x()
+
+attributes #0 = { nounwind }
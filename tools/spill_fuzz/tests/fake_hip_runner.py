@@ -0,0 +1,65 @@
+"""hip_runner built against the fake HIP runtime, shared by the tests.
+
+The binary is built once per test process with $CXX (default c++) and
+-DHIP_RUNNER_FAKE_BACKEND, or taken from $HIP_RUNNER. Tests that need it
+derive from HipRunnerTestCase, which skips them when there is neither.
+"""
+
+import atexit
+import os
+import shutil
+import subprocess
+import tempfile
+import unittest
+from pathlib import Path
+from typing import Optional
+
+TESTS_DIR = Path(__file__).resolve().parent
+DATA_DIR = TESTS_DIR / "data"
+TOOLS_DIR = TESTS_DIR.parent
+
+_built: Optional[Path] = None
+
+
+def build_fake_hip_runner(out_dir: Path) -> Path:
+    exe = out_dir / "hip_runner"
+    subprocess.run([os.environ.get("CXX", "c++"), "-O1", "-std=c++17", "-pthread",
+                    "-DHIP_RUNNER_FAKE_BACKEND", "-o", str(exe), str(TOOLS_DIR / "hip_runner.cpp")],
+                   check=True)
+    return exe
+
+
+def fake_hip_runner() -> Optional[Path]:
+    """The hip_runner to test, or None if it cannot be built."""
+    global _built
+    if os.environ.get("HIP_RUNNER"):
+        return Path(os.environ["HIP_RUNNER"])
+    if _built is None:
+        if not shutil.which(os.environ.get("CXX", "c++")):
+            return None
+        out_dir = Path(tempfile.mkdtemp(prefix="fake_hip_runner."))
+        atexit.register(shutil.rmtree, out_dir, True)
+        _built = build_fake_hip_runner(out_dir)
+    return _built
+
+
+class HipRunnerTestCase(unittest.TestCase):
+    """Runs the fake hip_runner; self.tmp is a scratch directory per class."""
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        cls.hip_runner = fake_hip_runner()
+        if cls.hip_runner is None:
+            raise unittest.SkipTest("no C++ compiler to build hip_runner")
+        cls.tmp = Path(tempfile.mkdtemp(prefix=f"{cls.__name__}."))
+
+    @classmethod
+    def tearDownClass(cls) -> None:
+        shutil.rmtree(cls.tmp, ignore_errors=True)
+
+    def run_hip_runner(self, *args: str, env: Optional[dict] = None,
+                       timeout: float = 60) -> subprocess.CompletedProcess:
+        return subprocess.run([str(self.hip_runner), *args], stdout=subprocess.PIPE,
+                              stderr=subprocess.PIPE, universal_newlines=True,
+                              env=None if env is None else dict(os.environ, **env),
+                              timeout=timeout)
@@ -0,0 +1,224 @@
+"""Tests of the --devices oracle pool with simulated devices.
+
+Each device's oracle is a function of the job, so a test can make one device
+fail with runtime errors, fault every kernel, or recover, and check which
+device the pool blames and what reaches the result cache. The oracle exit
+status classification is checked with a shell command standing in for
+run_on_gpu.sh.
+"""
+
+import argparse
+import shutil
+import sys
+import tempfile
+import threading
+import time
+import unittest
+from pathlib import Path
+
+TOOLS_DIR = Path(__file__).resolve().parent.parent
+
+sys.path.insert(0, str(TOOLS_DIR))
+import spill_fuzz  # noqa: E402
+from spill_fuzz import (CampaignStats, CommandOracle, DevicePool, FuzzConfig,  # noqa: E402
+                        IterationResult, OracleJob, StageStats)
+
+
+class FakeCache:
+    """The ResultCache calls store_result makes, keyed by input path."""
+
+    def __init__(self) -> None:
+        self.entries = {}
+
+    def key(self, input_digest: str, test_obj: Path) -> str:
+        return input_digest
+
+    def store(self, key: str, status: str, reason: str) -> None:
+        self.entries[key] = (status, reason)
+
+
+class FakeRecorder:
+    def __init__(self) -> None:
+        self.stats = CampaignStats()
+        self.results = []
+
+    def record(self, result: IterationResult, worker_id: int = 0) -> None:
+        self.results.append(result)
+
+
+class FakeOracle:
+    """Answers each job with outcome(job), one of "pass", "device-error" or
+    "kernel-fault", after `latency` seconds."""
+
+    def __init__(self, outcome, latency: float = 0.0) -> None:
+        self.outcome = outcome
+        self.latency = latency
+
+    def run(self, job: OracleJob) -> IterationResult:
+        time.sleep(self.latency)
+        outcome = self.outcome(job)
+        if outcome == "device-error":
+            result = job.result(IterationResult.FAIL, "gpu-device")
+            result.device_fault = True
+            result.cacheable = False
+        elif outcome == "kernel-fault":
+            result = job.result(IterationResult.FAIL, "gpu-fault")
+            result.kernel_fault = True
+        else:
+            result = job.result(IterationResult.PASS)
+        return result
+
+
+def make_job(name: str) -> OracleJob:
+    cfg = FuzzConfig("llc", "gfx90a", "", False, 32, 32, None, None)
+    path = Path("/corpus") / name
+    return OracleJob(cfg, path, path, None, path.with_suffix(".o"), None)
+
+
+def jobs_homed_on(pool: DevicePool, device: str, count: int, prefix: str = "k"):
+    """count jobs whose home device is `device`."""
+    jobs = []
+    i = 0
+    while len(jobs) < count:
+        job = make_job(f"{prefix}{i}.ll")
+        i += 1
+        if pool.home(job) == device:
+            jobs.append(job)
+    return jobs
+
+
+class DevicePoolTest(unittest.TestCase):
+    def run_pool(self, pool: DevicePool, oracles, jobs):
+        """Queue jobs, run one worker per device until the pool drains and
+        return the recorded results."""
+        args = argparse.Namespace(result_cache_store=self.cache, input_digests={
+            str(job.input_path.resolve()): str(job.input_path) for job in jobs})
+        recorder = FakeRecorder()
+        stage = StageStats(len(pool.devices))
+        lock = threading.Lock()
+        for job in jobs:
+            pool.put(0, job)
+        threads = [threading.Thread(target=spill_fuzz.device_oracle_worker,
+                                    args=(args, device, pool, recorder, stage, lock,
+                                          oracles[device]))
+                   for device in pool.devices]
+        for thread in threads:
+            thread.start()
+        pool.close()
+        for thread in threads:
+            thread.join(timeout=30)
+            self.assertFalse(thread.is_alive(), "the pool did not drain")
+        self.assertEqual(len(recorder.results), len(jobs))
+        return recorder.results
+
+    def setUp(self) -> None:
+        self.cache = FakeCache()
+
+    def test_runtime_errors_quarantine_the_device(self) -> None:
+        pool = DevicePool(["0", "1", "2"], 64, 1, fault_limit=2, probe_interval=0)
+        good = FakeOracle(lambda job: "pass", latency=0.02)
+        broken = FakeOracle(lambda job: "device-error")
+        jobs = jobs_homed_on(pool, "2", 12)
+        results = self.run_pool(pool, {"0": good, "1": good, "2": broken}, jobs)
+
+        self.assertEqual(pool.quarantined, {"2"})
+        self.assertEqual(pool.stats["2"]["faults"], 2)
+        self.assertTrue(all(r.status == IterationResult.PASS for r in results))
+        self.assertNotIn("2", {r.device for r in results})
+        self.assertEqual(len(self.cache.entries), len(jobs))
+
+    def test_kernel_fault_on_every_device_is_a_code_fault(self) -> None:
+        pool = DevicePool(["0", "1"], 64, 1, fault_limit=1, probe_interval=0)
+        oracle = FakeOracle(lambda job: "kernel-fault" if job.input_path.name.startswith("bad")
+                            else "pass")
+        jobs = [make_job(f"bad{i}.ll") for i in range(4)] + [make_job(f"ok{i}.ll")
+                                                            for i in range(4)]
+        results = self.run_pool(pool, {"0": oracle, "1": oracle}, jobs)
+
+        self.assertEqual(pool.quarantined, set())
+        self.assertEqual(pool.stats["0"]["faults"] + pool.stats["1"]["faults"], 0)
+        faults = [r for r in results if r.status == IterationResult.FAIL]
+        self.assertEqual(sorted(r.input_path.name for r in faults),
+                         [f"bad{i}.ll" for i in range(4)])
+        self.assertTrue(all(r.reason == "gpu-fault" for r in faults))
+        for job in jobs[:4]:
+            self.assertEqual(sorted(job.tried), ["0", "1"])
+            self.assertEqual(self.cache.entries[str(job.input_path)],
+                             (IterationResult.FAIL, "gpu-fault"))
+
+    def test_fault_that_does_not_reproduce_blames_the_device(self) -> None:
+        pool = DevicePool(["0", "1"], 64, 1, fault_limit=2, probe_interval=0)
+        good = FakeOracle(lambda job: "pass", latency=0.02)
+        faulty = FakeOracle(lambda job: "kernel-fault")
+        jobs = jobs_homed_on(pool, "1", 8)
+        results = self.run_pool(pool, {"0": good, "1": faulty}, jobs)
+
+        self.assertEqual(pool.quarantined, {"1"})
+        # Every fault confirmed elsewhere is charged, including those of jobs
+        # device 1 ran before the first confirmation quarantined it.
+        self.assertGreaterEqual(pool.stats["1"]["faults"], 2)
+        self.assertTrue(all(r.status == IterationResult.PASS for r in results))
+        self.assertEqual(set(self.cache.entries.values()), {(IterationResult.PASS, "")})
+
+    def test_probe_restores_a_recovered_device(self) -> None:
+        pool = DevicePool(["0", "1"], 64, 1, fault_limit=1, probe_interval=0.05)
+        runs = {"1": 0}
+
+        def flaky(job: OracleJob) -> str:
+            runs["1"] += 1
+            return "device-error" if runs["1"] == 1 else "pass"
+
+        good = FakeOracle(lambda job: "pass", latency=0.02)
+        jobs = jobs_homed_on(pool, "1", 1) + jobs_homed_on(pool, "0", 20, prefix="j")
+        results = self.run_pool(pool, {"0": good, "1": FakeOracle(flaky, latency=0.02)}, jobs)
+
+        self.assertGreaterEqual(pool.stats["1"]["probes"], 1)
+        self.assertEqual(pool.quarantined, set())
+        self.assertFalse(pool.stats["1"]["quarantined"])
+        self.assertIn("1", {r.device for r in results})
+        self.assertTrue(all(r.status == IterationResult.PASS for r in results))
+
+
+class CommandOracleStatusTest(unittest.TestCase):
+    """How CommandOracle classifies the exit status of --gpu-cmd."""
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        cls.tmp = Path(tempfile.mkdtemp(prefix="spill_fuzz_oracle."))
+        cls.input = cls.tmp / "k.ll"
+        cls.input.write_text("define amdgpu_kernel void @k() {\n  ret void\n}\n",
+                             encoding="utf-8")
+
+    @classmethod
+    def tearDownClass(cls) -> None:
+        shutil.rmtree(cls.tmp, ignore_errors=True)
+
+    def run_status(self, status: int) -> IterationResult:
+        oracle = CommandOracle(["sh", "-c", f"exit {status}", "gpu-cmd"], 10.0,
+                               self.tmp / "ref_cache")
+        cfg = FuzzConfig("llc", "gfx90a", "", False, 32, 32, None, None)
+        return oracle.run(OracleJob(cfg, self.input, self.input, None, None, None))
+
+    def test_runtime_error_is_a_device_fault(self) -> None:
+        result = self.run_status(125)
+        self.assertEqual((result.status, result.reason), (IterationResult.FAIL, "gpu-device"))
+        self.assertTrue(result.device_fault)
+        self.assertFalse(result.kernel_fault)
+        self.assertFalse(result.cacheable)
+
+    def test_signal_death_is_a_cacheable_kernel_fault(self) -> None:
+        result = self.run_status(139)
+        self.assertEqual((result.status, result.reason), (IterationResult.FAIL, "gpu-fault"))
+        self.assertTrue(result.kernel_fault)
+        self.assertFalse(result.device_fault)
+        self.assertTrue(result.cacheable)
+
+    def test_other_failure_is_neither(self) -> None:
+        result = self.run_status(1)
+        self.assertEqual((result.status, result.reason), (IterationResult.FAIL, "gpu"))
+        self.assertFalse(result.kernel_fault or result.device_fault)
+        self.assertFalse(result.cacheable)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,102 @@
+"""hip_runner lanes spread over several (fake) devices.
+
+HIP_RUNNER_FAKE_DEVICES=N makes the fake runtime show N devices. Buffers,
+streams and modules belong to the device that was current when they were
+made, and a launch or copy that mixes devices fails, so a batch that runs
+clean with --devices 0 shows that every lane's work stayed on its device.
+"""
+
+import json
+import os
+import subprocess
+import sys
+import time
+import unittest
+from pathlib import Path
+from typing import List
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+from fake_hip_runner import HipRunnerTestCase  # noqa: E402
+
+KERNEL_SPEC = "kernel kern\narg global_buffer 8 global\narg global_buffer 8 global\n"
+TWO_DEVICES = {"HIP_RUNNER_FAKE_DEVICES": "2"}
+FALLBACK_WARNING = ("--device-compare needs one device; comparing the outputs of 2 devices "
+                    "on the host")
+
+
+class MultiDeviceTest(HipRunnerTestCase):
+    def setUp(self) -> None:
+        self.dir = self.tmp / self.id().rsplit(".", 1)[-1]
+        self.dir.mkdir()
+        self.spec = self.dir / "k.spec"
+        self.spec.write_text(KERNEL_SPEC, encoding="utf-8")
+        self.report = self.dir / "report.json"
+
+    def code_object(self, name: str, marker: str = "") -> Path:
+        path = self.dir / f"{name}.hsaco"
+        path.write_text(f"kern {name}\n{marker}\n", encoding="utf-8")
+        return path
+
+    def run_batch(self, tests: List[Path], *extra: str) -> subprocess.CompletedProcess:
+        args = ["--hsaco-a", str(self.code_object("ref")), "--spec", str(self.spec),
+                "--buffer-size", "4096", "--report", str(self.report), *extra]
+        for test in tests:
+            args += ["--hsaco-b", str(test)]
+        return self.run_hip_runner(*args, env=TWO_DEVICES)
+
+    def verdicts(self) -> List[str]:
+        report = json.loads(self.report.read_text(encoding="utf-8"))
+        return [v["verdict"] for v in report["variants"]]
+
+    def test_all_devices_run_a_batch(self) -> None:
+        # Five variants on four streams: lanes 0..4 alternate between the two
+        # devices, and the second wave reuses lanes on both.
+        tests = [self.code_object(f"t{i}") for i in range(5)]
+        proc = self.run_batch(tests, "--devices", "0")
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertEqual(self.verdicts(), ["match"] * 5)
+
+    def test_mismatch_on_either_device_is_found(self) -> None:
+        # With four streams, t0 runs on device 1 and t1 on device 0.
+        tests = [self.code_object("t0", "spill-fuzz-fake:mismatch"),
+                 self.code_object("t1", "spill-fuzz-fake:mismatch"), self.code_object("t2")]
+        proc = self.run_batch(tests, "--devices", "0")
+        self.assertEqual(proc.returncode, 1, proc.stderr)
+        self.assertEqual(self.verdicts(), ["mismatch", "mismatch", "match"])
+
+    def test_server_spreads_lanes_over_devices(self) -> None:
+        socket_path = self.dir / "server.sock"
+        server = subprocess.Popen([str(self.hip_runner), "--serve", str(socket_path),
+                                   "--devices", "0"], stdin=subprocess.DEVNULL,
+                                  stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                                  env=dict(os.environ, **TWO_DEVICES))
+        self.addCleanup(server.wait)
+        self.addCleanup(server.kill)
+        while not socket_path.exists():
+            self.assertIsNone(server.poll(), "hip_runner server did not start")
+            time.sleep(0.01)
+        tests = [self.code_object(f"t{i}") for i in range(3)]
+        proc = self.run_batch(tests, "--connect", str(socket_path))
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertNotIn("running locally", proc.stderr)
+        self.assertEqual(self.verdicts(), ["match"] * 3)
+
+    def test_device_compare_falls_back_to_host_compare(self) -> None:
+        tests = [self.code_object("good"), self.code_object("bad", "spill-fuzz-fake:mismatch")]
+        proc = self.run_batch(tests, "--devices", "0", "--device-compare")
+        self.assertEqual(proc.returncode, 1, proc.stderr)
+        self.assertEqual(proc.stderr.count(FALLBACK_WARNING), 1, proc.stderr)
+        self.assertEqual(self.verdicts(), ["match", "mismatch"])
+
+    def test_one_device_by_default(self) -> None:
+        # Two devices are visible, but lanes stay on one unless --devices asks,
+        # so device compare is kept.
+        proc = self.run_batch([self.code_object("bad", "spill-fuzz-fake:mismatch")],
+                              "--device-compare")
+        self.assertEqual(proc.returncode, 1, proc.stderr)
+        self.assertNotIn("--device-compare needs one device", proc.stderr)
+        self.assertEqual(self.verdicts(), ["mismatch"])
+
+
+if __name__ == "__main__":
+    unittest.main()
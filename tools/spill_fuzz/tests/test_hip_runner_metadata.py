@@ -0,0 +1,91 @@
+"""Golden tests of hip_runner --dump-metadata and --emit-spec.
+
+The code objects under data/ are built from the .ll files next to them (the
+commands are in each file's header): an llc object and a linked code object of
+a kernel with explicit and hidden arguments, and a code object whose only
+kernel has no explicit argument. The expected outputs sit beside them; after
+an intended change, regenerate one with e.g.
+
+    hip_runner --dump-metadata data/metadata_kernels.o > data/metadata_kernels.o.metadata
+
+The tests use the fake hip_runner of fake_hip_runner.py.
+"""
+
+import sys
+import unittest
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+from fake_hip_runner import DATA_DIR, TOOLS_DIR, HipRunnerTestCase  # noqa: E402
+
+sys.path.insert(0, str(TOOLS_DIR))
+from amdgpu_metadata import read_kernels, spill_counts  # noqa: E402
+
+
+class HipRunnerMetadataTest(HipRunnerTestCase):
+    def assert_golden(self, actual: str, golden: str) -> None:
+        self.assertEqual(actual, (DATA_DIR / golden).read_text(encoding="utf-8"))
+
+    def test_dump_metadata_of_llc_object(self) -> None:
+        proc = self.run_hip_runner("--dump-metadata", str(DATA_DIR / "metadata_kernels.o"))
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assert_golden(proc.stdout, "metadata_kernels.o.metadata")
+
+    def test_dump_metadata_of_linked_code_object(self) -> None:
+        proc = self.run_hip_runner("--dump-metadata", str(DATA_DIR / "metadata_kernels.hsaco"))
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assert_golden(proc.stdout, "metadata_kernels.hsaco.metadata")
+        self.assertIn("hidden_global_offset_x", proc.stdout)
+
+    def test_dump_metadata_of_kernel_without_arguments(self) -> None:
+        proc = self.run_hip_runner("--dump-metadata", str(DATA_DIR / "no_args.hsaco"))
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assert_golden(proc.stdout, "no_args.hsaco.metadata")
+
+    def test_dump_metadata_rejects_non_elf(self) -> None:
+        proc = self.run_hip_runner("--dump-metadata", str(DATA_DIR / "metadata_kernels.ll"))
+        self.assertEqual(proc.returncode, 2)
+        self.assertIn("not an ELF file", proc.stderr)
+
+    def test_emit_spec_skips_hidden_arguments(self) -> None:
+        spec = self.tmp / "scale.spec"
+        proc = self.run_hip_runner("--emit-spec", str(DATA_DIR / "metadata_kernels.hsaco"),
+                                   "--out", str(spec))
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assert_golden(spec.read_text(encoding="utf-8"), "metadata_kernels.spec")
+
+    def test_emit_spec_selects_kernel_by_name(self) -> None:
+        spec = self.tmp / "named.spec"
+        proc = self.run_hip_runner("--emit-spec", str(DATA_DIR / "metadata_kernels.hsaco"),
+                                   "--kernel", "scale", "--out", str(spec))
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assert_golden(spec.read_text(encoding="utf-8"), "metadata_kernels.spec")
+
+    def test_emit_spec_exits_3_without_compatible_kernel(self) -> None:
+        for code_object, kernel in (("no_args.hsaco", []),
+                                    ("metadata_kernels.hsaco", ["--kernel", "missing"])):
+            with self.subTest(code_object=code_object, kernel=kernel):
+                spec = self.tmp / "none.spec"
+                proc = self.run_hip_runner("--emit-spec", str(DATA_DIR / code_object),
+                                           *kernel, "--out", str(spec))
+                self.assertEqual(proc.returncode, 3, proc.stderr)
+                self.assertFalse(spec.exists())
+
+
+class PythonMetadataReaderTest(unittest.TestCase):
+    """amdgpu_metadata.py reads the same notes as hip_runner."""
+
+    def test_reads_kernels_of_object_and_code_object(self) -> None:
+        for name in ("metadata_kernels.o", "metadata_kernels.hsaco"):
+            with self.subTest(name=name):
+                kernels = read_kernels(DATA_DIR / name)
+                self.assertEqual([k[".name"] for k in kernels], ["scale"])
+                self.assertEqual(kernels[0][".kernarg_segment_size"], 80)
+                self.assertEqual(spill_counts(DATA_DIR / name), (0, 0))
+
+    def test_spill_counts_of_unreadable_file(self) -> None:
+        self.assertIsNone(spill_counts(DATA_DIR / "metadata_kernels.ll"))
+
+
+if __name__ == "__main__":
+    unittest.main()
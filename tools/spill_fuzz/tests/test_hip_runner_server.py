@@ -0,0 +1,219 @@
+"""Tests of the hip_runner server: --serve / --connect round trips.
+
+The fake HIP runtime treats any file that names the kernel as a code object
+and runs a fixed transform as the kernel; a "spill-fuzz-fake:..." marker in
+the file changes what the kernel does (see hip_fake_runtime.h). The tests
+start a server on a socket in a temporary directory, send it tests with
+hip_runner --connect and check exit statuses, the --report JSON and the
+module cache counts the server prints when it quits. A --zygote server must
+answer a crash with 134 and a hang with 124 and keep serving; a plain server
+answers a hang and exits.
+"""
+
+import json
+import socket
+import struct
+import subprocess
+import sys
+import time
+import unittest
+from pathlib import Path
+from typing import List, Optional
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+from fake_hip_runner import HipRunnerTestCase  # noqa: E402
+
+KERNEL_SPEC = "kernel kern\narg global_buffer 8 global\narg global_buffer 8 global\n"
+
+
+class HipRunnerServer:
+    """A `hip_runner --serve SOCKET` process with its stderr in a file."""
+
+    def __init__(self, hip_runner: Path, tmp: Path, *options: str) -> None:
+        self.socket_path = tmp / "server.sock"
+        self.log_path = tmp / "server.log"
+        self.log = open(self.log_path, "w", encoding="utf-8")
+        self.proc = subprocess.Popen([str(hip_runner), "--serve", str(self.socket_path),
+                                      *options], stdin=subprocess.DEVNULL,
+                                     stdout=self.log, stderr=self.log)
+        deadline = time.monotonic() + 30
+        while not self.socket_path.exists():
+            if self.proc.poll() is not None or time.monotonic() > deadline:
+                raise RuntimeError(f"hip_runner server did not start: {self.log_text()}")
+            time.sleep(0.01)
+
+    def log_text(self) -> str:
+        self.log.flush()
+        return self.log_path.read_text(encoding="utf-8", errors="replace")
+
+    def quit(self) -> bytes:
+        """Send kOpQuit and return the response frame's payload."""
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as conn:
+            conn.settimeout(30)
+            conn.connect(str(self.socket_path))
+            conn.sendall(struct.pack("<IB", 1, 2))
+            header = conn.recv(4, socket.MSG_WAITALL)
+            size, = struct.unpack("<I", header)
+            payload = conn.recv(size, socket.MSG_WAITALL)
+        self.proc.wait(timeout=30)
+        return payload
+
+    def close(self) -> None:
+        if self.proc.poll() is None:
+            self.proc.kill()
+            self.proc.wait()
+        self.log.close()
+
+
+class ServerTestCase(HipRunnerTestCase):
+    """Writes the fake code objects and starts a server per test."""
+
+    server_options: List[str] = []
+
+    def setUp(self) -> None:
+        self.dir = self.tmp / self.id().rsplit(".", 1)[-1]
+        self.dir.mkdir()
+        self.spec = self.dir / "k.spec"
+        self.spec.write_text(KERNEL_SPEC, encoding="utf-8")
+        self.server = HipRunnerServer(self.hip_runner, self.dir, *self.server_options)
+        self.addCleanup(self.server.close)
+
+    def code_object(self, name: str, marker: str = "") -> Path:
+        """A fake code object; distinct names give distinct modules."""
+        path = self.dir / f"{name}.hsaco"
+        path.write_text(f"kern {name}\n{marker}\n", encoding="utf-8")
+        return path
+
+    def connect(self, ref: Path, *tests: Path, report: Optional[Path] = None,
+                extra: List[str] = ()) -> subprocess.CompletedProcess:
+        args = ["--connect", str(self.server.socket_path), "--hsaco-a", str(ref),
+                "--spec", str(self.spec), "--buffer-size", "4096"]
+        for test in tests:
+            args += ["--hsaco-b", str(test)]
+        if report is not None:
+            args += ["--report", str(report)]
+        return self.run_hip_runner(*args, *extra)
+
+    def read_report(self, path: Path) -> dict:
+        return json.loads(path.read_text(encoding="utf-8"))
+
+
+class ServeConnectTest(ServerTestCase):
+    # The cache holds at least one module per lane; one stream keeps it at 2.
+    server_options = ["--module-cache", "2", "--streams", "1"]
+
+    def test_match_round_trip(self) -> None:
+        ref = self.code_object("ref")
+        report = self.dir / "report.json"
+        proc = self.connect(ref, self.code_object("same"), report=report)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertNotIn("running locally", proc.stderr)
+        data = self.read_report(report)
+        self.assertEqual(data["status"], 0)
+        self.assertEqual(data["reference"], str(ref))
+        self.assertEqual([v["verdict"] for v in data["variants"]], ["match"])
+
+    def test_mismatch_round_trip(self) -> None:
+        report = self.dir / "report.json"
+        bad = self.code_object("bad", "spill-fuzz-fake:mismatch")
+        proc = self.connect(self.code_object("ref"), bad, report=report)
+        self.assertEqual(proc.returncode, 1)
+        self.assertIn("output mismatch in argument 0", proc.stderr)
+        data = self.read_report(report)
+        self.assertEqual(data["status"], 1)
+        variant, = data["variants"]
+        self.assertEqual(variant["hsaco"], str(bad))
+        self.assertEqual(variant["verdict"], "mismatch")
+        self.assertTrue(variant["message"].startswith("output mismatch"), variant)
+
+    def test_batch_reports_each_variant_in_order(self) -> None:
+        report = self.dir / "report.json"
+        variants = [self.code_object("good"), self.code_object("bad", "spill-fuzz-fake:mismatch"),
+                    self.code_object("missing_kernel").with_name("absent.hsaco")]
+        proc = self.connect(self.code_object("ref"), *variants, report=report)
+        self.assertEqual(proc.returncode, 1)
+        data = self.read_report(report)
+        self.assertEqual(data["message"], "2 of 3 variants failed")
+        self.assertEqual([v["hsaco"] for v in data["variants"]], [str(v) for v in variants])
+        self.assertEqual([v["verdict"] for v in data["variants"]],
+                         ["match", "mismatch", "error"])
+        self.assertEqual(data["variants"][2]["message"], "hipModuleLoad failed")
+
+    def test_module_cache_is_lru(self) -> None:
+        ref, first, second = (self.code_object(name) for name in ("ref", "first", "second"))
+        # Capacity 2: ref and first load, then hit; second evicts first, and
+        # first then evicts second, while ref stays hot.
+        for test in (first, first, second, first):
+            proc = self.connect(ref, test)
+            self.assertEqual(proc.returncode, 0, proc.stderr)
+        # status 0, then the message string.
+        self.assertEqual(self.server.quit()[:8], b"\x00" + struct.pack("<I", 3) + b"bye")
+        self.assertIn("module cache 4 hits, 4 loads", self.server.log_text())
+
+    def test_falls_back_to_a_local_run_without_a_server(self) -> None:
+        ref = self.code_object("ref")
+        self.server.quit()
+        report = self.dir / "report.json"
+        proc = self.connect(ref, self.code_object("bad", "spill-fuzz-fake:mismatch"),
+                            report=report)
+        self.assertEqual(proc.returncode, 1)
+        self.assertIn("no hip_runner server at", proc.stderr)
+        self.assertEqual(self.read_report(report)["variants"][0]["verdict"], "mismatch")
+
+    def test_serves_requests_in_order_on_one_connection_after_another(self) -> None:
+        ref = self.code_object("ref")
+        outcomes = []
+        for name, marker in (("a", ""), ("b", "spill-fuzz-fake:mismatch"), ("c", "")):
+            outcomes.append(self.connect(ref, self.code_object(name, marker)).returncode)
+        self.assertEqual(outcomes, [0, 1, 0])
+
+
+class ZygoteTest(ServerTestCase):
+    server_options = ["--zygote"]
+
+    def run_marked(self, name: str, marker: str = "") -> subprocess.CompletedProcess:
+        self.report = self.dir / f"{name}.json"
+        return self.connect(self.code_object("ref"), self.code_object(name, marker),
+                            report=self.report, extra=["--timeout-ms", "200"])
+
+    def verdicts(self) -> List[str]:
+        return [v["verdict"] for v in self.read_report(self.report)["variants"]]
+
+    def test_crash_answers_134_and_the_next_request_runs(self) -> None:
+        proc = self.run_marked("crash", "spill-fuzz-fake:crash")
+        self.assertEqual(proc.returncode, 134, proc.stderr)
+        self.assertEqual(self.verdicts(), ["fault"])
+        proc = self.run_marked("clean")
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertEqual(self.verdicts(), ["match"])
+        self.server.quit()
+        self.assertIn("1 faults", self.server.log_text())
+
+    def test_hang_answers_124_and_the_next_request_runs(self) -> None:
+        proc = self.run_marked("hang", "spill-fuzz-fake:hang")
+        self.assertEqual(proc.returncode, 124, proc.stderr)
+        self.assertEqual(self.verdicts(), ["hang"])
+        proc = self.run_marked("clean")
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertEqual(self.verdicts(), ["match"])
+        self.assertIsNone(self.server.proc.poll())
+        self.server.quit()
+        self.assertIn("1 timeouts", self.server.log_text())
+
+
+class HangWithoutZygoteTest(ServerTestCase):
+    def test_server_exits_after_a_hang(self) -> None:
+        # HIP cannot cancel the kernel, so a plain server answers and exits.
+        proc = self.connect(self.code_object("ref"),
+                            self.code_object("hang", "spill-fuzz-fake:hang"),
+                            extra=["--timeout-ms", "200"])
+        self.assertEqual(proc.returncode, 124, proc.stderr)
+        self.assertEqual(self.server.proc.wait(timeout=30), 124)
+        # Until the harness restarts it, tests run in-process.
+        proc = self.connect(self.code_object("ref"), self.code_object("clean"))
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertIn("running locally", proc.stderr)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,130 @@
+"""`gen` input generators: hip_runner's parser and --gen-input output, and
+build_input_spec.py's gen_line.
+
+`hip_runner --gen-input ARG --input-spec SPEC` writes the bytes a run would
+upload for argument ARG, so the tests read the generated values back with
+struct and check them against each generator's contract.
+"""
+
+import math
+import struct
+import sys
+import unittest
+from pathlib import Path
+from typing import List
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+from fake_hip_runner import TOOLS_DIR, HipRunnerTestCase  # noqa: E402
+
+sys.path.insert(0, str(TOOLS_DIR))
+from build_input_spec import gen_line  # noqa: E402
+
+FORMATS = {"u8": "B", "i32": "i", "u32": "I", "i64": "q", "u64": "Q", "f32": "f", "f64": "d"}
+
+
+class GenInputTest(HipRunnerTestCase):
+    def setUp(self) -> None:
+        self.dir = self.tmp / self.id().rsplit(".", 1)[-1]
+        self.dir.mkdir()
+
+    def gen(self, line: str, size: int, offset: int = 0, seed: int = 7) -> bytes:
+        """Bytes [offset, offset + size) of argument 0 under `gen 0 <line>`."""
+        spec = self.dir / "in.spec"
+        spec.write_text(f"gen 0 {line}\n", encoding="utf-8")
+        out = self.dir / f"gen.{offset}.{size}.bin"
+        proc = self.run_hip_runner("--gen-input", "0", "--seed", str(seed), "--size", str(size),
+                                   "--offset", str(offset), "--input-spec", str(spec),
+                                   "--out", str(out))
+        self.assertEqual(proc.returncode, 0, f"{line}: {proc.stderr}")
+        return out.read_bytes()
+
+    def values(self, line: str, count: int) -> List:
+        fmt = FORMATS[line.split()[0]]
+        return list(struct.unpack(f"<{count}{fmt}", self.gen(line, count * struct.calcsize(fmt))))
+
+    def test_simplex_groups_sum_to_one(self) -> None:
+        for elem_type, places in (("f64", 12), ("f32", 5)):
+            with self.subTest(elem_type=elem_type):
+                values = self.values(f"{elem_type} simplex 5", 5 * 64)
+                self.assertTrue(all(v >= 0 for v in values))
+                for g in range(0, len(values), 5):
+                    self.assertAlmostEqual(math.fsum(values[g:g + 5]), 1.0, places=places)
+
+    def test_range_values_stay_within_bounds(self) -> None:
+        for line in ("i32 range -5 5", "i32 range -2147483648 2147483647", "u8 range 250 255",
+                     "u32 range 4294967290 4294967295", "i64 range -3 -1",
+                     "u64 range 18446744073709551614 18446744073709551615", "u32 range 9 9"):
+            with self.subTest(line=line):
+                lo, hi = (int(b) for b in line.split()[2:4])
+                values = self.values(line, 256)
+                self.assertTrue(all(lo <= v <= hi for v in values), values)
+                if hi - lo < 16:
+                    self.assertEqual(set(values), set(range(lo, hi + 1)))
+
+    def test_range_rejects_bounds_outside_the_type(self) -> None:
+        spec = self.dir / "in.spec"
+        for bounds in ("i32 range 4000000000 4000000001", "i32 range -2147483649 0",
+                       "u32 range -1 5", "u32 range 0 4294967296", "u8 range 0 256",
+                       "u64 range -1 1", "i64 range 0 9223372036854775808",
+                       "i32 range 5 4", "i32 range 1x 4", "f32 range 0 1", "i32 uniform 0 1"):
+            with self.subTest(bounds=bounds):
+                spec.write_text(f"gen 0 {bounds}\n", encoding="utf-8")
+                proc = self.run_hip_runner("--gen-input", "0", "--size", "64", "--input-spec",
+                                           str(spec), "--out", str(self.dir / "out.bin"))
+                self.assertEqual(proc.returncode, 2, proc.stderr)
+                self.assertIn("invalid gen at line 1", proc.stderr)
+
+    def test_nan_and_inf_rates(self) -> None:
+        self.assertTrue(all(math.isnan(v) for v in self.values("f64 uniform 0 1 nan 1", 256)))
+        infs = self.values("f32 uniform 0 1 inf 1", 256)
+        self.assertTrue(all(math.isinf(v) for v in infs))
+        self.assertEqual({math.copysign(1, v) for v in infs}, {1.0, -1.0})
+        values = self.values("f64 positive 1 2 nan 0.25 inf 0.25", 4096)
+        nans = sum(math.isnan(v) for v in values) / len(values)
+        # NaN wins where both draws hit, so inf lands on (1 - 0.25) * 0.25.
+        infs = sum(math.isinf(v) for v in values) / len(values)
+        self.assertAlmostEqual(nans, 0.25, delta=0.03)
+        self.assertAlmostEqual(infs, 0.1875, delta=0.03)
+        self.assertTrue(all(1 <= v <= 2 for v in values if math.isfinite(v)))
+        self.assertFalse(any(math.isnan(v) for v in self.values("f64 uniform 0 1 nan 0", 256)))
+
+    def test_rates_are_checked(self) -> None:
+        spec = self.dir / "in.spec"
+        for line in ("f64 uniform 0 1 nan 1.5", "f64 uniform 0 1 inf -0.1",
+                     "f64 uniform 0 1 zero 0.5", "i32 range 0 9 nan 0.5"):
+            with self.subTest(line=line):
+                spec.write_text(f"gen 0 {line}\n", encoding="utf-8")
+                proc = self.run_hip_runner("--gen-input", "0", "--size", "64", "--input-spec",
+                                           str(spec), "--out", str(self.dir / "out.bin"))
+                self.assertEqual(proc.returncode, 2, proc.stderr)
+
+    def test_subrange_matches_the_full_fill(self) -> None:
+        # Offsets inside an element and inside a simplex group, so the
+        # regenerated prefix and suffix are cut from partial units.
+        for line in ("f64 simplex 3", "f32 uniform -1 1 nan 0.1", "i32 range -100 100",
+                     "u8 range 0 9", "f64 positive 0.5 8 inf 0.2"):
+            full = self.gen(line, 4096)
+            for offset, size in ((0, 4096), (13, 1000), (24, 48), (1001, 3), (4095, 1)):
+                with self.subTest(line=line, offset=offset, size=size):
+                    self.assertEqual(self.gen(line, size, offset), full[offset:offset + size])
+
+
+class GenLineTest(unittest.TestCase):
+    def test_range_bounds_must_fit_the_type(self) -> None:
+        for entry in ({"range": [4000000000, 4000000001]}, {"range": [-1, 5], "type": "u32"},
+                      {"range": [0, 256], "type": "u8"}, {"range": [-1, 1], "type": "u64"},
+                      {"range": [0, 2**63], "type": "i64"}, {"range": [5, 4]},
+                      {"range": [0, 1], "type": "f64"}):
+            with self.subTest(entry=entry):
+                with self.assertRaises(ValueError):
+                    gen_line("0", entry)
+
+    def test_range_edges_are_accepted(self) -> None:
+        self.assertEqual(gen_line("1", {"range": [-2**31, 2**31 - 1]}),
+                         "gen 1 i32 range -2147483648 2147483647")
+        self.assertEqual(gen_line("1", {"range": [0, 2**64 - 1], "type": "u64"}),
+                         "gen 1 u64 range 0 18446744073709551615")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,213 @@
+"""Typed output compare (output_compare.h) through hip_runner's host path.
+
+The fake kernel maps every input byte x to 5x + 1, so an input file holding
+the inverse of chosen bytes makes the reference output exactly those bytes.
+A test code object with spill-fuzz-fake:write@O=H markers then overwrites
+chosen output bytes, and the tests check hip_runner's verdict and mismatch
+message for f32, f64 and i32 buffers under exact, ulp and tol rules.
+
+The buffer is 4 full 64-byte blocks, a partial block and a tail that does
+not fill an element. Mismatches are planted in each block and run under
+every scanner the host has (OUTPUT_COMPARE_SCAN), so the AVX-512 and AVX2
+block scans are checked against the scalar one.
+"""
+
+import math
+import re
+import struct
+import sys
+import unittest
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+from fake_hip_runner import HipRunnerTestCase  # noqa: E402
+
+KERNEL_SPEC = "kernel kern\narg global_buffer 8 global\n"
+BUFFER_SIZE = 4 * 64 + 20 + 3
+FORMATS = {"f32": "<f", "f64": "<d", "i32": "<i"}
+SCANNERS = ("avx512", "avx2", "scalar")
+MISMATCH = re.compile(r"output mismatch in argument 0 at byte (\d+) \(element (\d+): .*; "
+                      r"(\d+) of (\d+) \w+ elements outside")
+
+F32_MAX = struct.unpack("<f", struct.pack("<I", 0x7F7FFFFF))[0]
+
+
+def bits(elem_type: str, value) -> bytes:
+    """Little-endian bytes of value, or value itself when it is raw bytes."""
+    return value if isinstance(value, bytes) else struct.pack(FORMATS[elem_type], value)
+
+
+def ulps_up(elem_type: str, value: float, n: int) -> bytes:
+    """The float n ULPs above positive `value`."""
+    raw = "<I" if elem_type == "f32" else "<Q"
+    return struct.pack(raw, struct.unpack(raw, bits(elem_type, value))[0] + n)
+
+
+def reference(elem_type: str) -> bytearray:
+    width = struct.calcsize(FORMATS[elem_type])
+    out = bytearray()
+    for i in range(BUFFER_SIZE // width):
+        out += bits(elem_type, i * 3 - 100 if elem_type == "i32" else 1.0 + i / 8)
+    return out + bytes(range(0x40, 0x40 + BUFFER_SIZE % width))
+
+
+def inverse_kernel(output: bytes) -> bytes:
+    # 205 * 5 = 1 (mod 256).
+    return bytes((205 * (b - 1)) & 0xFF for b in output)
+
+
+class OutputCompareTest(HipRunnerTestCase):
+    def setUp(self) -> None:
+        self.dir = self.tmp / self.id().rsplit(".", 1)[-1]
+        self.dir.mkdir()
+        self.spec = self.dir / "k.spec"
+        self.spec.write_text(KERNEL_SPEC, encoding="utf-8")
+        self.ref = self.dir / "ref.hsaco"
+        self.ref.write_text("kern\n", encoding="utf-8")
+        self.runs = 0
+
+    def compare(self, elem_type: str, rule: str, writes: Dict[int, bytes],
+                ref_writes: Optional[Dict[int, bytes]] = None,
+                scanner: Optional[str] = None) -> Tuple[int, str]:
+        """Run reference output `ref_writes` over the default values against
+        the same with `writes` on top; return (exit status, stderr)."""
+        self.runs += 1
+        output = reference(elem_type)
+        for offset, data in (ref_writes or {}).items():
+            output[offset:offset + len(data)] = data
+        data_path = self.dir / f"out{self.runs}.bin"
+        data_path.write_bytes(inverse_kernel(bytes(output)))
+        input_spec = self.dir / f"in{self.runs}.spec"
+        input_spec.write_text(f"file 0 0 0 {data_path}\ncompare 0 {elem_type} {rule}\n",
+                              encoding="utf-8")
+        test = self.dir / f"test{self.runs}.hsaco"
+        test.write_text("kern\n" + "".join(f"spill-fuzz-fake:write@{offset}={data.hex()}\n"
+                                           for offset, data in writes.items()),
+                        encoding="utf-8")
+        proc = self.run_hip_runner("--hsaco-a", str(self.ref), "--hsaco-b", str(test),
+                                   "--spec", str(self.spec), "--input-spec", str(input_spec),
+                                   env={"OUTPUT_COMPARE_SCAN": scanner or ""})
+        self.assertIn(proc.returncode, (0, 1), proc.stderr)
+        return proc.returncode, proc.stderr
+
+    def assert_mismatch(self, stderr: str, element: int, violations: int) -> None:
+        match = MISMATCH.search(stderr)
+        self.assertIsNotNone(match, stderr)
+        self.assertEqual((int(match.group(2)), int(match.group(3))), (element, violations),
+                         stderr)
+
+    def test_rules(self) -> None:
+        nan = struct.pack("<I", 0x7FC00000)
+        nan_payload = struct.pack("<I", 0x7FC00123)
+        dnan = struct.pack("<Q", 0x7FF8000000000000)
+        dnan_payload = struct.pack("<Q", 0x7FF8000000000ABC)
+        inf, ninf = math.inf, -math.inf
+        # (type, rule, reference value, test value, matches)
+        table = [
+            ("f32", "exact", 1.0, 1.0, True),
+            ("f32", "exact", 1.0, ulps_up("f32", 1.0, 1), False),
+            ("f32", "ulp 1", 1.0, ulps_up("f32", 1.0, 1), True),
+            ("f32", "ulp 1", 1.0, ulps_up("f32", 1.0, 2), False),
+            ("f32", "ulp 0", 0.0, -0.0, True),
+            ("f32", "exact", 0.0, -0.0, False),
+            ("f32", "tol 1e-6 0", 1.0, ulps_up("f32", 1.0, 1), True),
+            ("f32", "tol 1e-6 0", 1.0, 1.001, False),
+            ("f32", "tol 0 0.01", 0.0, 0.005, True),
+            ("f32", "exact", nan, nan_payload, True),
+            ("f32", "ulp 0", nan, nan, True),
+            ("f32", "tol 1e30 1e30", nan, 1.0, False),
+            ("f32", "tol 1e30 1e30", 1.0, nan, False),
+            ("f32", "tol 1e30 1e30", inf, ninf, False),
+            ("f32", "ulp 4", inf, F32_MAX, False),
+            ("f32", "tol 1e30 1e30", 1.0, inf, False),
+            ("f32", "ulp 0", ninf, ninf, True),
+            ("f64", "exact", 2.5, ulps_up("f64", 2.5, 1), False),
+            ("f64", "ulp 3", 2.5, ulps_up("f64", 2.5, 3), True),
+            ("f64", "ulp 3", 2.5, ulps_up("f64", 2.5, 4), False),
+            ("f64", "tol 1e-12 0", 1e10, 1e10 + 1e-3, True),
+            ("f64", "tol 1e-12 0", 1e10, 1e10 + 1.0, False),
+            ("f64", "exact", dnan, dnan_payload, True),
+            ("f64", "tol 1e300 1e300", inf, ninf, False),
+            ("f64", "tol 1e300 1e300", ninf, -1e308, False),
+            ("i32", "exact", 5, 6, False),
+            ("i32", "ulp 1", 5, 6, True),
+            ("i32", "ulp 2", -1, 1, True),
+            ("i32", "ulp 1", -1, 1, False),
+            ("i32", "ulp 1", -2**31, 2**31 - 1, False),
+            ("i32", "tol 0.5 0", 100, 149, True),
+            ("i32", "tol 0.5 0", 100, 151, False),
+        ]
+        for elem_type, rule, want, got, matches in table:
+            with self.subTest(elem_type=elem_type, rule=rule, want=want, got=got):
+                offset = 64 + 8
+                status, stderr = self.compare(elem_type, rule, {offset: bits(elem_type, got)},
+                                              {offset: bits(elem_type, want)})
+                self.assertEqual(status, 0 if matches else 1, stderr)
+                if not matches:
+                    width = len(bits(elem_type, want))
+                    self.assert_mismatch(stderr, offset // width, 1)
+
+    def test_tail_bytes_compare_exactly(self) -> None:
+        for elem_type, rule in (("f32", "tol 1e30 1e30"), ("f64", "ulp 1000000"),
+                                ("i32", "tol 1 1e9"), ("f64", "exact")):
+            with self.subTest(elem_type=elem_type, rule=rule):
+                width = struct.calcsize(FORMATS[elem_type])
+                elements = BUFFER_SIZE // width
+                status, stderr = self.compare(elem_type, rule, {BUFFER_SIZE - 1: b"\x00"})
+                self.assertEqual(status, 1, stderr)
+                self.assert_mismatch(stderr, elements, 1)
+                self.assertIn(f"at byte {elements * width} ", stderr)
+
+    def planted(self, elem_type: str) -> List[int]:
+        """The first and the last element byte of each 64-byte block, so each
+        block scan sees a difference in its first and in its last lane."""
+        width = struct.calcsize(FORMATS[elem_type])
+        last = BUFFER_SIZE // width * width - 1
+        return [b for block in range(5) for b in (block * 64, min(block * 64 + 63, last))]
+
+    def flips(self, elem_type: str, offsets: List[int]) -> Dict[int, bytes]:
+        # Bit 7 of any byte of an element is at least 128 ULPs (or the sign),
+        # a violation under ulp 1 for every type.
+        ref = reference(elem_type)
+        return {o: bytes([ref[o] ^ 0x80]) for o in offsets}
+
+    def test_mismatch_in_each_block_under_every_scanner(self) -> None:
+        for elem_type in FORMATS:
+            width = struct.calcsize(FORMATS[elem_type])
+            for offset in self.planted(elem_type):
+                outcomes = set()
+                for scanner in SCANNERS:
+                    with self.subTest(elem_type=elem_type, offset=offset, scanner=scanner):
+                        status, stderr = self.compare(elem_type, "ulp 1",
+                                                      self.flips(elem_type, [offset]),
+                                                      scanner=scanner)
+                        self.assertEqual(status, 1, stderr)
+                        self.assert_mismatch(stderr, offset // width, 1)
+                        outcomes.add(stderr)
+                self.assertEqual(len(outcomes), 1, outcomes)
+
+    def test_mismatches_in_all_blocks_are_counted_under_every_scanner(self) -> None:
+        for elem_type in FORMATS:
+            offsets = self.planted(elem_type) + [BUFFER_SIZE - 2]
+            outcomes = set()
+            for scanner in SCANNERS:
+                with self.subTest(elem_type=elem_type, scanner=scanner):
+                    status, stderr = self.compare(elem_type, "ulp 1",
+                                                  self.flips(elem_type, offsets),
+                                                  scanner=scanner)
+                    self.assertEqual(status, 1, stderr)
+                    # Two elements per block plus the tail byte.
+                    self.assert_mismatch(stderr, 0, 11)
+                    outcomes.add(stderr)
+            self.assertEqual(len(outcomes), 1, outcomes)
+
+    def test_matching_outputs_pass_under_every_scanner(self) -> None:
+        for scanner in SCANNERS:
+            with self.subTest(scanner=scanner):
+                status, stderr = self.compare("f64", "exact", {}, scanner=scanner)
+                self.assertEqual(status, 0, stderr)
+
+
+if __name__ == "__main__":
+    unittest.main()
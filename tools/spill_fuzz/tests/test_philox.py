@@ -0,0 +1,144 @@
+"""Philox input bytes (philox.h).
+
+philox4x32_10 is checked against the known-answer vectors of Random123's
+kat_vectors, through a small program built with $CXX, and philox_block
+against philox4x32_10 with the counter and key layout philox.h documents.
+The --gen-input tests check that any subrange, at any byte offset, is
+regenerated exactly as the whole buffer's fill wrote it.
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+from fake_hip_runner import TOOLS_DIR, HipRunnerTestCase  # noqa: E402
+
+CXX = os.environ.get("CXX", "c++")
+
+# `kat c0 c1 c2 c3 k0 k1` prints philox4x32_10(ctr, key); `block seed arg
+# block domain` prints the words of philox_block and of philox4x32_10 on the
+# counter and key philox_block is documented to use.
+KAT_SOURCE = r"""
+#include "philox.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static uint32_t word(const uint8_t *bytes) {
+  return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | uint32_t(bytes[3]) << 24;
+}
+
+int main(int argc, char **argv) {
+  uint64_t v[6] = {};
+  for (int i = 2; i < argc && i < 8; ++i) {
+    v[i - 2] = std::strtoull(argv[i], nullptr, 0);
+  }
+  if (argc == 8 && std::strcmp(argv[1], "kat") == 0) {
+    uint32_t ctr[4] = {uint32_t(v[0]), uint32_t(v[1]), uint32_t(v[2]),
+                       uint32_t(v[3])};
+    uint32_t key[2] = {uint32_t(v[4]), uint32_t(v[5])};
+    philox4x32_10(ctr, key);
+    std::printf("%08" PRIx32 " %08" PRIx32 " %08" PRIx32 " %08" PRIx32 "\n",
+                ctr[0], ctr[1], ctr[2], ctr[3]);
+    return 0;
+  }
+  if (argc == 6 && std::strcmp(argv[1], "block") == 0) {
+    uint8_t out[kPhiloxBlock];
+    philox_block(uint32_t(v[0]), uint32_t(v[1]), v[2], out, uint32_t(v[3]));
+    uint32_t ctr[4] = {uint32_t(v[2]), uint32_t(v[2] >> 32), uint32_t(v[1]),
+                       uint32_t(v[3])};
+    uint32_t key[2] = {uint32_t(v[0]), kPhiloxStream};
+    philox4x32_10(ctr, key);
+    std::printf("%08" PRIx32 " %08" PRIx32 " %08" PRIx32 " %08" PRIx32 "\n"
+                "%08" PRIx32 " %08" PRIx32 " %08" PRIx32 " %08" PRIx32 "\n",
+                word(out), word(out + 4), word(out + 8), word(out + 12),
+                ctr[0], ctr[1], ctr[2], ctr[3]);
+    return 0;
+  }
+  return 2;
+}
+"""
+
+# Random123 kat_vectors: philox4x32 10 ctr key -> expected.
+KAT_VECTORS = [
+    ("00000000 00000000 00000000 00000000", "00000000 00000000",
+     "6627e8d5 e169c58d bc57ac4c 9b00dbd8"),
+    ("ffffffff ffffffff ffffffff ffffffff", "ffffffff ffffffff",
+     "408f276d 41c83b0e a20bc7c6 6d5451fd"),
+    ("243f6a88 85a308d3 13198a2e 03707344", "a4093822 299f31d0",
+     "d16cfe09 94fdcceb 5001e420 24126ea1"),
+]
+
+
+@unittest.skipUnless(shutil.which(CXX), "no C++ compiler")
+class PhiloxKnownAnswerTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls) -> None:
+        cls.tmp = Path(tempfile.mkdtemp(prefix="philox_kat."))
+        source = cls.tmp / "philox_kat.cpp"
+        source.write_text(KAT_SOURCE, encoding="utf-8")
+        cls.exe = cls.tmp / "philox_kat"
+        subprocess.run([CXX, "-O1", "-std=c++17", "-pthread", f"-I{TOOLS_DIR}", "-o",
+                        str(cls.exe), str(source)], check=True)
+
+    @classmethod
+    def tearDownClass(cls) -> None:
+        shutil.rmtree(cls.tmp, ignore_errors=True)
+
+    def run_kat(self, *args: str) -> str:
+        proc = subprocess.run([str(self.exe), *args], stdout=subprocess.PIPE,
+                              universal_newlines=True, check=True)
+        return proc.stdout
+
+    def test_random123_vectors(self) -> None:
+        for ctr, key, expected in KAT_VECTORS:
+            with self.subTest(ctr=ctr, key=key):
+                words = [f"0x{w}" for w in f"{ctr} {key}".split()]
+                self.assertEqual(self.run_kat("kat", *words).split(), expected.split())
+
+    def test_block_uses_the_documented_counter_and_key(self) -> None:
+        for seed, arg, block, domain in ((0, 0, 0, 0), (12345, 3, 2**32 + 7, 0),
+                                         (0xFFFFFFFF, 1, 2**64 - 1, 0x47454E31)):
+            with self.subTest(seed=seed, arg=arg, block=block, domain=domain):
+                got, want = self.run_kat("block", str(seed), str(arg), str(block),
+                                         str(domain)).splitlines()
+                self.assertEqual(got, want)
+
+
+class GenInputOffsetTest(HipRunnerTestCase):
+    def gen(self, size: int, offset: int = 0, seed: int = 99, arg: int = 2) -> bytes:
+        out = self.tmp / f"philox.{seed}.{arg}.{offset}.{size}.bin"
+        proc = self.run_hip_runner("--gen-input", str(arg), "--seed", str(seed),
+                                   "--size", str(size), "--offset", str(offset),
+                                   "--out", str(out))
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        return out.read_bytes()
+
+    def test_unaligned_subranges_match_the_full_fill(self) -> None:
+        full = self.gen(4096)
+        for offset, size in ((1, 15), (7, 9), (13, 1000), (15, 2), (16, 16), (31, 33),
+                             (4000, 96), (4095, 1)):
+            with self.subTest(offset=offset, size=size):
+                self.assertEqual(self.gen(size, offset), full[offset:offset + size])
+
+    def test_threaded_fill_matches_at_unaligned_offsets(self) -> None:
+        # Past 1 MiB per thread the fill is split across threads.
+        size = 3 * 2**20 + 40
+        full = self.gen(size)
+        self.assertEqual(self.gen(size - 11, 5), full[5:size - 6])
+        self.assertEqual(self.gen(2**20 + 3, 2**20 - 1), full[2**20 - 1:2**21 + 2])
+
+    def test_streams_differ_by_seed_and_argument(self) -> None:
+        base = self.gen(64)
+        self.assertNotEqual(base, self.gen(64, seed=100))
+        self.assertNotEqual(base, self.gen(64, arg=3))
+
+
+if __name__ == "__main__":
+    unittest.main()